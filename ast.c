@@ -26,7 +26,6 @@
    - intermediate code generation
  */
 
-#include <math.h>
 #include <string.h>
 
 #include "base.h"
@@ -41,6 +40,8 @@
 
 #include "fmt.h"
 
+#include "math.h"
+
 static ub4 msgfile = Shsrc_ast;
 #include "msg.h"
 
@@ -1183,8 +1184,6 @@ void *mkast(struct synast *sa)
 
   ub4 cnt=0,cnt2=0,len;
 
-  ub4 fxs;
-  int fxp;
   ub4 ival1,ival2;
   double fval;
 
@@ -1514,15 +1513,7 @@ void *mkast(struct synast *sa)
 
         case Aflit:
           flitp = flits + ani;
-          fval = (double)(v8 & hi56);
-          if (v8 & Bit63) fval = -fval;
-          fxs = v8 >> 62;
-          fxp = (v8 >> 55) & 0xff;
-          if (fxp == 1 && fxs == 0) fval *= 10;
-          else if (fxp) {
-            if (fxs) fxp = -fxp;
-            fval *= exp(10 * log(fxp));
-          }
+          fval = bits2flt(v8); // as converted by lexer
           flitp->val = fval;
         break;
 
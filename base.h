@@ -80,11 +80,13 @@ typedef const char cchar;
  #define sassert(expr,msg) _Static_assert((expr),msg)
  #define Func __func__
  #define Noret _Noreturn
+ #define Thrlocal _Thread_local
 
 #else
  #define sassert(expr,msg) assert((expr),msg)
  #define Func ""
  #define Noret
+ #define Thrlocal
  #define quick_exit(c) _Exit(c)
 #endif
 
@@ -177,7 +179,7 @@ enum Shsrcfile { Shsrc_ast,Shsrc_eval,Shsrc_msg,
   Shsrc_map,
   Shsrc_base,Shsrc_dia,Shsrc_os,Shsrc_net,
   Shsrc_lex1,
-  Shsrc_genir,Shsrc_genlex,Shsrc_gensyn,
+  Shsrc_genir,Shsrc_genlex,Shsrc_gensyn,Shsrc_genflt,
   Shsrc_report,
   Shsrc_count};
 
@@ -204,6 +206,7 @@ struct globs {
   ub2 msglvl;
 
   ub4 maxvm;
+  ub1 hugepg; // large arenas on huge pages : 1 transparent, 2 hugetlbfs first, see osmmaphuge
 
   int pid;
 
@@ -60,6 +60,7 @@ usage()
   echo '-g - run generators'
   echo '-n - dryrun'
   echo '-m - create map file'
+  echo '-p - packed token stream'
   echo '-u - unconditional'
   echo '-v - verbose'
   echo '-vg - valgrind'
@@ -269,6 +270,7 @@ while [ $# -ge 1 ]; do
   '-L') mklic ;;
   '-n') dryrun=1 ;;
   '-m') map=1 ;;
+  '-p') cflags="$cflags -DTkpack" ;;
   '-u') always=1 ;;
   '-v') vrb=1 ;;
   '-vg') valgrind=1; cflags="$cflags -DVALGRIND" ;;
@@ -283,14 +285,22 @@ cc net.o  net.c
 cc mem.o  mem.c base.h os.h mem.h msg.h
 cc fmt.o  fmt.c base.h fmt.h chr.h os.h
 cc chr.o  chr.c base.h
-cc math.o math.c base.h math.h
 cc msg.o  msg.c base.h fmt.h msg.h mem.h os.h tim.h util.h
-cc map.o  map.c base.h msg.h os.h mem.h
+cc map.o  map.c base.h msg.h os.h mem.h fmt.h hash.h map.h
 # cc dia.o  dia.c base.h dia.h msg.h
 cc util.o util.c base.h mem.h os.h fmt.h msg.h tim.h util.h
 cc tim.o  tim.c base.h mem.h fmt.h msg.h tim.h
 cc bug.o  bug.c base.h fmt.h os.h
 
+if [ $dolgen -eq 1 ]; then
+  tc Genflt genflt.o gen/genflt.c base.h os.h mem.h msg.h util.h
+  ld        genflt   genflt.o base.o chr.o os.o msg.o mem.o util.o tim.o fmt.o
+
+  run flttab.i gen/genflt.c $always genflt "flttab.i"
+fi
+
+cc math.o math.c base.h math.h flttab.i
+
 if [ $dolgen -eq 1 ]; then
   tc Genlex genlex.o gen/genlex.c base.h chr.h os.h msg.h math.h mem.h util.h tim.h fmt.h hash.h
   ld        genlex   genlex.o base.o chr.o os.o msg.o math.o mem.o util.o tim.o fmt.o
@@ -315,20 +325,20 @@ if [ $dosgen -eq 1 ]; then
 #  run irdef.h irtyp.h $always genir "irdef.h"
 fi
 
-cc lex.o lex.c lextab.i lexint.i lexdef.h tok.h base.h chr.h mem.h msg.h fmt.h os.h map.h util.h lex.h lexsyn.h lsa.h hash.h
+cc lex.o lex.c lextab.i lexint.i lexdef.h tok.h base.h chr.h mem.h msg.h fmt.h os.h map.h util.h math.h lex.h lexsyn.h lsa.h hash.h
 
 cc syn.o syn.c base.h chr.h mem.h msg.h fmt.h map.h syn.h lexsyn.h lsa.h syntab.i astyp.h synast.h lexdef.h
 
-cc ast.o ast.c base.h chr.h mem.h msg.h fmt.h astyp.h synast.h lsa.h ast.h
+cc ast.o ast.c base.h chr.h mem.h msg.h fmt.h math.h astyp.h synast.h lsa.h ast.h
 
 # cc vm.o vm.c base.h irtyp.h irdef.h
 # cc vmrun.o vmrun.c base.h mem.h os.h msg.h fmt.h util.h tim.h irtyp.h irdef.h
 
 # ld vmrun vmrun.o base.o mem.o os.o fmt.o msg.o util.o tim.o vm.o
 
-cc lua.o lua.c base.h dia.h mem.h os.h msg.h pre.h lex.h lexsyn.h synast.h astyp.h util.h
+cc lua.o lua.c base.h dia.h map.h mem.h os.h msg.h pre.h lex.h lexsyn.h synast.h astyp.h util.h
 
-ld lua   lua.o base.o chr.o fmt.o pre.o lex.o math.o mem.o msg.o os.o map.o syn.o ast.o util.o tim.o net.o bug.o -lm
+ld lua   lua.o base.o chr.o fmt.o pre.o lex.o math.o mem.o msg.o os.o map.o syn.o ast.o util.o tim.o net.o bug.o -lm -lpthread
 
 # tc Report   report.o bug/report.c base.h fmt.h os.h net.h util.h tim.h
 # ld report            report.o base.o fmt.o os.o net.o util.o tim.o mem.o msg.o
@@ -0,0 +1,221 @@
+/* genflt.c - generate power of five table for float conversion
+
+   This file is part of Luanova, a fresh implementation of Lua.
+
+   Copyright © 2022 Joris van der Geer.
+
+   Luanova is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Affero General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Luanova is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU Affero General Public License
+   along with this program, typically in the file License.txt
+   If not, see http://www.gnu.org/licenses.
+ */
+
+/* Writes the 128-bit normalised powers of five used by the Eisel-Lemire decimal to double conversion in math.c
+   5^q for q >= 0 is truncated, 1/5^-q is rounded up, as in the reference tables of Lemire's paper.
+   Computed exactly with a small bignum : long division bit by bit, speed is irrelevant here.
+  */
+
+#include <string.h>
+
+#include "../base.h"
+#include "../mem.h"
+#include "../os.h"
+
+static ub4 msgfile = Shsrc_genflt;
+#include "../msg.h"
+
+#include "../util.h"
+
+static const char version[] = "0.1.0-alpha";
+
+struct globs globs;
+
+#define Pow5min -342
+#define Pow5max 308
+
+#define Bnlen 64 // ub4 limbs, 2048 bits
+
+struct bignum { ub4 w[Bnlen]; };
+
+static ub4 bnbits(const struct bignum *a)
+{
+  ub4 i = Bnlen;
+
+  while (i && a->w[i-1] == 0) i--;
+  if (i == 0) return 0;
+  return (i - 1) * 32 + msb(a->w[i-1]) + 1;
+}
+
+static ub1 bnbit(const struct bignum *a,ub4 b) { return (a->w[b >> 5] >> (b & 31)) & 1; }
+
+static void bnmul(struct bignum *a,ub4 m)
+{
+  ub8 x,c = 0;
+  ub4 i;
+
+  for (i = 0; i < Bnlen; i++) {
+    x = (ub8)a->w[i] * m + c;
+    a->w[i] = (ub4)x;
+    c = x >> 32;
+  }
+}
+
+static int bncmp(const struct bignum *a,const struct bignum *b)
+{
+  ub4 i = Bnlen;
+
+  while (i--) {
+    if (a->w[i] != b->w[i]) return a->w[i] < b->w[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+static void bnsub(struct bignum *a,const struct bignum *b)
+{
+  ub8 x,bo = 0;
+  ub4 i;
+
+  for (i = 0; i < Bnlen; i++) {
+    x = (ub8)a->w[i] - b->w[i] - bo;
+    a->w[i] = (ub4)x;
+    bo = (x >> 32) & 1;
+  }
+}
+
+static void bnshl1(struct bignum *a,ub1 bit)
+{
+  ub4 i,c = bit;
+
+  for (i = 0; i < Bnlen; i++) {
+    ub4 x = a->w[i];
+    a->w[i] = x << 1 | c;
+    c = x >> 31;
+  }
+}
+
+static void bnadd1(struct bignum *a)
+{
+  ub4 i;
+
+  for (i = 0; i < Bnlen; i++) {
+    if (++a->w[i]) break;
+  }
+}
+
+// q = 2^b / d
+static void bndiv2(struct bignum *q,ub4 b,const struct bignum *d)
+{
+  struct bignum r;
+  ub4 i = b + 1;
+
+  memset(q,0,sizeof(*q));
+  memset(&r,0,sizeof(r));
+
+  while (i--) {
+    bnshl1(&r,i == b);
+    bnshl1(q,0);
+    if (bncmp(&r,d) >= 0) { bnsub(&r,d); q->w[0] |= 1; }
+  }
+}
+
+// top 128 bits, truncated
+static void bntop(const struct bignum *a,ub8 *hi,ub8 *lo)
+{
+  ub4 n = bnbits(a);
+  ub4 i,b;
+
+  *hi = *lo = 0;
+  for (i = 0; i < 128; i++) {
+    if (n >= 128) b = n - 128 + i;
+    else if (i < 128 - n) continue;
+    else b = i - (128 - n);
+    if (bnbit(a,b) == 0) continue;
+    if (i < 64) *lo |= 1UL << i;
+    else *hi |= 1UL << (i - 64);
+  }
+}
+
+static int wrtab(cchar *name)
+{
+  static struct bufile fp;
+  struct bignum p5,d,q;
+  ub8 hi,lo;
+  ub4 k,z,b;
+  int e;
+
+  fp.nam = name;
+  fp.fd = -1;
+  myfopen(FLN,&fp,(Pow5max - Pow5min + 1) * 48 + 1024,1);
+
+  myfprintf(&fp,"/* %s - powers of five for decimal to double conversion\n\n",name);
+  myfprintf(&fp,"   generated by genflt %s\n\n",version);
+  myfprintf(&fp,"   pow5tab[q - Pow5min] is 5^q normalised to 128 bits, high word first\n");
+  myfprintf(&fp,"   truncated for q >= 0, rounded up for q < 0\n */\n\n");
+
+  myfprintf(&fp,"#define Pow5min %d\n#define Pow5max %d\n\n",Pow5min,Pow5max);
+  myfprintf(&fp,"static const ub8 pow5tab[(Pow5max - Pow5min + 1) * 2] = {\n");
+
+  for (e = Pow5min; e < 0; e++) {
+    k = (ub4)-e;
+    memset(&d,0,sizeof(d));
+    d.w[0] = 1;
+    for (; k; k--) bnmul(&d,5);
+    z = bnbits(&d);
+    b = e >= -27 ? z + 127 : 2 * z + 128;
+    bndiv2(&q,b,&d);
+    bnadd1(&q);
+    bntop(&q,&hi,&lo);
+    myfprintf(&fp,"  0x%016lx,0x%016lx, // %d\n",hi,lo,e);
+  }
+
+  memset(&p5,0,sizeof(p5));
+  p5.w[0] = 1;
+  for (e = 0; e <= Pow5max; e++) {
+    bntop(&p5,&hi,&lo);
+    myfprintf(&fp,"  0x%016lx,0x%016lx%c // %d\n",hi,lo,e < Pow5max ? ',' : ' ',e);
+    bnmul(&p5,5);
+  }
+  myfprintf(&fp,"};\n");
+
+  return myfclose(&fp);
+}
+
+static void init(void)
+{
+  inios();
+  globs.maxvm = 4;
+  oslimits();
+  setsigs();
+
+  inimem();
+  inimsg(Msg_shcoord | Msg_fno | Msg_lno | Msg_Lvl);
+}
+
+void bugreport(cchar *rep,ub2 rlen,cchar *tag) {}
+
+int main(int argc, char *argv[])
+{
+  int rv;
+
+  init();
+  globs.prgnam = "genflt";
+  globs.msglvl = Info;
+
+  if (argc < 2) { error("usage: %s <tab>",globs.prgnam); rv = 1; }
+  else rv = wrtab(argv[argc-1]); // after options as passed by build.sh
+
+  eximsg();
+  eximem(rv == 0);
+  exios(rv == 0);
+
+  return rv;
+}
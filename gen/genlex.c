@@ -61,6 +61,8 @@ static const char version[] = "0.1.0-alpha";
 /*
   pat nxstate token action
 
+state.N sets token start, state.R skips runs of plain self-loop chars vectorised
+
 state: . for no while
 pat: ` for no t
 nxstate  - for no nxchr
@@ -176,7 +178,7 @@ static cchar *tkwds[Nkwd];
 static ub1 tkwlens[Nkwd];
 static ub1 tkwdmap[Nkwd];
 
-static ub2 hikwlen,mikwlen,lokwlen=255,hitkwlen;
+static ub2 hikwlen,lokwlen=255,hitkwlen;
 
 #define Nact 32
 #define Actlen 2048
@@ -226,6 +228,7 @@ struct trans {
   bool hrtok;
   bool dowhile;
   bool setN;
+  bool dorun;
   bool iserr;
   bool tswitch;
   bool eof;
@@ -249,7 +252,6 @@ static ub2 transtablen;
 #define Lxernam 16
 
 #define Kwhshiter  1024
-#define Dndhshiter 1024
 
 static ub8 chkhsh;
 
@@ -1036,7 +1038,7 @@ static cchar *blts[Nblt];
 static ub1 bltlens[Nblt];
 static ub2 bltlnos[Nblt];
 static ub1 havebltlens[Bltnamlen];
-static ub2 lobltlen=255,hibltlen,mibltlen;
+static ub2 lobltlen=255,hibltlen;
 
 static void addblt(ub2 ln,cchar *name,ub1 len)
 {
@@ -1102,249 +1104,122 @@ static ub1 gettoken(ub2 ln,cchar *buf,ub4 pos,ub2 len)
   serror(ln|Lno,"unknown token '%.*s'",len,buf+pos);
 }
 
-#define Hshlen 0x1000
-static ub1 kwhsh[Hshlen];
-static ub1 blthsh[Hshlen];
-static ub1 dun0hsh[Hshlen];
-static ub1 dun1hsh[Hshlen];
-static ub2 kwhshlen,blthshlen,dun0hshlen,dun1hshlen;
-static ub1 kwhshlut[256];
-static ub1 blthshlut[256];
-static ub4 hshseed,d0hshseed,d1hshseed;
-static ub2 kwdhshshift,blthshshift,dun0hshshift,dun1hshshift;
-
-static void setlut(ub1 *lut,ub4 hc,ub1 bit)
-{
-  lut[hc & 0xff] |= (1U << bit);
-  lut[(hc >>  8) & 0xff] |= (2U << bit);
-  lut[(hc >> 16) & 0xff] |= (4U << bit);
-  lut[hc >> 24] |= (8U << bit);
-}
-
-// create hash and check if perfect
-static ub2 mkkwhsh2(ub1 *hsh,cchar *strs[],ub1 *slens,ub2 cnt,ub2 len,ub1 pwr2,ub4 seed)
-{
-  const char *p;
-  ub4 hc,len1 = len-1;
-  ub2 h,slen,sno;
-  ub1 bit;
-
- for (bit = 0; bit < 32 - pwr2; bit++) {
-
-  memset(hsh,cnt,len);
-  memset(kwhshlut,0,256);
-
-  for (sno = 0; sno < cnt; sno++) {
-    slen = slens[sno];
-    if (slen < 3) continue;
-    p = strs[sno];
-    if ((size_t)p & 3) hc = hashstr(p,slen,seed);
-    else hc = hashalstr(p,slen,seed);
-
-    // info("len %-4u h %x %.*s",len,hc,slen,p);
-    setlut(kwhshlut,hc,slen >= mikwlen ? 4 : 0);
-
-    hc = (hc >> pwr2) ^ hc;
-    if (bit) hc >>= bit;
-    h = hc & len1;
-
-    if (hsh[h] < cnt) break; // collided
-    hsh[h] = sno;
-  }
-  if (sno == cnt) return bit;
- }
- return 32;
-}
+#define Mphkeys 256
 
-static ub2 mkblthsh2(ub1 *hsh,cchar *strs[],ub1 *slens,ub2 cnt,ub2 len,ub1 pwr2,ub4 seed)
-{
-  const char *p;
-  ub4 hc,len1 = len-1;
-  ub2 h,slen,sno;
-  ub1 bit;
-
- for (bit = 0; bit < 32 - pwr2; bit++) {
-
-  memset(hsh,cnt,len);
-  memset(blthshlut,0,256);
-
-  for (sno = 0; sno < cnt; sno++) {
-    slen = slens[sno];
-    if (slen < 3) continue;
-    p = strs[sno];
-    if ((size_t)p & 3) hc = hashstr(p,slen,seed);
-    else hc = hashalstr(p,slen,seed);
-
-    setlut(blthshlut,hc,slen >= mibltlen ? 4 : 0);
-
-    hc = (hc >> pwr2) ^ hc;
-    if (bit) hc >>= bit;
-    h = hc & len1;
-
-    if (hsh[h] < cnt) break; // collided
-    hsh[h] = sno;
-  }
-  if (sno == cnt) return bit;
- }
- return 32;
-}
-
-static ub2 mkdunhsh2(ub1 *hsh,cchar *strs[],ub1 *slens,ub2 cnt,ub2 len,ub1 pwr2,ub4 seed,ub1 part)
-{
-  const char *p;
-  ub4 hc,len1 = len-1;
-  ub2 h,slen,sno;
-  ub2 bit;
-
- for (bit = 0; bit < 32 - pwr2; bit++) {
-
-  memset(hsh,cnt,len);
-
-  for (sno = 0; sno < cnt; sno++) {
-    slen = slens[sno];
-    if (slen < 3) continue;
-    p = strs[sno];
-    if ((*p & 1) != part) continue;
-
-    if ((size_t)p & 3) hc = hashstr(p,slen,seed);
-    else hc = hashalstr(p,slen,seed);
-
-    hc = (hc >> pwr2) ^ hc;
-    if (bit) hc >>= bit;
-    h = hc & len1;
+struct mph {
+  ub2 cnt;            // slots, one per key of 3 or more chars
+  ub1 bbit;           // bucket count log2
+  ub2 dsp[Mphkeys];   // displacement per bucket
+  ub1 keys[Mphkeys];  // key per slot
+};
 
-    if (hsh[h] < cnt) break;
-    hsh[h] = sno;
-  }
-  if (sno == cnt) return bit;
- }
- return 32;
-}
+static struct mph kwmph,bltmph,dunmph;
+static ub4 hshseed;
 
-static ub2 mkkwhsh(ub2 len,ub4 seed)
+// find a displacement per bucket that gives each of its keys a free slot, larger buckets first
+static int mkmph2(struct mph *mp,const ub4 *hcs,const ub1 *keys,ub2 n,ub1 bbit)
 {
-  ub2 bit = 0,len2 = 1,sbit;
-
-  // check next pwr2
-  while (len2 < len) { len2 <<= 1; bit++; }
-
-  while (len2 < Hshlen) {
-    sbit = mkkwhsh2(kwhsh,tkwds,tkwlens,ntkwd,len2,bit,seed);
-    if (sbit < 32) {
-      kwdhshshift = sbit;
-      return len2;
+  ub2 bcnt = (ub2)(1U << bbit),bmsk = bcnt - 1;
+  ub1 bsiz[Mphkeys];
+  ub1 used[Mphkeys];
+  ub2 slots[Mphkeys];
+  ub2 b,i,j,k,s,sz,maxsz = 0;
+  ub4 d;
+
+  memset(bsiz,0,bcnt);
+  memset(used,0,n);
+  memset(mp->dsp,0,bcnt * 2);
+
+  for (k = 0; k < n; k++) {
+    b = hcs[k] & bmsk;
+    bsiz[b]++;
+    maxsz = max(maxsz,bsiz[b]);
+  }
+
+  for (sz = maxsz; sz; sz--) {
+    for (b = 0; b < bcnt; b++) {
+      if (bsiz[b] != sz) continue;
+
+      for (d = 0; d < hi16; d++) {
+        for (i = k = 0; k < n; k++) {
+          if ((hcs[k] & bmsk) != b) continue;
+          s = (ub2)mphslot(hcs[k],d,n);
+          if (used[s]) break;
+          for (j = 0; j < i && slots[j] != s; j++) ;
+          if (j < i) break;
+          slots[i++] = s;
+        }
+        if (k == n) break;
+      }
+      if (d == hi16) return 1;
+
+      mp->dsp[b] = (ub2)d;
+      for (k = 0; k < n; k++) {
+        if ((hcs[k] & bmsk) != b) continue;
+        s = (ub2)mphslot(hcs[k],d,n);
+        used[s] = 1;
+        mp->keys[s] = keys[k];
+      }
     }
-    len2 <<= 1; bit++;
   }
-  return Hshlen;
+  return 0;
 }
 
-static ub2 mkbltsh(ub2 len,ub4 seed)
+// minimal perfect hash with the fewest buckets found for seed. 0 if found
+static int mkmph(struct mph *mp,cchar *strs[],ub1 *slens,ub2 cnt,ub4 seed)
 {
-  ub2 bit = 0,len2 = 1,sbit;
-
-  while (len2 < len) { len2 <<= 1; bit++; }
+  ub4 hcs[Mphkeys];
+  ub1 keys[Mphkeys];
+  ub2 sno,n = 0;
+  ub1 bit,hibit;
 
-  while (len2 < Hshlen) {
-    sbit = mkblthsh2(blthsh,blts,bltlens,nblt,len2,bit,seed);
-    if (sbit < 32) {
-      blthshshift = sbit;
-      return len2;
-    }
-    len2 <<= 1; bit++;
+  for (sno = 0; sno < cnt; sno++) {
+    if (slens[sno] < 3) continue;
+    if (slens[sno] > 16) serror(Lno,"name '%.*s' exceeds 16 for fixed-width compare",slens[sno],strs[sno]);
+    hcs[n] = hashstr((const ub1 *)strs[sno],slens[sno],seed);
+    keys[n++] = (ub1)sno;
   }
-  return Hshlen;
-}
-
-static ub2 mkdunhsh(ub2 len,ub4 seed,ub1 part)
-{
-  ub2 bit = 0,len2 = 1,sbit;
-  ub1 *hsh = part ? dun1hsh : dun0hsh;
+  mp->cnt = n;
+  mp->bbit = 0;
+  if (n == 0) return 0;
 
-  while (len2 < len) { len2 <<= 1; bit++; }
-
-  while (len2 < Hshlen) {
-    sbit = mkdunhsh2(hsh,duns,dunlens,ndun,len2,bit,seed,part);
-    if (sbit < 32) {
-      if (part) dun1hshshift = sbit;
-      else dun0hshshift = sbit;
-      return len2;
+  hibit = min(msb(n) + 2,msb(Mphkeys)); // up to 4 buckets per key
+  for (bit = hibit > 4 ? hibit - 4 : 0; bit <= hibit; bit++) {
+    if (mkmph2(mp,hcs,keys,n,bit) == 0) {
+      mp->bbit = bit;
+      return 0;
     }
-    len2 <<= 1; bit++;
   }
-  return Hshlen;
+  return 1;
 }
 
+// one seed for keywords, builtins and dunders : the lexer hashes an ident once
 static int mkhshes(void)
 {
-  ub2 n,klen=0,blen=0,dlen,loklen=Hshlen,loblen=Hshlen,lodlen=Hshlen;
-  ub2 sum = 0;
   ub4 it,loit=0,loseed=0,seed = 0;
+  ub4 sum,losum = hi32;
 
   if (ntkwd >= 255) { error("%u kwd exceeds 255",ntkwd); return 1; }
 
-  for (n = 3; n < Bltnamlen; n++) {
-    sum += havebltlens[n];
-    if (sum * 2 >= nblt) break;
-  }
-  mibltlen = n;
-
-  sum = 0;
-  for (n = 3; n < Kwnamlen; n++) {
-    sum += havekwlens[n];
-    if (sum * 2 >= ntkwd) break;
-  }
-  mikwlen = n;
-
   for (it = 0; it < Kwhshiter; it++) {
-    if (ntkwd) klen = mkkwhsh(ntkwd,seed);
-    if (nblt) blen = mkbltsh(nblt,seed);
-    if (klen + blen < loklen + loblen) { loklen = klen; loblen = blen; loseed = seed; loit=it; }
+    if (mkmph(&kwmph,tkwds,tkwlens,ntkwd,seed) == 0
+        && mkmph(&bltmph,blts,bltlens,nblt,seed) == 0
+        && mkmph(&dunmph,duns,dunlens,ndun,seed) == 0) {
+      sum = (1U << kwmph.bbit) + (1U << bltmph.bbit) + (1U << dunmph.bbit);
+      if (sum < losum) { losum = sum; loseed = seed; loit = it; }
+    }
     seed = rnd(hi32);
   }
+  if (losum == hi32) serror(Lno,"no perfect hash found in %u iters",Kwhshiter);
 
-  if (ntkwd) {
-    if (loklen >= Hshlen) serror(Lno,"no hash len under %u found for kwd",Hshlen);
-    klen = mkkwhsh(loklen,loseed);
-    kwhshlen = klen;
-    info("kwd    hash size %4u for %2u seed %x at iter %u shift %u",klen,ntkwd,loseed,loit,kwdhshshift);
-  }
-  if (nblt) {
-    if (loblen >= Hshlen) serror(Lno,"no hash len under %u found for bltin",Hshlen);
-    blen = mkbltsh(loblen,loseed);
-    blthshlen = blen;
-    info("blt    hash size %4u for %2u shift %u",blen,nblt - havebltlens[2],blthshshift);
-  }
+  mkmph(&kwmph,tkwds,tkwlens,ntkwd,loseed);
+  mkmph(&bltmph,blts,bltlens,nblt,loseed);
+  mkmph(&dunmph,duns,dunlens,ndun,loseed);
   hshseed = loseed;
 
-  if (ndun == 0) return 0;
-
-  seed = 0;
-  for (it = 0; it < Dndhshiter; it++) {
-    dlen = mkdunhsh(ndun,seed,0);
-    if (dlen < lodlen) { lodlen = dlen; loseed = seed; loit=it; }
-    seed = rnd(hi32);
-  }
-  if (lodlen >= Hshlen) serror(Lno,"no hash len under %u found for dunder",Hshlen);
-  dlen = mkdunhsh(lodlen,loseed,0);
-  if (dlen != lodlen) ice(0,0,"dunder hash %u vs %u",dlen,lodlen);
-  dun0hshlen = dlen;
-  info("dunder hash 0 size %4u for %2u seed %x at iter %u shift %u",dlen,ndun - havedunlens[2],loseed,loit,dun0hshshift);
-  d0hshseed = loseed;
-
-  seed = 0; lodlen = Hshlen;
-  for (it = 0; it < Dndhshiter; it++) {
-    dlen = mkdunhsh(ndun,seed,1);
-    if (dlen < lodlen) { lodlen = dlen; loseed = seed; loit=it; }
-    seed = rnd(hi32);
-  }
-  if (lodlen >= Hshlen) serror(Lno,"no hash len under %u found for dunder",Hshlen);
-  dlen = mkdunhsh(lodlen,loseed,1);
-  if (dlen != lodlen) ice(0,0,"dunder hash %u vs %u",dlen,lodlen);
-  dun1hshlen = dlen;
-  info("dunder hash 1 size %4u for %2u seed %x at iter %u shift %u",dlen,ndun - havedunlens[2],loseed,loit,dun1hshshift);
-  d1hshseed = loseed;
-
+  info("kwd    hash %3u slots %3u buckets seed %x at iter %u",kwmph.cnt,1U << kwmph.bbit,loseed,loit);
+  info("blt    hash %3u slots %3u buckets",bltmph.cnt,1U << bltmph.bbit);
+  info("dunder hash %3u slots %3u buckets",dunmph.cnt,1U << dunmph.bbit);
 
   return 0;
 }
@@ -1878,7 +1753,10 @@ static int rdspec(cchar *fname)
       strefs[st0] = tp;
       statereach[st0] |= 1;
       if (c2 == '*') { statereach[st0] = 0xff; n++; }
-    }  else if (t == Cdot && c2 == 'N') tp->setN = 1;
+    }  else if (t == Cdot) { // .N set token start  .R skip runs
+      if (c2 == 'N' || buf[n+2] == 'N') tp->setN = 1;
+      if (c2 == 'R' || buf[n+2] == 'R') tp->dorun = 1;
+    }
 
     idnam0 = idnam1 = 0;
     patno = 0;
@@ -2377,22 +2255,19 @@ static void wrfhdr(struct bufile *fp,ub1 addinfo)
   }
 }
 
-static ub4 wrhsh(struct bufile *lfp,struct bufile *sfp,cchar *pfx,cchar *names[],ub1 *lens,ub1 *map,ub2 cnt,ub1 *hsh,ub2 hshlen,bool dopool)
+// name pool, positions and lengths
+static ub4 wrpool(struct bufile *sfp,cchar *pfx,cchar *names[],ub1 *lens,ub1 *map,ub2 cnt)
 {
-  #define Spool (Nkwd * 8)
-  ub2 i,len,x,eoflen;
+  #define Spool (Nblt * 8) // also for kwds and dunders
+  ub2 i,len,eoflen;
   ub4 hc=0;
   ub2 spos=0;
   char spool[Spool];
-  char buf[512];
-  ub2 blen = 512,bpos=0;
-  ub2 sposs[Nkwd];
-  char pfx0 = *pfx++;
-  char pfx1 = upcase(*pfx);
+  ub2 sposs[Nblt + 1];
   ub2 pfxlen = strlen(pfx);
   cchar *mpfx = map ? "t" : "";
 
- if (dopool && sfp->top) {
+ if (sfp->top) {
   if (Ctab[pfx[pfxlen-1]] == Cnum) pfxlen--;
   memset(spool,' ',Spool);
   for (i = 0; i < cnt; i++) {
@@ -2425,33 +2300,39 @@ static ub4 wrhsh(struct bufile *lfp,struct bufile *sfp,cchar *pfx,cchar *names[]
   myfputs(sfp," };\n\n");
 
  } // do sfp
+  return hc;
+}
 
-  myfprintf(lfp,"#define %c%shshmsk %u\n",pfx1,pfx+1,hshlen-1);
-  myfprintf(lfp,"#define %c%shshbit  %u\n\n",pfx1,pfx+1,msb(hshlen));
-  myfprintf(lfp,"#define x %c99_count\n\n",pfx0);
-
-  myfprintf(lfp,"static const ub1 %shsh[%u] = {\n  ",pfx,hshlen);
-  bpos = 0;
-  for (i = 0; i < hshlen; i++) {
-    x = hsh[i];
-    if (x < cnt) {
-      myfprintf(lfp,"%-3u",x);
-      bpos += mysnprintf(buf,bpos,blen," %.*s",lens[x],names[x]);
-    } else {
-      myfputs(lfp,"x  ");
-      buf[bpos++] = '.';
-    }
-    if (i < hshlen-1) myfputc(lfp,',');
-    if (( i & 15) == 15) {
-      myfprintf(lfp," // %.*s\n  ",bpos,buf);
-      bpos = 0;
-    }
+/* minimal perfect hash : displacement per bucket, and per slot the padded name with its id
+   pfx is the id prefix followed by the table prefix
+ */
+static void wrmph(struct bufile *lfp,cchar *pfx,struct mph *mp,cchar *names[],ub1 *lens)
+{
+  ub2 i,x,bcnt = (ub2)(1U << mp->bbit);
+  char pfx1 = upcase(pfx[1]);
+  cchar *nam;
+  ub8 w[2];
+
+  myfprintf(lfp,"#define %c%smphcnt %u\n",pfx1,pfx+2,mp->cnt);
+  myfprintf(lfp,"#define %c%smphmsk %u\n\n",pfx1,pfx+2,bcnt - 1);
+
+  myfprintf(lfp,"static const ub2 %smphdsp[%u] = {",pfx+1,bcnt);
+  for (i = 0; i < bcnt; i++) {
+    if (i) myfputc(lfp,',');
+    if ((i & 15) == 0) myfputs(lfp,"\n  ");
+    myfprintf(lfp,"%u",mp->dsp[i]);
   }
-  if (bpos) myfprintf(lfp," // %.*s\n",bpos,buf);
-  myfputs(lfp,"};\n");
+  myfputs(lfp,"\n};\n\n");
 
-  myfputs(lfp,"#undef x\n\n");
-  return hc;
+  myfprintf(lfp,"static const struct mphkey %smphkey[%u] = {\n",pfx+1,max(mp->cnt,1));
+  for (i = 0; i < mp->cnt; i++) {
+    x = mp->keys[i];
+    nam = names[x];
+    mphword((const ub1 *)nam,lens[x],w);
+    myfprintf(lfp,"  { 0x%lx,0x%lx,%u,%u }%c // %.*s\n",w[0],w[1],lens[x],x,i + 1 < mp->cnt ? ',' : ' ',lens[x],nam);
+  }
+  if (mp->cnt == 0) myfprintf(lfp,"  { 0,0,0,%c99_count }\n",*pfx);
+  myfputs(lfp,"};\n\n");
 }
 
 static cchar *fmtname(ub2 len,cchar *p)
@@ -2632,24 +2513,6 @@ static ub2 wrcode(char *buf,ub2 bpos,ub2 blen,ub2 len,cchar *ap,ub2 ln)
   return bpos;
 }
 
-static void wrhshlut(struct bufile *fp,cchar *pfx,ub1 *lut)
-{
-  char buf[2048];
-  ub2 c,cnt1=0,cnt2=0,pos,len=2048;
-  ub1 x;
-
-  pos = mysnprintf(buf,0,len,"static const unsigned char %shshlut[256] = {\n  ",pfx);
-  for (c = 0; c < 256; c++) {
-    if (c) buf[pos++] = ',';
-    if (c && (c & 0xf) == 0) pos += mysnprintf(buf,pos,len,"\n  ");
-    x = lut[c];
-    if (x & 0xf) cnt1++;
-    if (x & 0xf0) cnt2++;
-    pos += mysnprintf(buf,pos,len,"%3u",x);
-  }
-  myfprintf(fp,"%.*s\n}; // %u,%u\n\n",pos,buf,cnt1,cnt2);
-}
-
 static void wrenum(struct bufile *fp,ub1 *lens,cchar **nams,char *name,ub2 cnt,ub4 upad)
 {
   ub2 n;
@@ -2675,10 +2538,139 @@ static void wrenum(struct bufile *fp,ub1 *lens,cchar **nams,char *name,ub2 cnt,u
   myfprintf(fp," %c%*s = %2u\n};\n\n",*name,pad,"99_count",cnt);
 }
 
-static void wrhshshift(struct bufile *fp,cchar *infix,ub2 shift)
+// chars a pattern can start with. 0 if not known statically
+static bool patfirst(struct trans *tp,ub1 *mem)
+{
+  ub2 c;
+  ub1 s = tp->syms[0];
+
+  switch (tp->ctls[0]) {
+  case Cc_z:
+  case Cc_c: mem[s] = 1; break;
+  case Cc_a: mem[s] = 1; mem[s & ~0x20] = 1; break;
+  case Cc_t: for (c = 0; c < 256; c++) if (ctab[c] == s) mem[c] = 1;
+             break;
+  case Cc_u: for (c = 0; c < 256; c++) if (cctab[c] & setbits[s]) mem[c] = 1;
+             break;
+  case Cc_x: memset(mem,1,256); break;
+  default: return 0;
+  }
+  return 1;
+}
+
+/* set of chars a state loops on without action, as nibble classes plus plain map for runskip()
+   a char c is in if lo[c & 15] & hi[c >> 4]. returns member count, 0 if none or not expressible in 8 classes
+ */
+static ub2 runset(ub2 ttndx,ub2 ttend,ub1 st0,ub1 loopc,bool ifchain,ub1 *set)
+{
+  ub1 done[256],run[256],mem[256];
+  ub2 nibs[16],cls[8];
+  ub2 c,h,k,ncls = 0,cnt = 0;
+  struct trans *tp;
+  bool plain;
+
+  memset(run,0,256);
+  memset(set,0,32 + 256);
+
+  if (ifchain) { // first match in pattern order
+    memset(done,0,256);
+    for (; ttndx < ttend; ttndx++) {
+      tp = transtab + ttndx;
+      memset(mem,0,256);
+      if (patfirst(tp,mem) == 0) return 0;
+      plain = (tp->st == st0 && tp->cclen == 1 && !tp->havecode && !tp->havetok && !tp->dobt && !tp->notpred && !tp->iserr && !tp->eof);
+      for (c = 0; c < 256; c++) {
+        if (mem[c] == 0 || done[c]) continue;
+        done[c] = 1;
+        run[c] = plain;
+      }
+    }
+  } else if (loopc != 0xff) run[loopc] = 1;
+
+  run[0] = 0; // eof ends any run
+
+  memset(nibs,0,sizeof(nibs));
+  for (c = 1; c < 256; c++) {
+    if (run[c]) { nibs[c >> 4] |= (ub2)(1U << (c & 15)); set[32 + c] = 1; cnt++; }
+  }
+  if (cnt == 0) return 0;
+
+  for (h = 0; h < 16; h++) {
+    if (nibs[h] == 0) continue;
+    for (k = 0; k < ncls && cls[k] != nibs[h]; k++) ;
+    if (k == ncls) {
+      if (ncls == 8) return 0;
+      cls[ncls++] = nibs[h];
+    }
+    set[16 + h] = (ub1)(1U << k);
+  }
+  for (k = 0; k < ncls; k++) {
+    for (c = 0; c < 16; c++) if (cls[k] & (1U << c)) set[c] |= (ub1)(1U << k);
+  }
+  return cnt;
+}
+
+// vectorised run skipping for self-loop states, used by the generated lexer
+static void wrrunskip(struct bufile *fp)
 {
-  if (shift) myfprintf(fp,"#define %shshshift(h) h >> %u\n",infix,shift);
-  else myfprintf(fp,"#define %shshshift(h) h\n",infix);
+  myfputs(fp,"/* skip a run of set members from sp+n, at least up to the 0 at eof\n"
+    "   set is two nibble tables : c is a member if set[c & 15] & set[16 + (c >> 4)], followed by a plain map\n"
+    "   Most runs are short : callers only skip if the char at Runpeek is a member, within the source pad.\n"
+    "   The first Runscalar chars are tested inline one by one, longer runs vectorised\n"
+    "   Aligned loads never cross a page, so reading past the eof within one is harmless\n */\n"
+    "#define Runpeek 4\n"
+    "#define Runscalar 8\n\n");
+
+  myfputs(fp,"#if defined __AVX2__\n"
+    " #include <immintrin.h>\n\n"
+    "static __attribute__((noinline,no_sanitize_address)) ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)\n{\n"
+    "  const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set));\n"
+    "  const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(set + 16)));\n"
+    "  const __m256i nib = _mm256_set1_epi8(0x0f);\n"
+    "  const ub1 *p = sp + n;\n"
+    "  const ub1 *a = (const ub1 *)((size_t)p & ~(size_t)31);\n"
+    "  ub4 x = 0xffffffffU << (p - a);\n"
+    "  __m256i v,m;\n\n"
+    "  do {\n"
+    "    v = _mm256_load_si256((const __m256i *)a);\n"
+    "    m = _mm256_and_si256(_mm256_shuffle_epi8(lo,_mm256_and_si256(v,nib)),_mm256_shuffle_epi8(hi,_mm256_and_si256(_mm256_srli_epi16(v,4),nib)));\n"
+    "    x &= (ub4)_mm256_movemask_epi8(_mm256_cmpeq_epi8(m,_mm256_setzero_si256()));\n"
+    "    if (x) break;\n"
+    "    a += 32; x = 0xffffffffU;\n"
+    "  } while (1);\n"
+    "  return (ub4)(a - sp) + (ub4)__builtin_ctz(x);\n}\n\n");
+
+  myfputs(fp,"#elif defined __SSSE3__\n"
+    " #include <tmmintrin.h>\n\n"
+    "static __attribute__((noinline,no_sanitize_address)) ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)\n{\n"
+    "  const __m128i lo = _mm_loadu_si128((const __m128i *)set);\n"
+    "  const __m128i hi = _mm_loadu_si128((const __m128i *)(set + 16));\n"
+    "  const __m128i nib = _mm_set1_epi8(0x0f);\n"
+    "  const ub1 *p = sp + n;\n"
+    "  const ub1 *a = (const ub1 *)((size_t)p & ~(size_t)15);\n"
+    "  ub4 x = 0xffffU << (p - a);\n"
+    "  __m128i v,m;\n\n"
+    "  do {\n"
+    "    v = _mm_load_si128((const __m128i *)a);\n"
+    "    m = _mm_and_si128(_mm_shuffle_epi8(lo,_mm_and_si128(v,nib)),_mm_shuffle_epi8(hi,_mm_and_si128(_mm_srli_epi16(v,4),nib)));\n"
+    "    x &= (ub4)_mm_movemask_epi8(_mm_cmpeq_epi8(m,_mm_setzero_si128()));\n"
+    "    if (x) break;\n"
+    "    a += 16; x = 0xffffU;\n"
+    "  } while (1);\n"
+    "  return (ub4)(a - sp) + (ub4)__builtin_ctz(x);\n}\n\n");
+
+  myfputs(fp,"#else\n\n"
+    "static ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)\n{\n"
+    "  while (set[32 + sp[n]]) n++;\n"
+    "  return n;\n}\n\n"
+    "#endif\n\n");
+
+  myfputs(fp,"static inline ub4 runskip(const ub1 *sp,ub4 n,const ub1 *set)\n{\n"
+    "  ub4 e = n + Runscalar;\n\n"
+    "  do {\n"
+    "    if (set[32 + sp[n]] == 0) return n;\n"
+    "  } while (++n < e);\n"
+    "  return runskipv(sp,n,set);\n}\n\n");
 }
 
 static int wrfile(void)
@@ -2732,6 +2724,8 @@ static int wrfile(void)
   ub1 ctbl[256];
   ub1 ttbl[256];
   ub2 ctltab[256];
+  ub1 runtab[32 + 256];
+  ub2 runcnt;
 
   ub2 spos=0,sposz=0;
   char spool[Spool];
@@ -2757,7 +2751,7 @@ static int wrfile(void)
   lfp.fd = -1;
 
   static struct bufile lhfp;
-  ub4 lhdrbuf = (kwhshlen + dun0hshlen + dun1hshlen) * 6 + nset * 32U + nstate * 16U + 0x1000U;
+  ub4 lhdrbuf = (kwmph.cnt + bltmph.cnt + dunmph.cnt) * 64 + nset * 32U + nstate * 16U + 0x1000U;
 
   lhfp.nam = lhdrname;
   lhfp.dobck = 1;
@@ -2932,7 +2926,6 @@ static int wrfile(void)
       wrenum(&sfp,bltlens,blts,"Bltin" ,nblt,hibltlen);
 
       myfprintf(&sfp,"static const ub1 hibltlen = %u;\n",hibltlen);
-      myfprintf(&sfp,"static const ub1 mibltlen = %u;\n",mibltlen);
     }
 
     if (ndun) {
@@ -2953,13 +2946,11 @@ static int wrfile(void)
 
     // keyword and bltin hashes
     if (nkwd && hikwlen > 2) {
-      hc = wrhsh(&lhfp,&sfp,"tkw",tkwds,tkwlens,nkwd < ntkwd ? tkwdmap : nil,ntkwd,kwhsh,kwhshlen,1);
+      hc = wrpool(&sfp,"kw",tkwds,tkwlens,nkwd < ntkwd ? tkwdmap : nil,ntkwd);
 
       if (sfp.top) myfprintf(&sfp,"static const ub4 kwnamhsh = 0x%x;\n\n",hc);
 
-      wrhshshift(&lhfp,"Kw",kwdhshshift);
-      myfprintf(&lhfp,"static const ub1 hikwlen = %u;\n",hikwlen);
-      myfprintf(&lhfp,"static const ub1 mikwlen = %u;\n",mikwlen);
+      wrmph(&lhfp,"tkw",&kwmph,tkwds,tkwlens);
 
       if (nkwd < ntkwd) {
         myfprintf(&lhfp,"static const ub1 kwhshmap[%u] = { ",ntkwd);
@@ -2981,22 +2972,18 @@ static int wrfile(void)
     }
     if (nblt) {
       myfprintf(&lhfp,"#define Bltcnt %u\n",nblt);
-      wrhsh(&lhfp,&sfp,"Bblt",blts,bltlens,nil,nblt,blthsh,blthshlen,1);
-      wrhshshift(&lhfp,"Blt",blthshshift);
+      wrpool(&sfp,"blt",blts,bltlens,nil,nblt);
+      wrmph(&lhfp,"Bblt",&bltmph,blts,bltlens);
     }
 
-    if (nkwd | nblt) myfprintf(&lhfp,"#define Hshseed   0x%x\n",hshseed);
-
     if (ndun) {
       myfprintf(&lhfp,"#define Duncnt %u\n",ndun);
-      wrhsh(&lhfp,&sfp,"Ddun0",duns,dunlens,nil,ndun,dun0hsh,dun0hshlen,1);
-      wrhsh(&lhfp,&sfp,"Ddun1",duns,dunlens,nil,ndun,dun1hsh,dun1hshlen,0);
-      myfprintf(&lhfp,"#define Hshd0seed  0x%x\n",d0hshseed);
-      myfprintf(&lhfp,"#define Hshd1seed  0x%x\n\n",d1hshseed);
-      wrhshshift(&lhfp,"Dn0",dun0hshshift);
-      wrhshshift(&lhfp,"Dn1",dun1hshshift);
+      wrpool(&sfp,"dun0",duns,dunlens,nil,ndun);
+      wrmph(&lhfp,"Ddun",&dunmph,duns,dunlens);
     }
 
+    if (nkwd | nblt | ndun) myfprintf(&lhfp,"#define Hshseed   0x%x\n\n",hshseed);
+
     if (havesfp) {
       info("wrote %s",shdrname);
       myfclose(&sfp);
@@ -3017,14 +3004,6 @@ static int wrfile(void)
     } else if (nkwd) myfputs(&lhfp,"#define lookupkw2(c,d) T99_count\n\n");
 #endif
 
-    if (nkwd && hikwlen > 2) {
-      wrhshlut(&lhfp,"kw",kwhshlut);
-    }
-
-    if (nblt && hibltlen > 2) {
-      wrhshlut(&lhfp,"blt",blthshlut);
-    }
-
 #if 1
     if (nblt && lobltlen < 3) {
       myfputs(&lhfp,"static inline enum Bltin lookupblt2(ub1 c,ub1 d)\n{\n");
@@ -3057,6 +3036,8 @@ static int wrfile(void)
 
     printsets(&lhfp,2);
 
+    wrrunskip(&lhfp);
+
     myfprintf(&lhfp,"#define x  %u\n\nstatic unsigned char ctab[256] = {\n  ",nsets);
     bpos = bpos2 = 0;
     for (c = 0; c < 256; c++) {
@@ -3225,7 +3206,7 @@ static int wrfile(void)
       for (s = 0; s < nsets; s++) {
         if (ctbl[s] == 0xff) ttbl[s] = ttany;
       }
-      bpos += mysnprintf(buf,bpos,blen,"\n  void *compgo%c_%s[%u] = {\n  ",passc,st0nam,nsets+1);
+      bpos += mysnprintf(buf,bpos,blen,"\n  static void * const compgo%c_%s[%u] = {\n  ",passc,st0nam,nsets+1);
 
       tkpos = 0;
       for (t = 0; t < nsets; t++) {
@@ -3292,7 +3273,18 @@ static int wrfile(void)
     }
 
     if (tktabcnt) {
-      myfprintf(&lfp,"\n  ub1 tktab_%s[%u] = { %.*s };\n\n ",st0nam,hitktab+1,tkpos,tkbuf);
+      myfprintf(&lfp,"\n  static const ub1 tktab_%s[%u] = { %.*s };\n\n ",st0nam,hitktab+1,tkpos,tkbuf);
+    }
+
+    // runs of plain self-loop chars are skipped vectorised, for states marked as having long runs
+    runcnt = tp0->dorun ? runset(ttndx,ttend,st0,loopc,dotswitch == 0,runtab) : 0;
+    if (tp0->dorun && runcnt == 0) svrb(lnx,"state %s has no run set",st0nam);
+    if (runcnt) {
+      bpos = mysnprintf(buf,0,blen,"\n  static const ub1 run_%s[32 + 256] = {\n    ",st0nam);
+      for (i = 0; i < 32; i++) bpos += mysnprintf(buf,bpos,blen,"0x%02x,",runtab[i]);
+      for (i = 0; i < 256; i++) bpos += mysnprintf(buf,bpos,blen,"%s%u%s",(i & 63) ? "" : "\n    ",runtab[32 + i],i < 255 ? "," : "");
+      myfprintf(&lfp,"%.*s }; // %u chars\n",bpos,buf,runcnt);
+      bpos = 0;
     }
 
     // state
@@ -3311,7 +3303,9 @@ static int wrfile(void)
     myfprintf(&lfp,"%.*s\n  ",bpos,buf);
     bpos = 0;
 
-    if (loopc != 0xff) bpos += mysnprintf(buf,bpos,blen,"while (sp[n] == '%s') n++; // %u \n  ",chprint(loopc),loopc);
+    if (runcnt && dotswitch == 0) bpos += mysnprintf(buf,bpos,blen,"if (run_%s[32 + sp[n + Runpeek]]) n = runskip(sp,n,run_%s);\n  ",st0nam,st0nam);
+    else if (runcnt) bpos += mysnprintf(buf,bpos,blen,"while (sp[n] == '%s') { if (sp[++n] == '%s') { n = runskip(sp,n,run_%s); break; } } // %u \n  ",chprint(loopc),chprint(loopc),st0nam,loopc);
+    else if (loopc != 0xff) bpos += mysnprintf(buf,bpos,blen,"while (sp[n] == '%s') n++; // %u \n  ",chprint(loopc),loopc);
     if (totcnt) {
       if (tp0->setN) bpos += mysnprintf(buf,bpos,blen,"N = n; ");
       bpos += mysnprintf(buf,bpos,blen,"c = sp[n%s];",minlen ? "++" : "");
@@ -55,33 +55,18 @@ static unsigned int hashalstr(const unsigned char *s,unsigned int len,unsigned i
   return h;
 }
 
-// Hash unaliged string
+// Hash unaliged string, same result as hashalstr()
 static unsigned int hashstr(const unsigned char *s,unsigned int len,unsigned int seed)
 {
 	unsigned int h = seed;
-  unsigned int i,k,m=0,len4;
-  const unsigned int *s4;
-  size_t ofs = (size_t)s & 3;
+  unsigned int i,k,m,len4 = len >> 2;
 
-  switch(ofs) {
-  case 1: m = s[2] << 16; Fallthrough
-  case 2: m ^= s[1] << 8; Fallthrough
-  case 3: m ^= s[0]; h ^= scramble(m);
-  }
-  s += 4 - ofs;
-  len -= 4 - ofs;
-  len4 = len >> 2;
-
-  if (len4) {
-    s4 = (const unsigned int *)s;
-    s += (len4 << 2);
-    i = 0;
-    do {
-      k = s4[i++];
-      h ^= scramble(k);
-      h = (h << 13) | (h >> 19);
-      h = h * 5 + 0xe6546b64;
-    } while (i < len4);
+  for (i = 0; i < len4; i++) {
+    memcpy(&k,s,4);
+    s += 4;
+    h ^= scramble(k);
+    h = (h << 13) | (h >> 19);
+    h = h * 5 + 0xe6546b64;
   }
 
   m = 0;
@@ -133,3 +118,37 @@ static inline ub4 hash32(cchar *s,ub4 len)
   ub8 h = hash64fnv(s,len,ofs64);
   return (ub4)(h ^ (h >> 32));
 }
+
+/* Minimal perfect hash as built by genlex mkmph : one slot per key
+   Keys are grouped into buckets by the low hash bits. A per-bucket displacement moves its keys to free slots
+ */
+struct mphkey {
+  ub8 w0,w1; // name words, see mphword
+  ub4 len;
+  ub4 id;
+};
+
+static inline ub4 mphslot(ub4 hc,ub4 d,ub4 n)
+{
+  ub4 h = (hc ^ (d * 0x85ebca6bU)) * 0x9e3779b1U;
+
+  return (ub4)(((ub8)h * n) >> 32);
+}
+
+// name as two words for a fixed-width compare. Reads only within the name, len > 0. Exact up to 16 chars
+static inline void mphword(const unsigned char *p,ub4 len,ub8 *w)
+{
+  ub4 a,b;
+
+  if (len >= 8) {
+    memcpy(w,p,8);
+    memcpy(w + 1,p + len - 8,8);
+  } else if (len >= 4) {
+    memcpy(&a,p,4);
+    memcpy(&b,p + len - 4,4);
+    w[0] = a; w[1] = b;
+  } else {
+    w[0] = p[0] | (ub4)p[len >> 1] << 8 | (ub4)p[len - 1] << 16;
+    w[1] = 0;
+  }
+}
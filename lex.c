@@ -38,7 +38,7 @@
 #include "base.h"
 #include "chr.h"
 
-// #include "os.h"
+#include "os.h"
 
 #include "mem.h"
 
@@ -54,6 +54,8 @@ static ub4 msgfile = Shsrc_lex;
 
 #include "util.h"
 
+#include "math.h"
+
 #include "pre.h"
 #include "lexsyn.h"
 #include "lex.h"
@@ -123,6 +125,11 @@ static inline ub4 align4(ub4 x)
   return x & 3 ? (x & ~3) + 1 : x;
 }
 
+static inline ub4 align8(ub4 x)
+{
+  return (x + 7) & ~7U;
+}
+
 static cchar *tknam(enum Token tk)
 {
   ub2 len;
@@ -222,13 +229,12 @@ static void lxinfo(ub4 ln,ub4 col,cchar *msg)
 // todo static to local
 
 // string lits
-static ub4 slit0cnt,slitlimcnt;
+static ub4 slit0cnt;
 static ub4 slitpos,slittop;
 static ub4 slitucnt,slitidlen;
 
-static ub4 *slithsh;
-static ub4 slithshlen,slithshmask,slithshcnt,slithshmis;
-static ub1 slithshbit;
+static ub8 *slithsh;
+static ub4 slithshlen,slithshmask,slithshcnt,slithshmis,slithshgrow,slithshdist;
 
 static ub8 *slitids;
 
@@ -335,61 +341,59 @@ ub4 slitstr(ub4 id,ub4 *plen)
   return pos;
 }
 
-// todo use cnt : file size
+/* string literal interner : Robin Hood open addressing, doubled when 7/8 full
+   a slot is hash.32 id.32, id 0 is free. The full hash is kept, so growing does not rehash the strings
+   all lengths are deduplicated. A new literal stays at the top of the pool, a duplicate is dropped from it
+ */
 static void mkslithash(ub4 cnt)
 {
   ub4 hlen;
-  ub4 bit = 0;
 
-  if (cnt < 16) hlen = cnt+64;
-  else if (cnt > hi20) {
-    warning("string lit count %u`",cnt);
-    cnt = hi20;
-    hlen = cnt * 2;
-  } else hlen = cnt * 4;
+  if (cnt > hi20) cnt = hi20; // grows if needed
+  hlen = max(cnt * 2,64);
 
   slithshlen = 1;
-  while (slithshlen < hlen) { slithshlen <<= 1; bit++; }
+  while (slithshlen < hlen) slithshlen <<= 1;
   slithshmask = slithshlen-1;
-  slithshbit = bit;
 
-  slithsh = alloc(slithshlen,ub4,0,"lex slit hash",nextcnt);
+  slithsh = alloc(slithshlen,ub8,0,"lex slit hash",nextcnt);
   info("%u entry slit hash",slithshlen);
 }
 
-static ub4 slitcheck(ub1 *pool,ub4 nam0,ub4 nam1,ub4 v,ub1 ctl)
+// insert absent entry, starting at slot v with probe distance d
+static void slitrhadd(ub8 e,ub4 v,ub4 d)
 {
-  ub4 x,np,id;
-  ub4 l1,len = nam1 - nam0;
-
-  if (v >= slithshlen)
-    ice(0,"slit ndx %u above %u for %.*s",v,slithshlen,len,pool+nam0);
-
-  x = slithsh[v];
-
-  if (x == 0) { // slot free - consolidate pool
-    id = ++slitucnt;
-    if (id >= slitidlen) ice(0,"slit id %u above %u",id,slitidlen);
-    slithsh[v] = id;
-    np = slitpos;
-    slitpos = nam1 + 1;
-    if (slitpos >= slittop) ice(0,"slit pos %u above top %u",nam1,slittop);
-    slithshcnt++;
-    slitids[id] = np | ((ub8)len << 32);
-    // vrb("add slit len %u pos %u '%s' id %u ctl %u",len,np,chprintn(pool+nam0,min(len,64)),id,ctl);
-    return id; // new
+  ub8 x;
+  ub4 d2;
+
+  for (;;) {
+    x = slithsh[v];
+    if (x == 0) { slithsh[v] = e; break; }
+    d2 = (v - (ub4)(x >> 32)) & slithshmask;
+    if (d2 < d) { slithsh[v] = e; e = x; d = d2; } // take from the rich
+    v = (v + 1) & slithshmask;
+    d++;
+  }
+  if (d > slithshdist) slithshdist = d;
+}
 
-  } else {
-    if (x >= slitidlen) ice(0,"slit id %u/%u above %u for v %u '%.*s'.%u",x,slitucnt,slitidlen,v,len,pool+nam0,len);
-    l1 = slitids[x] >> 32;
-    np = slitids[x] & hi32;
-    // info("v %u x %u nam0 %u top %u",v,x,nam0,slittop);
-    if (l1 == len && memcmp(pool + np,pool + nam0,len) == 0) return x;
-    else {
-      slithshmis++;
-      return 0;
-    }
+static void slitgrow(void)
+{
+  ub8 *otab = slithsh;
+  ub4 olen = slithshlen;
+  ub4 i;
+  ub8 e;
+
+  slithshlen = olen * 2;
+  slithshmask = slithshlen - 1;
+  slithsh = alloc(slithshlen,ub8,0,"lex slit hash",nextcnt);
+  slithshdist = 0;
+  for (i = 0; i < olen; i++) {
+    e = otab[i];
+    if (e) slitrhadd(e,(ub4)(e >> 32) & slithshmask,0);
   }
+  afree(otab,"lex slit hash",nextcnt);
+  slithshgrow++;
 }
 
 // get or if none insert. len > 2
@@ -397,164 +401,170 @@ static ub4 slitgetadd(ub4 fps,ub1 *pool,ub4 nam1,ub1 ctl)
 {
   ub4 nam0 = slitpos;
   ub4 len = nam1 - nam0;
-  ub4 v;
-  ub4 x,id;
-  ub4 hc,hc2;
-  ub2 lim;
+  ub4 hc,v,d,d2,x,id;
+  ub8 e;
 
   if (nam1 >= slittop) ice(0,"slit pos %u above top %u",nam1,slittop);
   pool[nam1] = 0;
-  if (len == 3) {
-    hc = hash32(pool+nam0,3);
-  } else if (len >= Slitint || slitucnt * 2 > slithshlen) { // skip if long or table loaded
-    slitpos = nam1 + 1;
-    if (slitpos >= slittop) ice(0,"slit pos %u above top %u",nam1,slittop);
-    id = ++slitucnt;
-    slitids[id] = nam0 | ((ub8)len << 32);
-    if (len > slithilen) { slithilen = len; slithipos = fps; }
-    return id;
-  } else {
-    hc = hashstr(pool+nam0,len,Hshseed);
-    hc = (hc >> slithshbit) ^ hc;
-  }
-  v = hc & slithshmask;
 
-  x = slitcheck(pool,nam0,nam1,v,ctl);
-  if (x) {
-    return x;
-  } else { // probe once with second hash
-    hc2 = hc >> slithshbit;
-    v = (v + hc2) & slithshmask;
-    if (v >= slithshlen) v -= slithshlen;
-    x = slitcheck(pool,nam0,nam1,v,ctl);
-    if (x) {
-      info("add slit %u len %u '%s'",x,len,pool + nam0);
-      return x;
-    } else {
-      slitpos = nam1 + 1; // skip dedup
-      id = ++slitucnt;
-      if (id >= slitidlen) ice(0,"slit id %u above %u",id,slitidlen);
-      slitids[id] = nam0 | ((ub8)len << 32);
-      info("add slit %u len %u '%s' pos %u",id,len,pool+nam0,nam0);
-      return id;
+  hc = hashstr(pool+nam0,len,Hshseed);
+  v = hc & slithshmask;
+  d = 0;
+
+  for (;;) {
+    e = slithsh[v];
+    if (e == 0) break;
+    d2 = (v - (ub4)(e >> 32)) & slithshmask;
+    if (d2 < d) break; // would have been here
+    if ((ub4)(e >> 32) == hc) {
+      x = (ub4)e;
+      if ((ub4)(slitids[x] >> 32) == len && memcmp(pool + (slitids[x] & hi32),pool + nam0,len) == 0) return x;
+      slithshmis++;
     }
+    v = (v + 1) & slithshmask;
+    d++;
   }
+
+  // new - consolidate pool
+  id = ++slitucnt;
+  if (id >= slitidlen) ice(0,"slit id %u above %u",id,slitidlen);
+  slitpos = nam1 + 1;
+  if (slitpos > slittop) ice(0,"slit pos %u above top %u",nam1,slittop);
+  slitids[id] = nam0 | ((ub8)len << 32);
+  if (len > slithilen) { slithilen = len; slithipos = fps; }
+  // vrb("add slit len %u pos %u '%s' id %u ctl %u",len,nam0,chprintn(pool+nam0,min(len,64)),id,ctl);
+
+  e = ((ub8)hc << 32) | id;
+  if (++slithshcnt * 8 > slithshlen * 7) {
+    slitgrow();
+    slitrhadd(e,hc & slithshmask,0);
+  } else slitrhadd(e,v,d);
+  return id;
 }
 
+/* keywords, builtins and dunders : one probe into a minimal perfect hash, then one fixed-width compare
+   genlex picks a seed giving all three tables a perfect hash. The ident hash is used for all
+ */
 #if Kwcnt > 0
-static inline enum token lookupkw(const ub1 *nam,ub1 len,ub4 hc)
+static inline enum token lookupkw(const ub1 *nam,ub4 len,ub4 hc)
 {
-  ub1 x,m;
-  ub4 ndx;
-  enum token kw;
-
-  if (len > hikwlen) return t99_count;
-  else if (len >= mikwlen) m = 0xf0;
-  else m = 0xf;
-
-  x = kwhshlut[hc & 0xff]
-      | kwhshlut[(hc >> 8) & 0xff]
-      | kwhshlut[(hc >> 16) & 0xff]
-      | kwhshlut[hc >> 24];
-
-  if ( (x & m) != m) return t99_count;
+  const struct mphkey *kp = kwmphkey + mphslot(hc,kwmphdsp[hc & Kwmphmsk],Kwmphcnt);
+  ub8 w[2];
 
-  hc = (hc >> Kwhshbit) ^ hc;
-  hc = Kwhshshift(hc);
-  ndx = hc & Kwhshmsk;
-
-  kw = kwhsh[ndx];
-  if (kw == t99_count) return t99_count;
-
-  if (tkwnamlens[kw] == len && memcmp(nam,tkwnampool + tkwnamposs[kw],len) == 0) return kw;
-  else return t99_count;
+  mphword(nam,len,w);
+  return ((w[0] ^ kp->w0) | (w[1] ^ kp->w1) | (len ^ kp->len)) ? t99_count : (enum token)kp->id;
 }
 #endif
 
 #ifdef Bltcnt
-static inline enum Bltin lookupblt(const ub1 *nam,ub2 len,ub4 hc)
+static inline enum Bltin lookupblt(const ub1 *nam,ub4 len,ub4 hc)
 {
-  ub1 ndx,x,m;
-  enum Bltin bt;
-
-  if (len > hibltlen) return B99_count;
-  else if (len >= mibltlen) m = 0xf0;
-  else m = 0xf;
-
-  x = blthshlut[hc & 0xff]
-      | blthshlut[(hc >> 8) & 0xff]
-      | blthshlut[(hc >> 16) & 0xff]
-      | blthshlut[hc >> 24];
+  const struct mphkey *kp = bltmphkey + mphslot(hc,bltmphdsp[hc & Bltmphmsk],Bltmphcnt);
+  ub8 w[2];
 
-  if ( (x & m) != m) return B99_count;
-
-  hc = (hc >> Blthshbit) ^ hc;
-  hc = Blthshshift(hc);
-  ndx = hc & Blthshmsk;
-
-  bt = blthsh[ndx];
-  if (bt == B99_count) return B99_count;
-
-  if (bltnamlens[bt] == len && memcmp(nam,bltnampool + bltnamposs[bt],len) == 0) return bt;
-  else return B99_count;
+  mphword(nam,len,w);
+  return ((w[0] ^ kp->w0) | (w[1] ^ kp->w1) | (len ^ kp->len)) ? B99_count : (enum Bltin)kp->id;
 }
 #else
   #define lookupblt(nam,len,hc) B99_count
 #endif
 
 #ifdef Duncnt
-static inline enum Dunder lookupdun(const ub1 *nam,ub2 len)
+static inline enum Dunder lookupdun(const ub1 *nam,ub4 len,ub4 hc)
 {
-  ub4 hc;
-  ub1 ndx;
-  enum Dunder dun;
+  const struct mphkey *kp = dunmphkey + mphslot(hc,dunmphdsp[hc & Dunmphmsk],Dunmphcnt);
+  ub8 w[2];
 
-  if (len > hidunlen) return D99_count;
+  mphword(nam,len,w);
+  return ((w[0] ^ kp->w0) | (w[1] ^ kp->w1) | (len ^ kp->len)) ? D99_count : (enum Dunder)kp->id;
+}
+#else
+  #define lookupdun(nam,len,hc) D99_count
+#endif
 
-  ub4 seed,mask;
-  ub2 bit;
-  const enum Dunder *hsh;
+/* ident as it would enter idtab : not a keyword, builtin or known dunder. dun for a name past __
+   Lets prelex estimate unique idents over the same set lex reports. *phc gets the hash
+ */
+bool lexidtab(const ub1 *nam,ub4 len,bool dun,ub4 *phc)
+{
+  ub4 hc = hashstr(nam,len,Hshseed);
 
-  if (*nam & 1) {
-    seed = Hshd1seed;
-    bit = Dun1hshbit;
-    mask = Dun1hshmsk;
-    hsh = dun1hsh;
-  } else {
-    seed = Hshd0seed;
-    bit = Dun0hshbit;
-    mask = Dun0hshmsk;
-    hsh = dun0hsh;
+  *phc = hc;
+  if (dun) {
+    if (len < 2) return 0;
+    return (len == 2 ? lookupdun2(nam[0],nam[1]) : lookupdun(nam,len,hc)) >= D99_count;
   }
-  // info("dun '%.*s'.%u",len,idp,len);
-  hc = hashstr(nam,len,seed);
-  hc = (hc >> bit) ^ hc;
+  return len > 2 && lookupkw(nam,len,hc) >= t99_count && lookupblt(nam,len,hc) >= B99_count;
+}
+
+static ub1 lxatox1(ub1 c)
+{
+  ub1 x;
 
-  if (*nam & 1) hc = Dn0hshshift(hc);
-  else hc = Dn1hshshift(hc);
+  if (c >= '0' && c <= '9') x = c - '0';
+  else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') x = (c | 0x20) - 'a' + 10;
+  else return 0xff;
+  return x;
+}
 
-  ndx = hc & mask;
+/* short string body : offset of the first quote q, backslash or 0 from sp+n
+   aligned loads as runskip, the source ends in a 0 within its pad
+ */
+#if defined __AVX2__
+static __attribute__((noinline,no_sanitize_address)) ub4 slitscanv(const ub1 *sp,ub4 n,ub1 q)
+{
+  const __m256i vq = _mm256_set1_epi8((char)q),vb = _mm256_set1_epi8('\\'),z = _mm256_setzero_si256();
+  const ub1 *p = sp + n;
+  const ub1 *a = (const ub1 *)((size_t)p & ~(size_t)31);
+  ub4 x = 0xffffffffU << (p - a);
+  __m256i v;
 
-  dun = hsh[ndx];
+  do {
+    v = _mm256_load_si256((const __m256i *)a);
+    x &= (ub4)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v,vq),_mm256_cmpeq_epi8(v,vb)),_mm256_cmpeq_epi8(v,z)));
+    if (x) break;
+    a += 32; x = 0xffffffffU;
+  } while (1);
+  return (ub4)(a - sp) + (ub4)__builtin_ctz(x);
+}
+#elif defined __SSE2__
+ #include <emmintrin.h>
 
-  // info("tbl %u ndx %x dun %u",*nam & 1,ndx,dun);
-  if (dun == D99_count) return D99_count;
+static __attribute__((noinline,no_sanitize_address)) ub4 slitscanv(const ub1 *sp,ub4 n,ub1 q)
+{
+  const __m128i vq = _mm_set1_epi8((char)q),vb = _mm_set1_epi8('\\'),z = _mm_setzero_si128();
+  const ub1 *p = sp + n;
+  const ub1 *a = (const ub1 *)((size_t)p & ~(size_t)15);
+  ub4 x = 0xffffU << (p - a);
+  __m128i v;
 
-  if (dunnamlens[dun] == len && memcmp(nam,dun0nampool + dunnamposs[dun],len) == 0) return dun;
-  else return D99_count;
+  do {
+    v = _mm_load_si128((const __m128i *)a);
+    x &= (ub4)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v,vq),_mm_cmpeq_epi8(v,vb)),_mm_cmpeq_epi8(v,z)));
+    if (x) break;
+    a += 16; x = 0xffffU;
+  } while (1);
+  return (ub4)(a - sp) + (ub4)__builtin_ctz(x);
 }
 #else
-  #define lookupdun(len,hc) D99_count
+static ub4 slitscanv(const ub1 *sp,ub4 n,ub1 q)
+{
+  while (sp[n] != q && sp[n] != '\\' && sp[n]) n++;
+  return n;
+}
 #endif
 
-static ub1 lxatox1(ub1 c)
+// most strings are short : first chars one by one
+static inline ub4 slitscan(const ub1 *sp,ub4 n,ub1 q)
 {
-  ub1 x;
+  ub4 e = n + 8;
+  ub1 c;
 
-  if (c >= '0' && c <= '9') x = c - '0';
-  else if (c >= 'A') x = (c | 0x20) - 'a' + 10;
-  else return 0xff;
-  return x;
+  do {
+    c = sp[n];
+    if (c == q || c == '\\' || c == 0) return n;
+  } while (++n < e);
+  return slitscanv(sp,n,q);
 }
 
 static ub4 doescx(const ub1 * restrict src,ub4 sn,ub1 *pool,ub4 *plitx,bool isbin)
@@ -579,16 +589,49 @@ static ub4 doescx(const ub1 * restrict src,ub4 sn,ub1 *pool,ub4 *plitx,bool isbi
   return sn+2;
 }
 
+// utf8 for code points up to 7fffffff, 5 and 6 byte forms as Lua
+static ub4 utf8enc(ub1 *p,ub4 x)
+{
+  ub4 n,i;
+  ub1 lead;
+
+  if (x < 0x80) { *p = (ub1)x; return 1; }
+  else if (x < 0x800) { n = 2; lead = 0xc0; }
+  else if (x < 0x10000) { n = 3; lead = 0xe0; }
+  else if (x < 0x200000) { n = 4; lead = 0xf0; }
+  else if (x < 0x4000000) { n = 5; lead = 0xf8; }
+  else { n = 6; lead = 0xfc; }
+
+  for (i = n - 1; i; i--) { p[i] = 0x80 | (x & 0x3f); x >>= 6; }
+  *p = lead | (ub1)x;
+  return n;
+}
+
+// \u{x..} as Lua, \uxxxx and \Uxxxxxxxx as Python. sn is past the u
 static ub4 doescu(const ub1 * restrict src,ub4 sn,ub1 *pool,ub4 *plitx,ub1 ctl)
 {
-  ub4 litx = *plitx;
+  ub4 x = 0,i,len;
+  ub1 d;
 
-  pool[litx] = *src;
-  switch(ctl) {
-  case 'U': serror(sn,"\\Uxx.. in  string lits at pos %u TODO",litx);
-  case 'u': serror(sn,"\\uxx.. in  string lits at pos %u TODO",litx);
+  if (ctl == Esc_u && src[sn] == '{') {
+    for (i = sn + 1; (d = lxatox1(src[i])) <= 0xf; i++) {
+      if (x >= 0x8000000) serror(sn,"\\u{%x.. above 7fffffff",x);
+      x = x << 4 | d;
+    }
+    if (i == sn + 1 || src[i] != '}') serror(sn,"missing hex digits or '}' in \\u{%x",x);
+    sn = i + 1;
+  } else {
+    len = (ctl == Esc_u) ? 4 : 8;
+    for (i = 0; i < len; i++) {
+      d = lxatox1(src[sn+i]);
+      if (d > 0xf) serror(sn,"\\%c needs %u hex digits",ctl == Esc_u ? 'u' : 'U',len);
+      x = x << 4 | d;
+    }
+    if (x > 0x7fffffff) serror(sn,"\\U%x above 7fffffff",x);
+    sn += len;
   }
-  return sn+1;
+  *plitx += utf8enc(pool + *plitx,x);
+  return sn;
 }
 
 static ub4 doescn(const ub1 * restrict src,ub4 sn,ub1 *pool,ub4 *plitx)
@@ -948,263 +991,1187 @@ static ub4 rdfid(const ub1 *p)
 
 enum Tkpart { Tp_dfp0,Tp_dfp1,Tp_tk,Tp_atr,Tp_ctl,Tp_bit,Tp_cmt,Tp_cnt };
 
-int lex(struct prelex *presp,struct lexsyn *lsp,ub8 T0)
+/* part sizing profile : per part the highest actual / estimate ratio seen, in 1/Lxpunit
+   A new high is taken as is, lower ones decay it by 1/8 per run.
+   Sizing applies it with a 1/4 margin plus Lxpslack elements, but never below the prelex estimate :
+   that is the bound lexrun relies on, it does not check parts while writing
+ */
+#define Lxpmagic 0x3170784c // Lxp1
+#define Lxpunit 4096
+#define Lxpslack 256
+
+struct lxprof {
+  ub4 magic,runs;
+  ub4 ratio[Tp_cnt];
+};
+
+static struct lxprof lxprof;
+
+static void lxprof_rd(cchar *path)
 {
-  int rv = 0;
+  ub4 nr;
+  int fd;
+
+  memset(&lxprof,0,sizeof(lxprof));
+  if (osopenseq(path,&fd)) return;
+  if (osread(fd,(char *)&lxprof,sizeof(lxprof),&nr) || nr != sizeof(lxprof) || lxprof.magic != Lxpmagic) {
+    warning("ignoring lex profile %s",path);
+    memset(&lxprof,0,sizeof(lxprof));
+  }
+  osclose(fd);
+}
 
-  ub8 T1=T0;
+static void lxprof_wr(cchar *path,const ub4 *ests,const ub4 *acts)
+{
+  char tnam[Pathname];
+  ub4 i,r,nw;
+  ub8 r8;
+  int fd;
 
-  timeit(&T1,nil);
+  for (i = 0; i < Tp_cnt; i++) {
+    if (ests[i] == 0) continue;
+    r8 = ((ub8)acts[i] * Lxpunit + ests[i] - 1) / ests[i];
+    r = (ub4)min(r8,Lxpunit * 16);
+    if (lxprof.runs && r < lxprof.ratio[i]) r = max(r,lxprof.ratio[i] - lxprof.ratio[i] / 8);
+    lxprof.ratio[i] = r;
+  }
+  lxprof.magic = Lxpmagic;
+  lxprof.runs++;
+
+  // write aside and rename, such that an interrupted run leaves the previous profile
+  mysnprintf(tnam,0,Pathname,"%s.%u",path,globs.pid);
+  fd = oscreate(tnam);
+  if (fd == -1) { warning("cannot create lex profile %s",tnam); return; }
+  oswrite(fd,(cchar *)&lxprof,sizeof(lxprof),&nw);
+  osclose(fd);
+  if (nw != sizeof(lxprof)) {
+    warning("cannot write lex profile %s",tnam);
+    osremove(tnam);
+  } else if (osrename(tnam,path)) warning("cannot rename lex profile %s",tnam);
+}
 
-  ub4 t1 = T1 / 1000;
+// corrected part size from profile
+static ub4 lxprof_nel(enum Tkpart part,ub4 est)
+{
+  ub4 r = lxprof.ratio[part];
+  ub8 nel;
+
+  if (lxprof.runs == 0 || r == 0 || est == 0) return est;
+  r += r / 4;
+  nel = ((ub8)est * r) / Lxpunit + Lxpslack;
+  return (ub4)min(max(nel,est),hi32 / 16);
+}
+
+// reset unit state for a next lex in the same run
+static void relex(void)
+{
+  if (slithsh) { afree(slithsh,"lex slit hash",nextcnt); slithsh = nil; } // kept for lexedit
+  slit0cnt = 0;
+  slitpos = slittop = slitucnt = slitidlen = 0;
+  slithshcnt = slithshmis = slithshgrow = slithshdist = 0;
+  slithilen = slithipos = 0;
+  uidcnt = uid1cnt = uid2cnt = 0;
+  id2loch1 = id2hich1 = id2chlen = 0;
+}
+
+/* A lex run covers the files along the chain from fid, or in a parallel run a single file into private buffers.
+   The latter leaves the shared id and slit tables alone : lookups are logged, and replayed in file order by lexmerge
+   Ids are interned concurrently into lxcmap on the workers. Its ids depend on thread timing,
+   lexmerge maps them to idtab ids at first use, giving the same numbering as a sequential run
+ */
+enum Lxevtyp { Ev_id,Ev_id1,Ev_slit };
+
+struct lxev {
+  ub4 a;     // atr or bit index
+  ub4 x0,x1; // id name pos and len, slit pool range, id1 char
+  ub4 dn,hc; // token index and hash, slit fpos and bit index
+  ub4 cx;    // lxcmap id, hi32 if full
+  ub1 typ;
+};
+
+static struct cmap lxcmap;
+static ub4 *lxcids; // lxcmap id to idtab id
+
+/* checkpoints for lexedit : lexer state after a token, every Lxckgap bytes and at each file start
+   The lexer can restart from lx_root at any of them. Recorded for units lexed sequentially with presp->edit
+ */
+#define Lxckgap 1024
+#define Lxlook 4       // lookahead past a token end
+#define Lxrsmax 0x4000 // give up on a relex running this far past the edit without resync
+
+struct lxck {
+  ub4 fid,n,prvN;
+  ub4 l,nlcol;
+  ub4 dn,an,cn,bn,fn0,fn1;
+  ub4 idcnt,id1cnt,id2cnt,nlcnt;
+};
+
+static struct lxck *lxcks,*lxrcks; // unit, relexed region
+static ub4 lxckcnt,lxcktop,lxrckcnt,lxrcktop;
+static ub4 *lxckord; // fid to position in file chain
+static ub4 lxordcnt,lxfilcnt,lxlastfid;
+static struct lxck lxckend; // at unit end
+
+static void *lxparts[Tp_cnt]; // token streams and their allocated counts
+static ub4 lxcaps[Tp_cnt];
+
+struct lxrun {
+  struct prelex *presp;
+  ub4 fid;
+  bool par;
+  bool one; // stop after this file
+  bool seq; // lexed in order at merge
+  bool hit; // from the token cache
+
+  ub1 *dfp0s,*dfp1s,*tks,*ctls;
+  ub2 *atrs;
+  ub8 *bits;
+  ub1 *slitpool;
+  ub1 *tkas; // token has atr, Tkpack only
+
+  struct lxev *evs;
+  ub4 evcnt;
+
+  ub4 dn,an,cn,bn,fn0,fn1;
+  ub4 l,slitpos;
+  ub4 N,prvN,prvn;
+  ub1 tk;
+  ub4 idcnt,id1cnt,id2cnt,bltcnt;
+  ub4 ilitcnt,ilit1cnt,flitcnt;
+  ub1 id2lo,id2hi;
+
+  // last file
+  struct filinf *fip;
+  const ub1 *sp;
+  ub4 slen,n;
+
+  ub1 *bas;
+  int rv;
+
+  // checkpoints : 0 none, 1 record, 2 relex
+  ub1 ckmode;
+  bool ckres; // resume after the token ending at n
+  ub4 nlcol;
+  ub4 dnb;    // token base for id values
+
+  // relex
+  ub4 ckk,cks,ckrec; // next candidate, resynced at, next region checkpoint
+  ub4 efid,edmg,edelta,ebudget,efils;
+  struct lxck ckb,ckz; // counts at resume, state at stop
+};
+
+// parallel runs start from here, such that the first token always has explicit positions
+#define Lxprvnil (hi32 - 1)
+
+// not a token : tk never set in a parallel run
+#define Lxtknil 0x3f
+
+// max file len for parallel runs : the first token start is recovered from 23 bits. Longer ones are lexed in order at merge
+#define Lxparlen ((1U << 23) - 16)
+
+static ub4 lxidev(struct lxrun *rp,ub4 N,ub2 len,ub4 hc,ub4 dn,ub4 bn)
+{
+  struct lxev *ep = rp->evs + rp->evcnt++;
+
+  ep->typ = Ev_id;
+  ep->a = bn;
+  ep->x0 = N; ep->x1 = len;
+  ep->dn = dn; ep->hc = hc;
+  ep->cx = cmapgetadd(&lxcmap,rp->sp + N,len,hc);
+  return 0;
+}
+
+static ub1 lxid1ev(struct lxrun *rp,ub1 c,ub4 an)
+{
+  struct lxev *ep = rp->evs + rp->evcnt++;
+
+  ep->typ = Ev_id1;
+  ep->a = an;
+  ep->x0 = c;
+  return 0;
+}
+
+// keep each slit in the private pool. returns next start
+static ub4 lxslitev(struct lxrun *rp,ub4 fps,ub4 nam0,ub4 nam1,ub4 an,ub4 bn)
+{
+  struct lxev *ep = rp->evs + rp->evcnt++;
+
+  ep->typ = Ev_slit;
+  ep->a = an;
+  ep->x0 = nam0; ep->x1 = nam1;
+  ep->dn = fps; ep->hc = bn;
+  rp->slitpool[nam1] = 0; // as slitgetadd, no gaps in a cached pool
+  return nam1 + 1;
+}
+
+// packed tokens : note per token whether it stored an atr, for tkpack()
+#ifdef Tkpack
+ #define tkamark() tkas[dn] = (an != tkan); tkan = an
+#else
+ #define tkamark()
+#endif
+
+static void lxckput(const struct lxck *cp)
+{
+  if (lxckcnt == lxcktop) {
+    lxcktop = max(lxcktop * 2,256);
+    lxcks = remalloc(lxcks,lxcktop * sizeof(struct lxck));
+  }
+  lxcks[lxckcnt++] = *cp;
+}
+
+static void lxckadd(struct lxck *cp,const struct lxck *dp)
+{
+  cp->dn += dp->dn; cp->an += dp->an; cp->cn += dp->cn; cp->bn += dp->bn;
+  cp->fn0 += dp->fn0; cp->fn1 += dp->fn1;
+  cp->idcnt += dp->idcnt; cp->id1cnt += dp->id1cnt; cp->id2cnt += dp->id2cnt; cp->nlcnt += dp->nlcnt;
+}
+
+/* at a checkpoint : record, or for a relex check for resync against the old checkpoints past the edit
+   In the edited file those are shifted by the edit's length change.
+   The state matches if the next token's start deltas would be the same
+   returns the pos of the next check, 0 to stop
+ */
+static ub4 lxcknxt(struct lxrun *rp,struct lxck *cp)
+{
+  const struct lxck *kp = nil;
+  ub4 k,n = cp->n,fid = cp->fid;
+  ub4 ord,nd,pd,nxt,lim;
+
+  if (rp->ckmode == 1) {
+    if (n == 0) lxckord[fid] = lxordcnt++;
+    lxckput(cp);
+    return n + Lxckgap;
+  }
+
+  lxckadd(cp,&rp->ckb); // counts are relative to the resume point
+  ord = lxckord[fid];
+  nd = fid == rp->efid ? rp->edelta : 0;
+
+  if (n == 0 && ++rp->efils > 3) { rp->rv = 2; return 0; }
+  lim = fid == rp->efid ? rp->ebudget : Lxrsmax;
+  if (n > lim) { rp->rv = 2; return 0; }
+
+  for (k = rp->ckk; k < lxckcnt; k++) { // skip the passed and damaged ones
+    kp = lxcks + k;
+    if (lxckord[kp->fid] < ord) continue;
+    if (kp->fid != fid) break;
+    if (fid == rp->efid && kp->n < rp->edmg) continue;
+    if (kp->n + nd >= n) break;
+  }
+  rp->ckk = k;
+
+  nxt = hi32;
+  if (k < lxckcnt && kp->fid == fid) {
+    pd = rp->edelta; // unit positions past the edit moved
+    if (kp->n + nd == n) {
+      if (kp->prvN + pd == cp->prvN) { rp->cks = k; rp->ckz = *cp; return 0; }
+      nxt = n + 1;
+    } else nxt = kp->n + nd;
+  }
+
+  if (n == 0 || n >= rp->ckrec) { // new checkpoints for the region
+    if (lxrckcnt < lxrcktop) lxrcks[lxrckcnt++] = *cp;
+    rp->ckrec = n + Lxckgap;
+  }
+  return min(min(nxt,rp->ckrec),lim + 1);
+}
+
+#define tkck() if (n >= ckn) { \
+    ck.fid = fid; ck.n = n; ck.prvN = prvN + ubas; ck.l = l; ck.nlcol = nlcol; \
+    ck.dn = dn; ck.an = an; ck.cn = cn; ck.bn = bn; ck.fn0 = fn0; ck.fn1 = fn1; \
+    ck.idcnt = idcnt; ck.id1cnt = id1cnt; ck.id2cnt = id2cnt; ck.nlcnt = ilitcnt + ilit1cnt + flitcnt; \
+    ckn = lxcknxt(rp,&ck); \
+    if (ckn == 0) goto lxstop; \
+  }
+
+static void lexrun(struct lxrun *rp)
+{
+  struct prelex *presp = rp->presp;
+  const bool par = rp->par;
 
   ub4 len;
   ub2 len2;
 
-  const ub1 *sp;
+  const ub1 *sp = nil;
   const ub1 *srcbas = presp->src;
-  ub4 slen = presp->srclen;
+  ub4 slen = 0;
 
   // tokens
-  enum Token tk=0,rtk;
+  enum Token tk = rp->tk;
   enum Bltin blt;
   enum Dunder dun;
 
-  ub4 tkcnt=0;
-  ub4 tacnt;
-
   ub1 ctl=0;
   ub2 atr=0;
 
-  ub4 cmt0,ncmt=0; // comment
-
-  struct mempart tkpart[Tp_cnt];
-
-  ub1 grp;
+  ub4 cmt0,cmtcnt=0; // comment
 
   // files
-  ub4 fid;
+  ub4 fid = rp->fid;
+  struct filinf *fip = nil,*fips = presp->files;
+  ub1 *segbas = nil;
+  bool cont;
+  ub8 seglen = 0;
 
   // str lits
-  ub1 *slitpool=nil;
-  ub4 slitx=0;
+  ub1 *slitpool = rp->slitpool;
+  ub4 slitx=0,slitp0 = rp->slitpos;
   ub1 slitctl=0;
+  ub4 lvl=0,lnl,lnx; // long brackets
 
   // ids
-  const ub1 *idp;
-  ub4 idcnt=0,id1cnt=0,id2cnt=0,euidcnt=0;
-
-  // kwd, bltin, dunder
-  ub4 kwcnt=0;
-  ub4 bltcnt=0;
-  ub4 duncnt=0;
-
-  // str lits
-  ub4 slitcatcnt=0;
+  ub4 idcnt=0,id1cnt=0,id2cnt=0,bltcnt=0;
+  ub1 id2lo = rp->id2lo,id2hi = rp->id2hi;
 
   // int lits
-  ub4 ilitcnt=0,ilit1cnt=0;
   ub4 ipart4;
-
-  bool litbin = 1;
-  bool litfpi=0;
-  ub1 ilitctl = 0;
+  ub4 ilitcnt=0,ilit1cnt=0;
 
   // flt lits
-  ub4 flitcnt=0;
-  ub4 fdp=0; // dot pos
-  ub2 fxp=0; // e+nn
-  bool fxs=0; // exp sign
   ub2 exdig=0;
+  ub4 flitcnt=0;
+  double fval;
 
-  // indent
-  ub2 dentst[Dent];
-  ub2 dent;
-  ub2 dentlvl=0;
-
-  // braces
-  ub4 bolvls[Depth];
-  ub1 bolvlc[Depth];
-  ub2 bolvl=0,fsxplvl=hi16;
-  ub2 colvl=0,solvl=0,rolvl=0;
-  ub2 rocnt=0,rccnt=0,cocnt=0,cccnt=0,socnt=0,sccnt=0;
-
-// line/col/dent
-  ub4 l=0;
-  ub4 nlcol=0;
-  ub4 *lntab=nil;
-  bool docol=1;
-
-  ub4 i,cnt;
+// line/col
+  ub4 l = rp->l;
+  ub4 nlcol = rp->nlcol;
+  ub4 lncnt = presp->lncnt;
 
-  ub1 c,prvc1,prvc2,signc;
+  ub1 c,prvc1,prvc2;
 
-  ub4 dn,bn = 0,dn1=0;
-  ub4 an=0,cn=0;
+  ub4 dn = rp->dn,bn = rp->bn,dn1=0;
+  ub4 an = rp->an,cn = rp->cn;
 
-  ub4 fn0=0,fn1=0;
+  ub4 fn0 = rp->fn0,fn1 = rp->fn1;
   ub4 n = 0;
-  ub4 fps,dfp;
+  const ub4 dnb = rp->dnb;
 
-  ub4 idnplen=0;
+  // checkpoints
+  struct lxck ck;
+  ub4 ckn = rp->ckmode ? 0 : hi32;
 
-  dentlvl=0;
-  memset(dentst,0,sizeof(dentst));
+#ifdef Tkpack
+  ub1 *tkas = rp->tkas;
+  ub4 tkan = an;
+#endif
 
-  ub1 t=0;
+  ub1 t=0,u;
 
-  ub1 Q = 0,orgQ = 0;
-  ub4 N = 0;
-  ub1 R0 = 0,R1 = 0,R2 = 0,R3 = 0,orgR0=0;
-  ub1 sign = 0;
-  ub4 prvN=0,prvn=0;
+  ub1 Q = 0;
+  ub4 N = rp->N;
+  ub1 R0 = 0;
+  ub4 prvN = rp->prvN,prvn = rp->prvn;
+  ub4 ubas = 0; // unit pos of the current file : positions here are relative to it. par runs stay file relative
   ub4 dfp0,dfp1;
   ub4 id=0;
   ub1 x1;
   ub4 x4;
   ub8 i8;
-  ub1 sla;
 
   ub4 hc=0;
 
   enum token kw;
-  ub4 idhilen = 0;
-
-  memset(bolvlc,0,Depth);
 
-  /* alloc slen * 1 tks + dfp0,1
-           slitatr: raw.1, q.1 lvl.3 id.1 len.2
-  */
-  ub4 lncnt    = presp->lncnt;
-  ub4 modcnt   = presp->modcnt;
-  ub4 slitncnt = presp->slitncnt;
-  ub4 slit1cnt = presp->slit1cnt;
-  ub4 slit2cnt = presp->slit2cnt;
-  ub4 slitcnt  = slitncnt + slit1cnt + slit2cnt;
+  ub1 *dfp0s = rp->dfp0s;
+  ub1 *dfp1s = rp->dfp1s;
+  ub1 *tks   = rp->tks;
+  ub2 *atrs  = rp->atrs;
+  ub1 *ctls  = rp->ctls;
+  ub8 *bits  = rp->bits;
 
-  ub4 nlitcnt = presp->nlitcnt;
+// ---------------
+nxtfil:
+// ---------------
 
-  ub4 bitcnt = presp->bitcnt;
+  fip = fips + fid;
+  if (par == 0) { // rebase, such that deltas across files are unit position deltas
+    N -= fip->pos - ubas; prvN -= fip->pos - ubas; prvn -= fip->pos - ubas;
+    ubas = fip->pos;
+  }
+  if (fip->seg) { // streamed window, map again
+    sp = mapseg(fip,fid + 1 < presp->filcnt ? fid + 1 : hi24,&segbas,&seglen);
+    if (sp == nil) { rp->rv = 1; return; }
+  } else sp = (fip->bas ? fip->bas : srcbas) + fip->src;
+  rp->sp = sp; // for id events
+  slen = fip->len;
+  n = 0;
+  cont = (fip->seg && fip->fofs); // continues previous segment
 
-  ub4 estacnt = presp->tacnt + slitcnt + nlitcnt + modcnt;
-  ub4 estkcnt = presp->tkcnt + slitcnt + nlitcnt + estacnt + 4 * modcnt;
-  ub4 cmtcnt  = presp->cmtcnt;
+  if (rp->ckres) { // relex from a checkpoint
+    rp->ckres = 0;
+    n = rp->n;
+    goto lx_root;
+  }
+  if (ckn != hi32) ckn = 0;
 
-  for (i = 0; i < Tp_cnt; i++) {
-    tkpart[i].siz = 1;
-    tkpart[i].fil = Mnofil;
-    tkpart[i].nel = estkcnt;
+  if (cont) { // entry token repeats the last one
+    dn--;
+    prvN = N; prvn = n;
+  } else if (fip->typ) {
+//    tks[dn++] = Tmodul;
+//    tks[dn++] = Tid;
+    tks[dn++] = Tco;
+//    atrs[an++] = La_mid | fip->modid;
   }
-  tkpart[Tp_ctl].fil = 0;
 
-  tkpart[Tp_atr].nel = estacnt;
-  tkpart[Tp_ctl].nel = slitcnt + nlitcnt;
-  tkpart[Tp_cmt].nel = cmtcnt;
-  tkpart[Tp_bit].nel = bitcnt;
+#undef  FLN
+#define FLN __LINE__|(Shsrc_lex1<<16)
 
-  len = min(slen / 2,estkcnt * 3);
-  tkpart[Tp_dfp0].nel = max(len,32);
-  tkpart[Tp_dfp1].nel = max(len,32);
+#include "lextab.i"
 
-  tkpart[Tp_atr].siz = 2;
-  tkpart[Tp_cmt].siz = 4;
-  tkpart[Tp_bit].siz = 8;
+#undef  FLN
+#define FLN __LINE__|(msgfile<<16)
 
-  tkpart[Tp_dfp0].dsc = "dfp0";
-  tkpart[Tp_dfp1].dsc = "dfp1";
-  tkpart[Tp_tk].dsc = "tk";
-  tkpart[Tp_atr].dsc = "atr";
-  tkpart[Tp_cmt].dsc = "cmt";
-  tkpart[Tp_ctl].dsc = "ctl";
-  tkpart[Tp_bit].dsc = "bit";
+  // come here at eof for each included file
 
-  ub1 *tkbas = allocset(tkpart,Tp_cnt,Mnofil,"lex tokens",nextcnt);
-  ub1 *dfp0s = tkpart[Tp_dfp0].ptr;
-  ub1 *dfp1s = tkpart[Tp_dfp1].ptr;
-  ub1 *tks   = tkpart[Tp_tk].ptr;
-  ub2 *atrs  = tkpart[Tp_atr].ptr;
-  ub4 *cmts  = tkpart[Tp_cmt].ptr;
-  ub1 *ctls  = tkpart[Tp_ctl].ptr;
-  ub8 *bits  = tkpart[Tp_bit].ptr;
+  if (fip->typ && (fid + 1 == presp->filcnt || fips[fid+1].seg == 0 || fips[fid+1].fofs == 0)) {
+    tks[dn++] = Tcc;
+  }
 
-  struct filinf *fip,*fips = presp->files;
+  fid = rdfid(sp+slen+1);
+  if (fip->seg) osmunmap(segbas,seglen);
+
+  if (fid != hi24 && par == 0 && rp->one == 0) goto nxtfil;
+
+lxstop:
+  rp->dn = dn; rp->an = an; rp->cn = cn; rp->bn = bn;
+  rp->fn0 = fn0; rp->fn1 = fn1;
+  rp->l = l; rp->nlcol = nlcol;
+  rp->slitpos = slitp0;
+  rp->N = N + ubas; rp->prvN = prvN + ubas; rp->prvn = prvn + ubas;
+  rp->tk = tk;
+  rp->idcnt = idcnt; rp->id1cnt = id1cnt; rp->id2cnt = id2cnt;
+  rp->bltcnt = bltcnt;
+  rp->ilitcnt = ilitcnt; rp->ilit1cnt = ilit1cnt; rp->flitcnt = flitcnt;
+  rp->id2lo = id2lo; rp->id2hi = id2hi;
+  rp->fip = fip; rp->sp = sp; rp->slen = slen; rp->n = n;
+}
 
-  if (idcnt) {
-    if (euidcnt == 0) euidcnt = idcnt;
-    mkmap(&idtab,euidcnt * 4,euidcnt * 4);
-  }
-  if (id2cnt) {
-    mkid2tab();
+static ub4 lxdfprd(const ub1 *p,ub4 *pi)
+{
+  ub4 i = *pi;
+  ub4 v = p[i++];
+
+  if (v & 0x80) { v = (v & 0x7f) | (ub4)p[i] << 7 | (ub4)p[i+1] << 15; i += 2; }
+  *pi = i;
+  return v;
+}
+
+static ub4 lxdfpwr(ub1 *p,ub4 i,ub4 d)
+{
+  if (d < 0x80) p[i++] = d;
+  else { p[i++] = (d & 0x7f) | 0x80; p[i++] = d >> 7; p[i++] = d >> 15; }
+  return i;
+}
+
+static void lxparchk(struct mempart *parts,enum Tkpart part,ub4 cnt)
+{
+  if (cnt > parts[part].nel) ice(0,"%s count %u exceeds estimate %u",parts[part].dsc,cnt,parts[part].nel);
+}
+
+// append a parallel run to the unit, renumbering ids and slits as a sequential run would have
+static void lexmerge(struct lxrun *gp,struct lxrun *rp,struct mempart *parts)
+{
+  struct filinf *fip = rp->fip;
+  const struct lxev *ep = rp->evs,*eop = ep + rp->evcnt;
+  ub1 *pool = gp->slitpool;
+  ub8 *bits = gp->bits;
+  ub4 dn0 = gp->dn,an0 = gp->an;
+  ub4 bn = gp->bn,fn0 = gp->fn0,fn1 = gp->fn1;
+  ub4 wb = 0,wf0 = 0,wf1 = 0;
+  ub4 t1,N,dfp0,dfp1,x4,cx,id,len;
+  ub1 tk,ptk;
+
+  lxparchk(parts,Tp_tk,dn0 + rp->dn + Tkpad);
+  lxparchk(parts,Tp_atr,an0 + rp->an);
+  lxparchk(parts,Tp_ctl,gp->cn + rp->cn);
+  lxparchk(parts,Tp_dfp0,fn0 + rp->fn0);
+  lxparchk(parts,Tp_dfp1,fn1 + rp->fn1);
+
+  memcpy(gp->tks + dn0,rp->tks,rp->dn);
+#ifdef Tkpack
+  memcpy(gp->tkas + dn0,rp->tkas,rp->dn);
+#endif
+  memcpy(gp->atrs + an0,rp->atrs,rp->an * 2);
+  memcpy(gp->ctls + gp->cn,rp->ctls,rp->cn);
+
+  /* each file starts with a token repeating the last one, at its last start
+     the next one has its start lexed against Lxprvnil. Run positions are file relative, the unit's from fip->pos
+   */
+  t1 = dn0 + (fip->typ ? 1 : 0);
+  dfp0 = gp->N - gp->prvN;
+  dfp1 = fip->pos - gp->prvn;
+  tk = gp->tk;
+  if (dfp0 > 1) { tk |= 0x80; fn0 = lxdfpwr(gp->dfp0s,fn0,dfp0); }
+  if (dfp1 > 1) { tk |= 0x40; fn1 = lxdfpwr(gp->dfp1s,fn1,dfp1); }
+  gp->tks[t1] = ptk = tk;
+
+  if (rp->prvN != Lxprvnil) {
+    N = lxdfprd(rp->dfp0s,&wf0) + Lxprvnil + fip->pos;
+    dfp0 = N - gp->N;
+    tk = gp->tks[t1 + 1] & 0x7f;
+    if (dfp0 > 1) { tk |= 0x80; fn0 = lxdfpwr(gp->dfp0s,fn0,dfp0); }
+    gp->tks[t1 + 1] = tk;
+    gp->prvN = rp->prvN + fip->pos; gp->prvn = rp->prvn + fip->pos;
+  } else {
+    gp->prvN = gp->N; gp->prvn = fip->pos;
   }
-  memset(id1tab,0xff,256);
+  memcpy(gp->dfp0s + fn0,rp->dfp0s + wf0,rp->fn0 - wf0); fn0 += rp->fn0 - wf0;
+  memcpy(gp->dfp1s + fn1,rp->dfp1s + wf1,rp->fn1 - wf1); fn1 += rp->fn1 - wf1;
+
+  for (; ep < eop; ep++) {
+    switch (ep->typ) {
+    case Ev_id:
+      len = ep->a - wb;
+      lxparchk(parts,Tp_bit,bn + len);
+      memcpy(bits + bn,rp->bits + wb,len * 8); bn += len; wb = ep->a;
+      cx = ep->cx;
+      if (cx == hi32) x4 = mapgetadd(&idtab,rp->sp + ep->x0,(ub2)ep->x1,ep->hc);
+      else if ( (x4 = lxcids[cx]) == 0) lxcids[cx] = x4 = mapgetadd(&idtab,rp->sp + ep->x0,(ub2)ep->x1,ep->hc);
+      if (x4 < La_idprv) break;
+      lxparchk(parts,Tp_bit,bn + 1);
+      bits[bn++] = x4 | ((ub8)(dn0 + ep->dn) << 32);
+      break;
 
-  // slits
-  ub4 sltop = presp->slittop;
+    case Ev_id1: gp->atrs[an0 + ep->a] = id1getadd((ub1)ep->x0) | La_id1;
+      break;
 
-  if (slitncnt) {
-    sltop += slitcnt; // 0-term
-    slitpool = minalloc(sltop,1,Mnofil,"lex slitpool");
-    showsiz("slit pool",sltop);
-    slittop = sltop;
-    mkslithash(slitncnt);
+    case Ev_slit:
+      len = ep->x1 - ep->x0;
+      memcpy(pool + slitpos,rp->slitpool + ep->x0,len);
+      if (len == 1 || len == 2) break;
+      id = slitgetadd(ep->dn,pool,slitpos + len,0);
+      if (id <= hi16) { gp->atrs[an0 + ep->a] = id; break; }
+      gp->atrs[an0 + ep->a] = La_slit; // as a sequential run, id in bits
+      len = ep->hc - wb;
+      lxparchk(parts,Tp_bit,bn + len + 1);
+      memcpy(bits + bn,rp->bits + wb,len * 8); bn += len; wb = ep->hc;
+      bits[bn++] = id;
+      break;
+    }
+  }
+  len = rp->bn - wb;
+  lxparchk(parts,Tp_bit,bn + len);
+  memcpy(bits + bn,rp->bits + wb,len * 8); bn += len;
+
+  gp->dn += rp->dn; gp->an += rp->an; gp->cn += rp->cn; gp->bn = bn;
+  gp->fn0 = fn0; gp->fn1 = fn1;
+  gp->l += rp->l;
+
+  // as left by the last token
+  if (rp->tk == Lxtknil) gp->tk = ptk;
+  else if (rp->tk & 0xc0) gp->tk = gp->tks[gp->dn - (fip->typ ? 2 : 1)];
+  else gp->tk = rp->tk;
+  gp->N = rp->N + fip->pos;
+
+  gp->idcnt += rp->idcnt; gp->id1cnt += rp->id1cnt; gp->id2cnt += rp->id2cnt;
+  gp->bltcnt += rp->bltcnt;
+  gp->ilitcnt += rp->ilitcnt; gp->ilit1cnt += rp->ilit1cnt; gp->flitcnt += rp->flitcnt;
+  gp->id2hi = max(gp->id2hi,rp->id2hi);
+  gp->fip = fip; gp->sp = rp->sp; gp->slen = rp->slen; gp->n = rp->n;
+}
 
-    slitidlen = slitcnt;
-    slitids = minalloc(slitidlen * 8,8,Mnofil,"lex slitids");
+struct lxjob {
+  struct lxrun *runs;
+  ub4 cnt;
+  ub4 nxt; // atomic
+};
+
+static void *lexworker(void *arg)
+{
+  struct lxjob *jp = arg;
+  ub4 i;
+
+  while ( (i = __atomic_fetch_add(&jp->nxt,1,__ATOMIC_RELAXED)) < jp->cnt) {
+    if (jp->runs[i].par && jp->runs[i].hit == 0) lexrun(jp->runs + i);
   }
+  return nil;
+}
+
+static bool lexparok(struct prelex *presp)
+{
+  if (presp->edit) return 0; // checkpoints are sequential
+  if (presp->cachedir) return 1; // cache entries are parallel runs
+  if (presp->thrcnt < 2 || presp->filcnt < 2) return 0;
+  return 1;
+}
 
-  ub4 lntabsiz = (lncnt+1) * 4;
+// lex one file in order at merge, continuing from the unit state
+static void lexseq(struct lxrun *gp,ub4 fid)
+{
+  struct lxrun sr = *gp;
+
+  sr.fid = fid;
+  sr.par = 0; sr.one = 1;
+  sr.slitpos = slitpos;
+  lexrun(&sr);
+
+  gp->rv = sr.rv;
+  gp->dn = sr.dn; gp->an = sr.an; gp->cn = sr.cn; gp->bn = sr.bn;
+  gp->fn0 = sr.fn0; gp->fn1 = sr.fn1;
+  gp->l = sr.l; gp->nlcol = sr.nlcol;
+  gp->N = sr.N; gp->prvN = sr.prvN; gp->prvn = sr.prvn;
+  gp->tk = sr.tk;
+  gp->idcnt += sr.idcnt; gp->id1cnt += sr.id1cnt; gp->id2cnt += sr.id2cnt;
+  gp->bltcnt += sr.bltcnt;
+  gp->ilitcnt += sr.ilitcnt; gp->ilit1cnt += sr.ilit1cnt; gp->flitcnt += sr.flitcnt;
+  gp->id2lo = sr.id2lo; gp->id2hi = sr.id2hi;
+  gp->fip = sr.fip; gp->sp = sr.sp; gp->slen = sr.slen; gp->n = sr.n;
+}
+
+/* token cache parts after the prelex record, see lxfhdr in pre.h
+   The parallel run of one file as lexmerge takes it : ids by position in the source, slits in the private pool
+ */
+enum Lxfpart { Lxf_run = 1,Lxf_tk,Lxf_atr,Lxf_ctl,Lxf_bit,Lxf_dfp0,Lxf_dfp1,Lxf_slit,Lxf_ev,Lxf_tka,Lxf_cnt };
+
+struct lxfrun {
+  ub4 dn,an,cn,bn,fn0,fn1;
+  ub4 l,slitpos,evcnt;
+  ub4 N,prvN,prvn;
+  ub4 idcnt,id1cnt,id2cnt,bltcnt;
+  ub4 ilitcnt,ilit1cnt,flitcnt;
+  ub4 slen,n;
+  ub1 tk,id2lo,id2hi,pad;
+};
+
+// take a cached run in place : lexmerge only reads a run. 0 if the parts do not fit
+static bool lxfuse(struct lxrun *rp,struct filinf *fip,const ub1 *sp)
+{
+  const ub1 *lxf = fip->lxf;
+  const ub4 *lens = ((const struct lxfhdr *)lxf)->lens;
+  const struct lxfrun *cp = prepart(lxf,Lxf_run);
+
+  if (lens[Lxf_run] != sizeof(struct lxfrun) || lens[Lxf_tk] != cp->dn || lens[Lxf_atr] != cp->an * 2 || lens[Lxf_ctl] != cp->cn
+      || lens[Lxf_bit] != cp->bn * 8 || lens[Lxf_dfp0] != cp->fn0 || lens[Lxf_dfp1] != cp->fn1
+      || lens[Lxf_slit] != cp->slitpos || lens[Lxf_ev] != cp->evcnt * sizeof(struct lxev) || cp->slen != fip->len) return 0;
+
+  rp->par = 1;
+  rp->hit = 1;
+  rp->tks = (ub1 *)prepart(lxf,Lxf_tk);
+  rp->atrs = (ub2 *)prepart(lxf,Lxf_atr);
+  rp->ctls = (ub1 *)prepart(lxf,Lxf_ctl);
+  rp->bits = (ub8 *)prepart(lxf,Lxf_bit);
+  rp->dfp0s = (ub1 *)prepart(lxf,Lxf_dfp0);
+  rp->dfp1s = (ub1 *)prepart(lxf,Lxf_dfp1);
+  rp->slitpool = (ub1 *)prepart(lxf,Lxf_slit);
+  rp->evs = (struct lxev *)prepart(lxf,Lxf_ev);
+  rp->tkas = (ub1 *)prepart(lxf,Lxf_tka);
+  rp->evcnt = cp->evcnt;
+
+  rp->dn = cp->dn; rp->an = cp->an; rp->cn = cp->cn; rp->bn = cp->bn;
+  rp->fn0 = cp->fn0; rp->fn1 = cp->fn1;
+  rp->l = cp->l; rp->slitpos = cp->slitpos;
+  rp->N = cp->N; rp->prvN = cp->prvN; rp->prvn = cp->prvn;
+  rp->tk = cp->tk;
+  rp->idcnt = cp->idcnt; rp->id1cnt = cp->id1cnt; rp->id2cnt = cp->id2cnt;
+  rp->bltcnt = cp->bltcnt;
+  rp->ilitcnt = cp->ilitcnt; rp->ilit1cnt = cp->ilit1cnt; rp->flitcnt = cp->flitcnt;
+  rp->id2lo = cp->id2lo; rp->id2hi = cp->id2hi;
+  rp->fip = fip; rp->sp = sp; rp->slen = cp->slen; rp->n = cp->n;
+  return 1;
+}
 
-  lntab = minalloc(lntabsiz,4,Mnofil,"lex lntab");
-  // setsrcmfile(mf,lntab,lncnt,n);
+// cache a run lexed here, with the prelex record of its file
+static void lxfwrite(struct prelex *presp,const struct lxrun *rp)
+{
+  struct lxfrun run;
+  const void *parts[Lxf_cnt];
+  ub4 lens[Lxf_cnt];
+  const struct lxev *ep;
+  struct lxev *evs,*dp;
+  ub4 i;
+
+  memset(&run,0,sizeof(run));
+  run.dn = rp->dn; run.an = rp->an; run.cn = rp->cn; run.bn = rp->bn;
+  run.fn0 = rp->fn0; run.fn1 = rp->fn1;
+  run.l = rp->l; run.slitpos = rp->slitpool ? rp->slitpos : 0; run.evcnt = rp->evcnt;
+  run.N = rp->N; run.prvN = rp->prvN; run.prvn = rp->prvn;
+  run.tk = rp->tk;
+  run.idcnt = rp->idcnt; run.id1cnt = rp->id1cnt; run.id2cnt = rp->id2cnt;
+  run.bltcnt = rp->bltcnt;
+  run.ilitcnt = rp->ilitcnt; run.ilit1cnt = rp->ilit1cnt; run.flitcnt = rp->flitcnt;
+  run.id2lo = rp->id2lo; run.id2hi = rp->id2hi;
+  run.slen = rp->slen; run.n = rp->n;
+
+  // fieldwise, such that padding and unused fields are zero
+  evs = alloc(rp->evcnt + 1,struct lxev,0,"lex cache evs",nextcnt);
+  for (i = 0; i < rp->evcnt; i++) {
+    ep = rp->evs + i; dp = evs + i;
+    dp->typ = ep->typ;
+    dp->a = ep->a; dp->x0 = ep->x0;
+    if (ep->typ != Ev_id1) { dp->x1 = ep->x1; dp->dn = ep->dn; dp->hc = ep->hc; }
+    dp->cx = hi32; // lxcmap is per process
+  }
 
-  dn = 0;
-  an = 0;
-  cn = 0;
-  bn = 0;
+  memset(parts,0,sizeof(parts));
+  memset(lens,0,sizeof(lens));
+  parts[Lxf_run] = &run; lens[Lxf_run] = sizeof(run);
+  parts[Lxf_tk] = rp->tks; lens[Lxf_tk] = rp->dn;
+  parts[Lxf_atr] = rp->atrs; lens[Lxf_atr] = rp->an * 2;
+  parts[Lxf_ctl] = rp->ctls; lens[Lxf_ctl] = rp->cn;
+  parts[Lxf_bit] = rp->bits; lens[Lxf_bit] = rp->bn * 8;
+  parts[Lxf_dfp0] = rp->dfp0s; lens[Lxf_dfp0] = rp->fn0;
+  parts[Lxf_dfp1] = rp->dfp1s; lens[Lxf_dfp1] = rp->fn1;
+  parts[Lxf_slit] = rp->slitpool; lens[Lxf_slit] = run.slitpos;
+  parts[Lxf_ev] = evs; lens[Lxf_ev] = rp->evcnt * sizeof(struct lxev);
+#ifdef Tkpack
+  parts[Lxf_tka] = rp->tkas; lens[Lxf_tka] = rp->dn;
+#endif
 
-  info("+lex %u",gettime_msec()-t1);
+  prewrcache(presp,rp->fid,parts,lens,Lxf_cnt);
+  afree(evs,"lex cache evs",nextcnt);
+}
+
+// private buffers of a parallel run, from its file len. returns the bytes taken, parts 16-aligned
+static ub8 lxrunparts(struct mempart *wparts,ub4 flen,bool slits)
+{
+  ub4 i,len = flen + 16;
+  ub8 siz = 0;
+
+  memset(wparts,0,(Tp_cnt + 3) * sizeof(struct mempart));
+  wparts[Tp_dfp0].nel = wparts[Tp_dfp1].nel = len * 3;
+  wparts[Tp_tk].nel = len;
+  wparts[Tp_atr].nel = len; wparts[Tp_atr].siz = 2;
+  wparts[Tp_ctl].nel = len;
+  wparts[Tp_bit].nel = len / 2 + 16; wparts[Tp_bit].siz = 8; // every nlit above 63 takes one
+  wparts[Tp_cmt].nel = 0;
+  wparts[Tp_cnt].nel = slits ? len * 2 : 0;
+  wparts[Tp_cnt+1].nel = len / 2 + 16; wparts[Tp_cnt+1].siz = sizeof(struct lxev);
+#ifdef Tkpack
+  wparts[Tp_cnt+2].nel = len;
+#endif
+  for (i = 0; i < Tp_cnt + 3; i++) {
+    if (wparts[i].siz == 0) wparts[i].siz = 1;
+    siz += ((ub8)wparts[i].nel * wparts[i].siz + 15) & ~15UL;
+  }
+  return siz;
+}
+
+// lex each file on its own into private buffers, then merge in file chain order
+static void lexpar(struct lxrun *gp,struct mempart *parts)
+{
+  struct prelex *presp = gp->presp;
+  struct filinf *fip,*fips = presp->files;
+  struct lxrun *rp,*runs;
+  struct mempart wparts[Tp_cnt + 3];
+  struct lxjob job;
+  ub4 fid,cnt = 0,seqcnt = 0,hitcnt = 0;
+  ub4 i,p,thr;
+  ub8 T0,T1,T2;
+  ub8 pos,buflen = 0;
+  ub1 *bas;
+  const ub1 *sp;
+
+  runs = alloc(presp->filcnt,struct lxrun,0,"lex runs",nextcnt);
 
   fid = 0;
+  do {
+    fip = fips + fid;
+    rp = runs + cnt++;
+    rp->presp = presp;
+    rp->fid = fid;
+
+    if (fip->seg || fip->len > Lxparlen) { // streamed or long : in order at merge
+      rp->seq = 1;
+      seqcnt++;
+      if (fip->seg) fid = fid + 1 < presp->filcnt ? fid + 1 : hi24; // not resident, chained in order
+      else fid = rdfid((fip->bas ? fip->bas : (const ub1 *)presp->src) + fip->src + fip->len + 1);
+      continue;
+    }
 
-// ---------------
-nxtfil:
-// ---------------
+    sp = (fip->bas ? fip->bas : (const ub1 *)presp->src) + fip->src;
+    if (fip->lxf) { // cached
+      if (lxfuse(rp,fip,sp)) {
+        hitcnt++;
+        fid = rdfid(sp + fip->len + 1);
+        continue;
+      }
+      vrb("token cache entry for %s does not fit",fip->nam);
+      osmunmap(fip->lxf,fip->lxflen);
+      fip->lxf = nil;
+    }
 
-  fip = fips + fid;
-  n = fip->pos;
-  sp = srcbas + fip->src;
-  slen = fip->len;
-  n = 0;
+    rp->par = 1;
+    rp->N = rp->prvN = Lxprvnil;
+    rp->tk = Lxtknil;
+    buflen += lxrunparts(wparts,fip->len,gp->slitpool != nil);
+
+    fid = rdfid(sp + fip->len + 1);
+  } while (fid != hi24 && cnt < presp->filcnt);
+
+  // one block for all runs, such that thousands of modules take one allocation
+  bas = buflen ? alloc(buflen,ub1,Mnofil,"lex par tokens",nextcnt) : nil;
+  pos = 0;
+  for (i = 0; i < cnt; i++) {
+    rp = runs + i;
+    if (rp->par == 0 || rp->hit) continue;
+    lxrunparts(wparts,fips[rp->fid].len,gp->slitpool != nil);
+    rp->bas = bas + pos;
+    for (p = 0; p < Tp_cnt + 3; p++) {
+      wparts[p].ptr = bas + pos;
+      pos += ((ub8)wparts[p].nel * wparts[p].siz + 15) & ~15UL;
+    }
+#ifdef Tkpack
+    memset(wparts[Tp_cnt+2].ptr,0,wparts[Tp_cnt+2].nel);
+#endif
+    rp->dfp0s = wparts[Tp_dfp0].ptr; rp->dfp1s = wparts[Tp_dfp1].ptr;
+    rp->tks = wparts[Tp_tk].ptr; rp->atrs = wparts[Tp_atr].ptr;
+    rp->ctls = wparts[Tp_ctl].ptr; rp->bits = wparts[Tp_bit].ptr;
+    rp->slitpool = wparts[Tp_cnt].ptr;
+    rp->evs = wparts[Tp_cnt+1].ptr;
+    rp->tkas = wparts[Tp_cnt+2].ptr;
+  }
 
-  if (fip->typ) {
-//    tks[dn++] = Tmodul;
-//    tks[dn++] = Tid;
-    tks[dn++] = Tco;
-//    atrs[an++] = La_mid | fip->modid;
+  mkcmap(&lxcmap,max(presp->euidcnt,64) * 2);
+  lxcids = alloc(lxcmap.itmtop,ub4,0,"lex cmap ids",nextcnt);
+
+  T0 = gettime_usec();
+  thr = min(max(presp->thrcnt,1),cnt - seqcnt - hitcnt);
+  job.runs = runs;
+  job.cnt = cnt;
+  job.nxt = 0;
+  if (thr) thr = (ub4)osrunpar(thr,lexworker,&job);
+  T1 = gettime_usec();
+
+  for (i = 0; i < cnt; i++) {
+    rp = runs + i;
+    if (rp->seq) lexseq(gp,rp->fid);
+    else if (rp->rv) gp->rv = rp->rv;
+    else lexmerge(gp,rp,parts);
+    if (gp->rv) break;
   }
+  T2 = gettime_usec();
+  info("lexed %u files on %u threads in %lu` usec, %u cached, %u in order, merged in %lu` usec",cnt - seqcnt - hitcnt,thr,T1 - T0,hitcnt,seqcnt,T2 - T1);
+  if (lxcmap.itmcnt >= lxcmap.itmtop) vrb("lex cmap full at %u ids",lxcmap.itmtop);
+  fincmap(&lxcmap);
+  afree(lxcids,"lex cmap ids",nextcnt);
+
+  for (i = 0; i < cnt; i++) {
+    rp = runs + i;
+    if (rp->hit) {
+      fip = fips + rp->fid;
+      osmunmap(fip->lxf,fip->lxflen);
+      fip->lxf = nil;
+    } else if (rp->bas && presp->cachedir && rp->rv == 0) lxfwrite(presp,rp);
+  }
+  if (bas) afree(bas,"lex par tokens",nextcnt);
+  afree(runs,"lex runs",nextcnt);
+}
 
-#undef  FLN
-#define FLN __LINE__|(Shsrc_lex1<<16)
+/* unit line table for emit : offset past each newline, files in order
+   Not kept by prelex, built here only when emit needs it
+ */
+static ub4 *lxlntab(struct prelex *presp,ub4 lncnt,ub4 n)
+{
+  struct filinf *fip;
+  const ub1 *sp;
+  ub1 *segbas = nil;
+  ub8 seglen = 0;
+  ub4 fid,l = 0;
+  ub4 *lntab = minalloc((lncnt + 2) * 4,4,Mnofil,"lex lntab");
+
+  for (fid = 0; fid < presp->filcnt; fid++) {
+    fip = presp->files + fid;
+    if (l + fip->lncnt > lncnt) break;
+    if (fip->seg) sp = mapseg(fip,fid + 1 < presp->filcnt ? fid + 1 : hi24,&segbas,&seglen);
+    else sp = (fip->bas ? fip->bas : (const ub1 *)presp->src) + fip->src;
+    if (sp == nil) break;
+    l += scannl(sp,fip->len,lntab + l,1);
+    if (fip->seg) osmunmap(segbas,seglen);
+  }
+  lntab[l] = n + 1;
+  lntab[l+1] = hi32; // ends the line walks in doemit
+  return lntab;
+}
 
-#include "lextab.i"
+#ifdef Tkpack
 
-#undef  FLN
-#define FLN __LINE__|(msgfile<<16)
+/* pack the token stream into one ub4 per token, see lexsyn.h
+   start delta from dfp0s, 0 if not stored. atr taken in order for tokens that stored one
+ */
+static void tkpack(struct lexsyn *lsp,const ub1 *tkas,ub4 atrcnt)
+{
+  const ub1 *tks = lsp->toks,*dfp0s = lsp->dfp0s;
+  const ub2 *atrs = lsp->atrs;
+  ub4 tkcnt = lsp->tkcnt;
+  ub4 *pks;
+  ub8 *pkxs;
+  ub4 ti,ai = 0,fn0 = 0,xn = 0;
+  ub4 dfp,atr;
+  ub1 tk;
+
+  pks = minalloc((tkcnt + Tkpad) * 4,4,0,"lex packed tokens");
+  pkxs = minalloc((lsp->dfp0cnt / 3 + 1) * 8,8,Mnofil,"lex packed dfp"); // escapes take 3 bytes in dfp0s
+
+  for (ti = 0; ti < tkcnt; ti++) {
+    tk = tks[ti];
+    if (tk & 0x80) {
+      dfp = dfp0s[fn0++];
+      if (dfp & 0x80) { dfp = (dfp & 0x7f) | (ub4)dfp0s[fn0] << 7 | (ub4)dfp0s[fn0+1] << 15; fn0 += 2; }
+    } else dfp = 0;
+    if (dfp >= Pk_dfpx) { pkxs[xn++] = (ub8)ti << 32 | dfp; dfp = Pk_dfpx; }
+    atr = tkas[ti] ? atrs[ai++] : 0;
+    pks[ti] = (tk & Pk_tkmsk) | dfp << Pk_dfpbit | atr << Pk_atrbit;
+  }
+  for (; ti < tkcnt + Tkpad; ti++) pks[ti] = tks[ti] & Pk_tkmsk;
+  if (ai != atrcnt) ice(0,"packed %u atrs of %u",ai,atrcnt);
 
-  // come here at eof for each included file
+  lsp->pks = pks;
+  lsp->pkxs = pkxs;
+  lsp->pkxcnt = xn;
+  info("packed %u` tokens, %u` escaped deltas, %u` atrs",tkcnt,xn,ai);
+}
 
-  if (fip->typ) {
-    tks[dn++] = Tcc;
+/* token walk as syn does : token, start delta and atr per token
+   the split streams against the packed one, repeated to reach Tkbenchcnt tokens
+   split atrs are only stored for tokens having one, taken by their own cursor as in tkpack
+ */
+#define Tkbenchcnt (64U * 1024 * 1024)
+
+static void tkbench(const struct lexsyn *lsp,const ub1 *tkas,ub4 atrcnt)
+{
+  const ub1 *tks = lsp->toks,*dfp0s = lsp->dfp0s;
+  const ub2 *atrs = lsp->atrs;
+  const ub4 *pks = lsp->pks;
+  const ub8 *pkxs = lsp->pkxs;
+  ub4 tkcnt = lsp->tkcnt;
+  ub4 ti,ai,fn0,xi,rep,reps,dfp,pk;
+  ub8 sum1 = 0,sum2 = 0,fps,T0 = 0;
+  ub1 tk;
+
+  if (tkcnt == 0) return;
+  reps = max(Tkbenchcnt / tkcnt,1);
+
+  info("token walk over %u` tokens, split %u` bytes, packed %u` bytes",tkcnt,tkcnt * 2 + atrcnt * 2 + lsp->dfp0cnt,tkcnt * 4 + lsp->pkxcnt * 8);
+
+  timeit(&T0,nil);
+  for (rep = 0; rep < reps; rep++) {
+    fn0 = ai = 0; fps = 0;
+    for (ti = 0; ti < tkcnt; ti++) {
+      tk = tks[ti];
+      if (tk & 0x80) {
+        dfp = dfp0s[fn0++];
+        if (dfp & 0x80) { dfp = (dfp & 0x7f) | (ub4)dfp0s[fn0] << 7 | (ub4)dfp0s[fn0+1] << 15; fn0 += 2; }
+      } else dfp = 0;
+      fps += dfp;
+      sum1 += (tk & 0x3f) + (tkas[ti] ? atrs[ai++] : 0) + fps;
+    }
   }
+  timeit2(&T0,tkcnt * reps,"split ` tokens in");
+
+  for (rep = 0; rep < reps; rep++) {
+    xi = 0; fps = 0;
+    for (ti = 0; ti < tkcnt; ti++) {
+      pk = pks[ti];
+      dfp = (pk >> Pk_dfpbit) & Pk_dfpx;
+      if (dfp == Pk_dfpx) dfp = (ub4)pkxs[xi++];
+      fps += dfp;
+      sum2 += (pk & Pk_tkmsk) + (pk >> Pk_atrbit) + fps;
+    }
+  }
+  timeit2(&T0,tkcnt * reps,"packed ` tokens in");
+  if (sum1 != sum2) ice(0,"token walks differ: split %lx packed %lx",sum1,sum2); // also keeps the walks
+}
+#endif
 
-  fip->pos = n;
-  fid = rdfid(sp+slen);
+int lex(struct prelex *presp,struct lexsyn *lsp,ub8 T0)
+{
+  int rv = 0;
 
-  if (fid != hi32) goto nxtfil;
+  ub8 T1=T0;
 
-// ---------------
-end:
-// ---------------
+  relex();
+
+  timeit(&T1,nil);
+
+  ub4 t1 = T1 / 1000;
+
+  ub4 len;
+  ub2 len2;
+
+  const ub1 *sp;
+  ub4 slen = presp->srclen;
+
+  // tokens
+  ub4 tkcnt=0;
+  ub4 tacnt;
+
+  ub4 ncmt=0; // comment
+
+  struct mempart tkpart[Tp_cnt];
+
+  struct lxrun run;
+
+  // str lits
+  ub1 *slitpool=nil;
+
+  // ids
+  ub4 idcnt=0,id1cnt=0,id2cnt=0,euidcnt=0;
+
+  // kwd, bltin, dunder
+  ub4 kwcnt=0;
+  ub4 bltcnt=0;
+  ub4 duncnt=0;
+
+  // str lits
+  ub4 slitcatcnt=0;
+
+  // int lits
+  ub4 ilitcnt=0,ilit1cnt=0;
+
+  // flt lits
+  ub4 flitcnt=0;
+
+  // braces
+  ub2 colvl=0,solvl=0,rolvl=0;
+  ub2 rocnt=0,cocnt=0;
+
+// line/col/dent
+  ub4 l=0;
+
+  ub4 i;
+
+  ub4 dn,bn = 0,dn1=0;
+  ub4 an=0,cn=0;
+
+  ub4 fn0=0,fn1=0;
+  ub4 n = 0;
+
+  /* alloc slen * 1 tks + dfp0,1
+           slitatr: raw.1, q.1 lvl.3 id.1 len.2
+  */
+  ub4 lncnt    = presp->lncnt;
+  ub4 modcnt   = presp->modcnt;
+  ub4 slitncnt = presp->slitncnt;
+  ub4 slit1cnt = presp->slit1cnt;
+  ub4 slit2cnt = presp->slit2cnt;
+  ub4 slitcnt  = slitncnt + slit1cnt + slit2cnt;
+
+  ub4 nlitcnt = presp->nlitcnt;
+
+  ub4 bitcnt = presp->bitcnt;
+
+  if (presp->euidcnt >= La_idprv) bitcnt += presp->idcnt; // ids above La_idprv are stored as value
+
+  ub4 estacnt = presp->tacnt + slitcnt + nlitcnt + modcnt;
+  ub4 estkcnt = presp->tkcnt + slitcnt + nlitcnt + estacnt + 4 * modcnt;
+  ub4 cmtcnt  = presp->cmtcnt;
+
+  for (i = 0; i < Tp_cnt; i++) {
+    tkpart[i].siz = 1;
+    tkpart[i].fil = Mnofil;
+    tkpart[i].nel = estkcnt;
+  }
+  tkpart[Tp_ctl].fil = 0;
+
+  tkpart[Tp_tk].nel = estkcnt + Tkpad;
+  tkpart[Tp_atr].nel = estacnt;
+  tkpart[Tp_ctl].nel = slitcnt + nlitcnt;
+  tkpart[Tp_cmt].nel = cmtcnt;
+  tkpart[Tp_bit].nel = bitcnt;
+
+  // modules prelexed on worker threads are not in src
+  for (len = i = 0; i < presp->filcnt; i++) len += presp->files[i].len;
+  len = min(max(slen,len) / 2,estkcnt * 3);
+  tkpart[Tp_dfp0].nel = max(len,32);
+  tkpart[Tp_dfp1].nel = max(len,32);
+
+  ub4 ests[Tp_cnt],acts[Tp_cnt];
+
+  if (presp->lexprof) lxprof_rd(presp->lexprof);
+  else lxprof.runs = 0;
+
+  for (i = 0; i < Tp_cnt; i++) {
+    ests[i] = tkpart[i].nel;
+    tkpart[i].nel = lxprof_nel(i,ests[i]);
+  }
+
+  tkpart[Tp_atr].siz = 2;
+  tkpart[Tp_cmt].siz = 4;
+  tkpart[Tp_bit].siz = 8;
+
+  tkpart[Tp_dfp0].dsc = "dfp0";
+  tkpart[Tp_dfp1].dsc = "dfp1";
+  tkpart[Tp_tk].dsc = "tk";
+  tkpart[Tp_atr].dsc = "atr";
+  tkpart[Tp_cmt].dsc = "cmt";
+  tkpart[Tp_ctl].dsc = "ctl";
+  tkpart[Tp_bit].dsc = "bit";
+
+  ub1 *tkbas = allocset(tkpart,Tp_cnt,Mnofil,"lex tokens",nextcnt);
+  ub1 *dfp0s = tkpart[Tp_dfp0].ptr;
+  ub1 *dfp1s = tkpart[Tp_dfp1].ptr;
+  ub1 *tks   = tkpart[Tp_tk].ptr;
+  ub2 *atrs  = tkpart[Tp_atr].ptr;
+  ub4 *cmts  = tkpart[Tp_cmt].ptr;
+  ub1 *ctls  = tkpart[Tp_ctl].ptr;
+  ub8 *bits  = tkpart[Tp_bit].ptr;
+
+#ifdef Tkpack
+  ub1 *tkas = alloc(tkpart[Tp_tk].nel,ub1,0,"lex tkas",nextcnt);
+#endif
+
+  struct filinf *fip;
+
+  euidcnt = max(presp->euidcnt,64);
+  mkmap(&idtab,euidcnt,euidcnt * 8);
+  if (id2cnt) {
+    mkid2tab();
+  }
+  memset(id1tab,0xff,256);
+
+  // slits
+  ub4 sltop = presp->slittop;
+
+  if (slitcnt) { // short ones pass through the pool too
+    sltop += slitcnt; // 0-term
+    slitpool = minalloc(sltop,1,Mnofil,"lex slitpool");
+    showsiz("slit pool",sltop);
+    slittop = sltop;
+  }
+  if (slitncnt) {
+    mkslithash(slitncnt);
+
+    slitidlen = slitcnt + 1; // ids from 1
+    slitids = minalloc(slitidlen * 8,8,Mnofil,"lex slitids");
+  }
+
+  setmsgsrc(presp->files,presp->filcnt,(const ub1 *)presp->src); // diag positions are unit positions
+
+  info("+lex %u",gettime_msec()-t1);
+
+  memset(&run,0,sizeof(run));
+  run.presp = presp;
+  run.dfp0s = dfp0s; run.dfp1s = dfp1s;
+  run.tks = tks; run.atrs = atrs; run.ctls = ctls; run.bits = bits;
+  run.slitpool = slitpool;
+  run.slitpos = slitpos;
+#ifdef Tkpack
+  run.tkas = tkas;
+#endif
+
+  lxckcnt = lxordcnt = 0;
+  if (presp->edit) {
+    run.ckmode = 1;
+    lxfilcnt = presp->filcnt;
+    lxckord = remalloc(lxckord,lxfilcnt * sizeof(ub4));
+    memset(lxckord,0xff,lxfilcnt * sizeof(ub4));
+  }
+
+  if (lexparok(presp)) lexpar(&run,tkpart);
+  else lexrun(&run);
+
+  if (run.rv) return run.rv;
+
+  dn = run.dn; an = run.an; cn = run.cn; bn = run.bn;
+  fn0 = run.fn0; fn1 = run.fn1;
+  l = run.l;
+  fip = run.fip; sp = run.sp; slen = run.slen; n = run.n;
+  idcnt = run.idcnt; id1cnt = run.id1cnt; id2cnt = run.id2cnt;
+  bltcnt = run.bltcnt;
+  ilitcnt = run.ilitcnt; ilit1cnt = run.ilit1cnt; flitcnt = run.flitcnt;
+  id2loch1 = run.id2lo; id2hich1 = run.id2hi;
 
   if (verbose) timeit2(&T1,slen,"pass 1 tokenised ` in");
 
@@ -1245,7 +2212,15 @@ end:
   showcnt("04token",tkcnt);
   showcnt("04total 1",dn1);
 
-  if (tkcnt > estkcnt) ice(n,"token count %u exceeds estimate %u",tkcnt,estkcnt);
+  acts[Tp_dfp0] = fn0; acts[Tp_dfp1] = fn1;
+  acts[Tp_tk] = tkcnt + Tkpad; acts[Tp_atr] = tacnt;
+  acts[Tp_ctl] = cn; acts[Tp_bit] = bn; acts[Tp_cmt] = ncmt;
+
+  for (i = 0; i < Tp_cnt; i++) {
+    if (presp->lexstat) info("%-4s est %9u` act %9u` alloc %9u` %3u%%",tkpart[i].dsc,ests[i],acts[i],tkpart[i].nel,ests[i] ? (ub4)((ub8)acts[i] * 100 / ests[i]) : 0);
+    if (acts[i] > tkpart[i].nel) ice(n,"%s count %u exceeds estimate %u from %u",tkpart[i].dsc,acts[i],tkpart[i].nel,ests[i]);
+  }
+  if (presp->lexprof) lxprof_wr(presp->lexprof,ests,acts);
 
   showcnt("colvl",colvl);
   showcnt("solvl",solvl);
@@ -1268,13 +2243,16 @@ end:
   showcnt("bltin",bltcnt);
   showcnt("dunder",duncnt);
 
-  if (idcnt) {
+  if (idtab.items) uidcnt = (ub4)idtab.items[0] - 1;
+
+  if (idcnt && presp->edit == 0) {
 //    info("%3u` uniq idents, est %u` max len %u",idhshcnt,euidcnt,idnmax);
 //    info("id hash table used %u` of %u` retry %u`",idhshcnt,idhshlen,idhshmis);
     finmap(&idtab);
   }
   showcnt("3 ident",idcnt);
   showcnt("3uident",uidcnt);
+  showcnt("3est uident",presp->euidcnt);
 
   showcnt("3 ident1",id1cnt);
   showcnt("3uident1",uid1cnt);
@@ -1286,8 +2264,8 @@ end:
     showcnt("3hash slit",slithshcnt);
     showcnt("3uniq slit",slitucnt);
     sinfo(slithipos,"longest slit len %u",slithilen);
-    info("slit hash table used %u` of %u` retry %u` skipped %u`",slithshcnt,slithshlen,slithshmis,slitlimcnt);
-    afree(slithsh,"lex slit hash",nextcnt);
+    info("slit hash table used %u` of %u` grown %u retry %u` max probe %u",slithshcnt,slithshlen,slithshgrow,slithshmis,slithshdist);
+    if (presp->edit == 0) { afree(slithsh,"lex slit hash",nextcnt); slithsh = nil; }
   }
   showcnt("3slit concat",slitcatcnt);
 
@@ -1315,7 +2293,6 @@ end:
   } else if (l < lncnt) {
     warning("%u :1 vs %u :2 lines",lncnt,l);
   }
-  lntab[l] = n+1;
 
   memset(tks+tkcnt,T99_eof,Tkpad);
 
@@ -1355,12 +2332,14 @@ end:
 
   lsp->nlitcnt = ilitcnt + flitcnt + ilit1cnt;
 
-  lsp->src = sp;
+  lsp->src = fip->seg ? nil : sp; // streamed source not resident
+  lsp->srclen = slen;
 
   showcnt("3token",dn);
   showcnt("3bit",bn);
 
   lsp->tkcnt = dn;
+  lsp->atrcnt = an;
   lsp->tbcnt = bn;
 
   lsp->toks = tks;
@@ -1368,6 +2347,8 @@ end:
   lsp->atrs = atrs;
   lsp->dfp0s = dfp0s;
   lsp->dfp1s = dfp1s;
+  lsp->dfp0cnt = fn0;
+  lsp->dfp1cnt = fn1;
 
   lsp->uidcnt = uidcnt;
   lsp->uid1cnt = uid1cnt;
@@ -1377,7 +2358,7 @@ end:
 
   lsp->slitpool = slitpool;
   lsp->slitcnt = slitcnt;
-  lsp->slittop = slittop;
+  lsp->slittop = slitpos; // used part, duplicates are not kept
   lsp->slithilen = max(slithilen,Slitint);
 
   lsp->cmts = cmts;
@@ -1385,19 +2366,661 @@ end:
 
   lsp->tkbas = tkbas;
 
+  if (presp->edit) { // for lexedit
+    lsp->keep = 1;
+    memset(&lxckend,0,sizeof(lxckend));
+    lxckend.l = l;
+    lxckend.dn = dn; lxckend.an = an; lxckend.cn = cn; lxckend.bn = bn;
+    lxckend.fn0 = fn0; lxckend.fn1 = fn1;
+    lxckend.idcnt = idcnt; lxckend.id1cnt = id1cnt; lxckend.id2cnt = id2cnt; lxckend.nlcnt = lsp->nlitcnt;
+    for (i = 0; i < Tp_cnt; i++) { lxparts[i] = tkpart[i].ptr; lxcaps[i] = tkpart[i].nel; }
+    lxlastfid = (ub4)(fip - presp->files);
+  }
+
+#ifdef Tkpack
+  tkpack(lsp,tkas,an);
+  if (presp->tkbench) tkbench(lsp,tkas,an);
+  afree(tkas,"lex tkas",nextcnt);
+#else
+  if (presp->tkbench) info("%s","token walk benchmark needs a packed token build, see build.sh -p");
+#endif
+
   bool emit = globs.emit & 1;
   bool dolog = globs.log & 1;
   bool pretty = 0; // globs.emit >> 15;
 
-  if (emit | pretty | dolog) doemit(lsp,lntab,emit,pretty,dolog);
+  if (emit | pretty | dolog) doemit(lsp,lxlntab(presp,lncnt,n),emit,pretty,dolog);
 
   return rv;
 }
 
+static const ub1 lxsizes[Tp_cnt] = { 1,1,1,2,1,8,4 };
+
+static void lxckcnts(const struct lxck *cp,ub4 *cnts)
+{
+  cnts[Tp_dfp0] = cp->fn0; cnts[Tp_dfp1] = cp->fn1;
+  cnts[Tp_tk] = cp->dn; cnts[Tp_atr] = cp->an; cnts[Tp_ctl] = cp->cn; cnts[Tp_bit] = cp->bn;
+  cnts[Tp_cmt] = 0;
+}
+
+// move counts from old state s to new state z
+static void lxckmov(struct lxck *cp,const struct lxck *s,const struct lxck *z)
+{
+  cp->l += z->l - s->l;
+  cp->dn += z->dn - s->dn; cp->an += z->an - s->an; cp->cn += z->cn - s->cn; cp->bn += z->bn - s->bn;
+  cp->fn0 += z->fn0 - s->fn0; cp->fn1 += z->fn1 - s->fn1;
+  cp->idcnt += z->idcnt - s->idcnt; cp->id1cnt += z->id1cnt - s->id1cnt; cp->id2cnt += z->id2cnt - s->id2cnt;
+  cp->nlcnt += z->nlcnt - s->nlcnt;
+}
+
+// prefix up to r stays, then the region of rlen, then the old suffix from s to end
+static void lxsplice(ub1 *dst,const ub1 *old,const ub1 *reg,ub4 siz,ub4 r,ub4 rlen,ub4 s,ub4 end)
+{
+  if (dst != old) memcpy(dst,old,(ub8)r * siz);
+  memmove(dst + (ub8)(r + rlen) * siz,old + (ub8)s * siz,(ub8)(end - s) * siz);
+  memcpy(dst + (ub8)r * siz,reg,(ub8)rlen * siz);
+}
+
+/* room for the slits of a relex of len bytes. New ones are added at the pool top
+   A duplicate gets its existing id, removed ones stay
+ */
+static ub1 *lxslitroom(ub1 *pool,ub4 len)
+{
+  ub4 top = slitpos + len * 2 + 64;
+  ub4 idtop = slitucnt + len / 2 + 2;
+  ub1 *np;
+  ub8 *nids;
+
+  if (slithsh == nil) mkslithash(64);
+  if (top > slittop) {
+    top = max(top,slittop * 2);
+    np = minalloc(top,1,Mnofil,"lex slitpool");
+    if (slitpos) memcpy(np,pool,slitpos);
+    pool = np;
+    slittop = top;
+  }
+  if (idtop > slitidlen) {
+    idtop = max(idtop,slitidlen * 2);
+    nids = minalloc(idtop * 8,8,Mnofil,"lex slitids");
+    if (slitidlen) memcpy(nids,slitids,(slitucnt + 1) * 8);
+    slitids = nids;
+    slitidlen = idtop;
+  }
+  return pool;
+}
+
+static int lexagain(struct prelex *presp,struct lexsyn *lsp,ub8 T0)
+{
+  if (lsp->keep) afree(lsp->tkbas,"lex tokens",nextcnt);
+  memset(lsp,0,sizeof(*lsp));
+  return lex(presp,lsp,T0);
+}
+
+/* relex after an edit of file fid : dellen bytes at pos replaced by inslen new ones. The source is already replaced, as by preupdate
+   Restarts at the last checkpoint before the edit, and stops at the first old checkpoint past it with the same lexer state.
+   Tokens outside, and the ids and slits they refer to, are kept. New ids and slits are added to the existing tables
+   The stream suffix is moved in place. id values keep the token index of their first lex, only checked by a detailed emit
+   Without checkpoints, for fid hi32 or for an edit that does not resync soon, the unit is lexed again
+ */
+int lexedit(struct prelex *presp,struct lexsyn *lsp,ub4 fid,ub4 pos,ub4 dellen,ub4 inslen,ub8 T0)
+{
+  struct filinf *fip,*fp;
+  struct lxrun run;
+  struct lxck r,s,z,e,*kp;
+  struct mempart regpart[Tp_cnt],newpart[Tp_cnt];
+  ub4 rcnt[Tp_cnt],scnt[Tp_cnt],zcnt[Tp_cnt],ocnt[Tp_cnt],ecnt[Tp_cnt];
+  ub4 i,k,lo,hi,ri,si,oe,o,cnt,len,delta;
+  const ub1 *srcbas = (const ub1 *)presp->src;
+  ub1 *regbas,*newbas = nil,*pool,*dst;
+  bool grow = 0;
+  ub8 B,T1 = T0;
+
+  timeit(&T1,nil);
+
+#ifdef Tkpack
+  fid = hi32; // packed stream is built for the unit as a whole
+#endif
+
+  if (fid >= presp->filcnt || lsp->keep == 0 || lxckcnt == 0 || presp->filcnt != lxfilcnt || lxckord[fid] == hi32) return lexagain(presp,lsp,T0);
+  for (i = 0; i < presp->filcnt; i++) {
+    if (presp->files[i].seg) return lexagain(presp,lsp,T0);
+  }
+  fip = presp->files + fid;
+  if (pos + inslen > fip->len) return lexagain(presp,lsp,T0);
+
+  // last checkpoint before the edit
+  oe = lxckord[fid];
+  lo = 0; hi = lxckcnt;
+  while (lo < hi) {
+    k = (lo + hi) / 2;
+    kp = lxcks + k;
+    o = lxckord[kp->fid];
+    if (o < oe || (o == oe && (kp->n == 0 || kp->n + Lxlook <= pos))) lo = k + 1;
+    else hi = k;
+  }
+  if (lo == 0 || lxcks[lo-1].fid != fid) return lexagain(presp,lsp,T0);
+  ri = lo - 1;
+  r = lxcks[ri];
+
+  // bound the bytes lexed, from here up to the budget in this and the next three files
+  B = (ub8)pos + inslen - r.n + 4 * Lxrsmax + 64;
+  if (B > hi32 / 8) return lexagain(presp,lsp,T0);
+
+  len = fip->len - r.n;
+  fp = fip;
+  for (i = 0; i < 3; i++) {
+    k = rdfid((fp->bas ? fp->bas : srcbas) + fp->src + fp->len + 1);
+    if (k >= presp->filcnt) break;
+    fp = presp->files + k;
+    len += fp->len;
+  }
+  pool = lxslitroom((ub1 *)lsp->slitpool,len);
+
+  for (i = 0; i < Tp_cnt; i++) {
+    regpart[i].siz = lxsizes[i];
+    regpart[i].fil = Mnofil;
+    regpart[i].nel = (ub4)B * 2 + Tkpad;
+    regpart[i].dsc = "relex";
+  }
+  regpart[Tp_dfp0].nel = regpart[Tp_dfp1].nel = (ub4)B * 3;
+  regpart[Tp_cmt].nel = 1;
+  regbas = allocset(regpart,Tp_cnt,Mnofil,"lex relex",nextcnt);
+
+  cnt = (ub4)(B / Lxckgap) + 16;
+  if (cnt > lxrcktop) {
+    lxrcktop = cnt;
+    lxrcks = remalloc(lxrcks,cnt * sizeof(struct lxck));
+  }
+  lxrckcnt = 0;
+
+  delta = inslen - dellen;
+
+  memset(&run,0,sizeof(run));
+  run.presp = presp;
+  run.dfp0s = regpart[Tp_dfp0].ptr; run.dfp1s = regpart[Tp_dfp1].ptr;
+  run.tks = regpart[Tp_tk].ptr; run.atrs = regpart[Tp_atr].ptr; run.ctls = regpart[Tp_ctl].ptr; run.bits = regpart[Tp_bit].ptr;
+  run.slitpool = pool;
+  run.slitpos = slitpos;
+
+  run.fid = fid; run.n = r.n; run.nlcol = r.nlcol; run.l = r.l;
+  run.N = run.prvN = r.prvN; run.prvn = fip->pos + r.n;
+  run.dnb = r.dn;
+
+  run.ckmode = 2; run.ckres = 1;
+  run.ckb = r;
+  run.ckk = ri + 1; run.cks = hi32; run.ckrec = r.n + Lxckgap;
+  run.efid = fid; run.edmg = pos + dellen; run.edelta = delta; run.ebudget = pos + inslen + Lxrsmax;
+
+  lexrun(&run);
+
+  if (run.rv) {
+    afree(regbas,"lex relex",nextcnt);
+    if (run.rv != 2) return run.rv;
+    info("%s edit at %u did not resync, lex all",fip->nam,pos);
+    return lexagain(presp,lsp,T0);
+  }
+
+  if (run.cks != hi32) {
+    si = run.cks;
+    s = lxcks[si];
+    z = run.ckz;
+  } else { // up to the unit end
+    si = lxckcnt;
+    s = lxckend;
+    memset(&z,0,sizeof(z));
+    z.l = run.l;
+    z.dn = run.dn; z.an = run.an; z.cn = run.cn; z.bn = run.bn; z.fn0 = run.fn0; z.fn1 = run.fn1;
+    z.idcnt = run.idcnt; z.id1cnt = run.id1cnt; z.id2cnt = run.id2cnt; z.nlcnt = run.ilitcnt + run.ilit1cnt + run.flitcnt;
+    lxckadd(&z,&r);
+  }
+  e = lxckend;
+  lxckmov(&e,&s,&z);
+
+  // streams : in place if they fit
+  lxckcnts(&r,rcnt); lxckcnts(&s,scnt); lxckcnts(&z,zcnt); lxckcnts(&lxckend,ocnt); lxckcnts(&e,ecnt);
+  ecnt[Tp_tk] += Tkpad;
+  for (i = 0; i < Tp_cnt; i++) {
+    if (ecnt[i] > lxcaps[i]) grow = 1;
+  }
+  if (grow) {
+    for (i = 0; i < Tp_cnt; i++) {
+      newpart[i].siz = lxsizes[i];
+      newpart[i].fil = Mnofil;
+      newpart[i].nel = ecnt[i] + ecnt[i] / 8 + 64;
+      newpart[i].dsc = "lex";
+    }
+    newbas = allocset(newpart,Tp_cnt,Mnofil,"lex tokens",nextcnt);
+  }
+  for (i = 0; i < Tp_cnt; i++) {
+    dst = grow ? newpart[i].ptr : lxparts[i];
+    lxsplice(dst,lxparts[i],regpart[i].ptr,lxsizes[i],rcnt[i],zcnt[i] - rcnt[i],scnt[i],ocnt[i]);
+    if (grow) { lxparts[i] = dst; lxcaps[i] = newpart[i].nel; }
+  }
+  if (grow) {
+    afree(lsp->tkbas,"lex tokens",nextcnt);
+    lsp->tkbas = newbas;
+  }
+  afree(regbas,"lex relex",nextcnt);
+  memset((ub1 *)lxparts[Tp_tk] + e.dn,T99_eof,Tkpad);
+
+  // checkpoints : the region's replace the old, the ones after are moved
+  cnt = ri + 1 + lxrckcnt + (lxckcnt - si);
+  if (cnt > lxcktop) {
+    lxcktop = cnt + cnt / 8;
+    lxcks = remalloc(lxcks,lxcktop * sizeof(struct lxck));
+  }
+  memmove(lxcks + ri + 1 + lxrckcnt,lxcks + si,(lxckcnt - si) * sizeof(struct lxck));
+  memcpy(lxcks + ri + 1,lxrcks,lxrckcnt * sizeof(struct lxck));
+  for (k = ri + 1 + lxrckcnt; k < cnt; k++) {
+    kp = lxcks + k;
+    if (kp->fid == fid) {
+      kp->nlcol = kp->nlcol >= s.n ? kp->nlcol + delta : z.nlcol;
+      kp->n += delta;
+    }
+    kp->prvN += delta; // as the unit positions of all past the edit
+    lxckmov(kp,&s,&z);
+  }
+  lxckcnt = cnt;
+  lxckend = e;
+
+  lsp->toks = lxparts[Tp_tk];
+  lsp->atrs = lxparts[Tp_atr];
+  lsp->bits = lxparts[Tp_bit];
+  lsp->dfp0s = lxparts[Tp_dfp0];
+  lsp->dfp1s = lxparts[Tp_dfp1];
+  lsp->cmts = lxparts[Tp_cmt];
+  lsp->tkcnt = e.dn;
+  lsp->atrcnt = e.an;
+  lsp->tbcnt = e.bn;
+  lsp->dfp0cnt = e.fn0;
+  lsp->dfp1cnt = e.fn1;
+
+  lsp->idcnt = e.idcnt;
+  lsp->id1cnt = e.id1cnt;
+  lsp->id2cnt = e.id2cnt;
+  lsp->nlitcnt = e.nlcnt;
+
+  uidcnt = (ub4)idtab.items[0] - 1;
+  lsp->uidcnt = uidcnt;
+  lsp->uid1cnt = uid1cnt;
+  lsp->uid2cnt = uid2cnt;
+
+  lsp->slitpool = pool;
+  lsp->slitcnt = presp->slitncnt + 2 * presp->slit1cnt + presp->slit2cnt + slit0cnt; // as lex
+  lsp->slittop = slitpos;
+  lsp->slithilen = max(slithilen,Slitint);
+
+  fp = presp->files + lxlastfid;
+  lsp->src = (fp->bas ? fp->bas : srcbas) + fp->src;
+  lsp->srclen = fp->len;
+
+  len = z.dn - r.dn;
+  info("relexed %u` tokens at %s:%u, %u` of %u` kept",len,fip->nam,pos,e.dn - len,e.dn);
+  if (verbose) timeit2(&T1,inslen,"relexed ` in");
+
+  return 0;
+}
+
+/* token stream file : lexed stream plus pools for a compile unit
+   Written with --tokens and parsed as name.lxt without the sources. The files table is informational
+   Header, then parts in Lxcpart order, each 8-aligned. Native byte order, a swapped magic does not match
+   Mapped read-only and used in place : lexsyn points into the mapping, syn unmaps it
+ */
+#define Lxcmagic 0x3163784c // Lxc1
+#define Lxcver 5
+
+struct lxchdr {
+  ub4 magic,ver;
+  ub4 lexhc; // hash of lexinfo
+  ub4 filcnt,namlen;
+  ub4 tkcnt,atrcnt,tbcnt,cmtcnt;
+  ub4 dfp0cnt,dfp1cnt;
+  ub4 slitcnt,slitucnt,slittop,slithilen;
+  ub4 nlitcnt;
+  ub4 idcnt,id1cnt,id2cnt;
+  ub4 uidcnt,uid1cnt,uid2cnt;
+  ub4 id2loch1,id2shift1,id2mask1;
+  ub4 iditmcnt,idkeylen;
+  ub4 srclen; // lsp->src, the unit source as far as resident
+  ub4 len; // total incl header
+  ub4 pad;
+};
+
+struct lxcfil {
+  ub8 mtime,len,ino,dev;
+  ub8 fofs; // of a streamed segment
+  ub4 nam,namlen;
+  ub4 pos,slen,lncnt,ln0; // unit pos and bytes, as in filinf
+  ub4 src; // offset in the src part, hi32 if not there
+  ub4 pad;
+};
+
+enum Lxcpart { Lxc_fil,Lxc_nam,Lxc_bit,Lxc_slitid,Lxc_iditm,Lxc_cmt,Lxc_atr,Lxc_tk,Lxc_dfp0,Lxc_dfp1,Lxc_slit,Lxc_idkey,Lxc_id1,Lxc_id2,Lxc_src,Lxc_cnt };
+
+static ub4 lxcparts(struct lxchdr *hp,ub4 *lens)
+{
+  ub4 i,pos = sizeof(struct lxchdr);
+
+  lens[Lxc_fil] = hp->filcnt * sizeof(struct lxcfil);
+  lens[Lxc_nam] = hp->namlen;
+  lens[Lxc_bit] = hp->tbcnt * 8;
+  lens[Lxc_slitid] = hp->slitucnt ? (hp->slitucnt + 1) * 8 : 0;
+  lens[Lxc_iditm] = hp->iditmcnt * 8;
+  lens[Lxc_cmt] = hp->cmtcnt * 4;
+  lens[Lxc_atr] = hp->atrcnt * 2;
+  lens[Lxc_tk] = hp->tkcnt + Tkpad;
+  lens[Lxc_dfp0] = hp->dfp0cnt;
+  lens[Lxc_dfp1] = hp->dfp1cnt;
+  lens[Lxc_slit] = hp->slittop;
+  lens[Lxc_idkey] = hp->idkeylen;
+  lens[Lxc_id1] = 256;
+  lens[Lxc_id2] = hp->uid2cnt * 2;
+  lens[Lxc_src] = hp->srclen;
+
+  for (i = 0; i < Lxc_cnt; i++) pos = align8(pos + lens[i]);
+  return pos;
+}
+
+// map and check a cache or stream file. nil if absent, stale or damaged
+static ub1 *lxcopen(cchar *cnam,cchar *desc,ub4 *plen)
+{
+  struct osstat ost;
+  const struct lxchdr *hp;
+  ub4 lens[Lxc_cnt];
+  ub4 len;
+  ub1 *bas;
+  int fd;
+
+  if (osfilinfo(&ost,cnam)) return nil;
+  if (ost.len < sizeof(struct lxchdr) || ost.len >= hi32) { warning("%s %s len %lu",desc,cnam,ost.len); return nil; }
+
+  fd = osopen(cnam);
+  if (fd == -1) return nil;
+  bas = osmmapfd(ost.len,fd);
+  osclose(fd);
+  if (bas == nil) return nil;
+
+  hp = (const struct lxchdr *)bas;
+  if (hp->magic != Lxcmagic || hp->ver != Lxcver || hp->lexhc != lex_hash()) {
+    vrb("%s %s stale",desc,cnam);
+    osmunmap(bas,ost.len);
+    return nil;
+  }
+  len = lxcparts((struct lxchdr *)hp,lens);
+  if (len != hp->len || len != ost.len) {
+    warning("%s %s len %u vs %u",desc,cnam,(ub4)ost.len,len);
+    osmunmap(bas,ost.len);
+    return nil;
+  }
+  *plen = len;
+  return bas;
+}
+
+/* stream files for diags, with unit positions and lines as lexed
+   sources not in the stream are mapped from disk when unchanged, as streamed segments
+ */
+static void lxcfiles(const struct lxchdr *hp,const ub1 **parts)
+{
+  const struct lxcfil *fp = (const struct lxcfil *)parts[Lxc_fil];
+  struct filinf *fip,*fips;
+  struct osstat ost;
+  ub4 i,cnt = hp->filcnt;
+
+  if (cnt == 0) return;
+  fips = fip = minalloc(cnt * (ub4)sizeof(struct filinf),8,0,"lex stream files");
+  for (i = 0; i < cnt; i++,fp++,fip++) {
+    fip->nam = (char *)parts[Lxc_nam] + fp->nam;
+    fip->pos = fp->pos; fip->len = fp->slen; fip->lncnt = fp->lncnt; fip->ln0 = fp->ln0;
+    fip->src = fp->src;
+    if (fp->src != hi32) continue;
+    if (osfilinfo(&ost,fip->nam) || ost.mtimns != fp->mtime || ost.len != fp->len) continue; // no source at hand
+    fip->seg = 1; fip->src = 0;
+    fip->fofs = fp->fofs; fip->flen = fp->len;
+  }
+  setmsgsrc(fips,cnt,parts[Lxc_src]);
+}
+
+// lsp and the pools point into the mapping
+static void lxcuse(ub1 *bas,ub4 len,const ub1 **parts,struct lexsyn *lsp)
+{
+  const struct lxchdr *hp = (const struct lxchdr *)bas;
+
+  lsp->tkcnt = hp->tkcnt;
+  lsp->atrcnt = hp->atrcnt;
+  lsp->tbcnt = hp->tbcnt;
+  lsp->cmtcnt = hp->cmtcnt;
+  lsp->toks = parts[Lxc_tk];
+  lsp->atrs = (const ub2 *)parts[Lxc_atr];
+  lsp->bits = (const ub8 *)parts[Lxc_bit];
+  lsp->cmts = (const ub4 *)parts[Lxc_cmt];
+  lsp->dfp0s = parts[Lxc_dfp0];
+  lsp->dfp1s = parts[Lxc_dfp1];
+  lsp->dfp0cnt = hp->dfp0cnt;
+  lsp->dfp1cnt = hp->dfp1cnt;
+  lsp->tkbas = bas;
+  lsp->tkmaplen = len;
+
+  lsp->src = (cchar *)parts[Lxc_src];
+  lsp->srclen = hp->srclen;
+  lxcfiles(hp,parts); // diag positions as for lex
+
+  // pools as used by idnam() and slitstr()
+  slitucnt = hp->slitucnt;
+  slitidlen = slitucnt + 1;
+  slittop = hp->slittop;
+  slitids = (ub8 *)parts[Lxc_slitid];
+
+  memset(&idtab,0,sizeof(idtab));
+  idtab.items = (ub8 *)parts[Lxc_iditm];
+  idtab.keys = (ub1 *)parts[Lxc_idkey];
+  idtab.keypos = hp->idkeylen;
+
+  memcpy(id1inv,parts[Lxc_id1],256);
+  id2nams = (ub2 *)parts[Lxc_id2];
+  id2loch1 = hp->id2loch1;
+  id2shift1 = hp->id2shift1;
+  id2mask1 = hp->id2mask1;
+
+  uidcnt = hp->uidcnt;
+  uid1cnt = hp->uid1cnt;
+  uid2cnt = hp->uid2cnt;
+
+  lsp->slitpool = parts[Lxc_slit];
+  lsp->slitcnt = hp->slitcnt;
+  lsp->slittop = hp->slittop;
+  lsp->slithilen = hp->slithilen;
+  lsp->nlitcnt = hp->nlitcnt;
+
+  lsp->idtab = &idtab;
+  lsp->idcnt = hp->idcnt;
+  lsp->id1cnt = hp->id1cnt;
+  lsp->id2cnt = hp->id2cnt;
+  lsp->uidcnt = hp->uidcnt;
+  lsp->uid1cnt = hp->uid1cnt;
+  lsp->uid2cnt = hp->uid2cnt;
+}
+
+static void lxcsplit(ub1 *bas,const ub1 **parts)
+{
+  ub4 lens[Lxc_cnt];
+  ub4 i,pos = sizeof(struct lxchdr);
+
+  lxcparts((struct lxchdr *)bas,lens);
+  for (i = 0; i < Lxc_cnt; i++) {
+    parts[i] = bas + pos;
+    pos = align8(pos + lens[i]);
+  }
+}
+
+// 0 on success. A token stream as written by lexstream_wr, used as is : its sources need not exist
+int lexstream_rd(cchar *path,struct lexsyn *lsp)
+{
+  const struct lxchdr *hp;
+  const ub1 *parts[Lxc_cnt];
+  ub4 len;
+  ub1 *bas;
+
+#ifdef Tkpack
+  error("%s","no token streams in packed token build");
+  return 1;
+#endif
+
+  bas = lxcopen(path,"token stream",&len);
+  if (bas == nil) { error("%s is not a token stream of this lexer",path); return 1; }
+  hp = (const struct lxchdr *)bas;
+  lxcsplit(bas,parts);
+
+  lxcuse(bas,len,parts,lsp);
+
+  info("token stream %s : %u files, %u` tokens in %u`B",path,hp->filcnt,hp->tkcnt,len);
+  return 0;
+}
+
+// write stream file cnam. Failures only warn
+static void lxcwrite(cchar *cnam,cchar *desc,struct prelex *presp,struct lexsyn *lsp)
+{
+  char tnam[Pathname];
+  struct osstat ost;
+  struct lxchdr hdr;
+  struct lxcfil *fp;
+  struct filinf *fip = presp->files;
+  ub4 lens[Lxc_cnt];
+  const void *parts[Lxc_cnt];
+  ub4 i,pos,len,plen,namlen=0;
+  ub1 *bas;
+  const ub1 *sp,*srcp = (const ub1 *)lsp->src;
+  char *nams;
+  unsigned long nw;
+  int fd;
+
+  for (i = 0; i < presp->filcnt; i++) namlen += (ub4)strlen(fip[i].nam) + 1;
+
+  memset(&hdr,0,sizeof(hdr));
+  hdr.magic = Lxcmagic;
+  hdr.ver = Lxcver;
+  hdr.lexhc = lex_hash();
+  hdr.filcnt = presp->filcnt;
+  hdr.namlen = namlen;
+  hdr.tkcnt = lsp->tkcnt;
+  hdr.atrcnt = lsp->atrcnt;
+  hdr.tbcnt = lsp->tbcnt;
+  hdr.cmtcnt = lsp->cmtcnt;
+  hdr.dfp0cnt = lsp->dfp0cnt;
+  hdr.dfp1cnt = lsp->dfp1cnt;
+  hdr.slitcnt = lsp->slitcnt;
+  hdr.slitucnt = slitids ? slitucnt : 0;
+  hdr.slittop = lsp->slitpool ? lsp->slittop : 0;
+  hdr.slithilen = lsp->slithilen;
+  hdr.nlitcnt = lsp->nlitcnt;
+  hdr.idcnt = lsp->idcnt;
+  hdr.id1cnt = lsp->id1cnt;
+  hdr.id2cnt = lsp->id2cnt;
+  hdr.uidcnt = lsp->uidcnt;
+  hdr.uid1cnt = lsp->uid1cnt;
+  hdr.uid2cnt = id2nams ? lsp->uid2cnt : 0;
+  hdr.id2loch1 = id2loch1;
+  hdr.id2shift1 = id2shift1;
+  hdr.id2mask1 = id2mask1;
+  hdr.iditmcnt = idtab.items ? (ub4)idtab.items[0] : 0;
+  hdr.idkeylen = idtab.keys ? idtab.keypos : 0;
+  hdr.srclen = lsp->src ? lsp->srclen : 0;
+
+  len = lxcparts(&hdr,lens);
+  hdr.len = len;
+
+  bas = alloc(len,ub1,0,"lex cache",nextcnt);
+
+  // file table
+  fp = (struct lxcfil *)(bas + sizeof(hdr));
+  nams = (char *)fp + align8(lens[Lxc_fil]);
+  pos = 0;
+  for (i = 0; i < hdr.filcnt; i++,fp++,fip++) {
+    plen = (ub4)strlen(fip->nam);
+    if (osfilinfo(&ost,fip->nam)) { afree(bas,"lex cache",nextcnt); return; }
+    if (ost.mtimns != fip->mtime || ost.len != fip->flen) { // changed while compiling
+      vrb("not writing %s %s: %s changed",desc,cnam,fip->nam);
+      afree(bas,"lex cache",nextcnt);
+      return;
+    }
+    fp->mtime = ost.mtimns;
+    fp->len = ost.len;
+    fp->ino = ost.ino;
+    fp->dev = ost.dev;
+    fp->fofs = fip->fofs;
+    fp->pos = fip->pos; fp->slen = fip->len; fp->lncnt = fip->lncnt; fp->ln0 = fip->ln0;
+    sp = fip->seg ? nil : (fip->bas ? fip->bas : (const ub1 *)presp->src) + fip->src;
+    if (sp && sp >= srcp && sp + fip->len <= srcp + hdr.srclen) fp->src = (ub4)(sp - srcp);
+    else fp->src = hi32;
+    fp->nam = pos;
+    fp->namlen = plen;
+    memcpy(nams + pos,fip->nam,plen + 1);
+    pos += plen + 1;
+  }
+
+  parts[Lxc_fil] = nil; parts[Lxc_nam] = nil; // already in place
+  parts[Lxc_bit] = lsp->bits;
+  parts[Lxc_slitid] = slitids;
+  parts[Lxc_iditm] = idtab.items;
+  parts[Lxc_cmt] = lsp->cmts;
+  parts[Lxc_atr] = lsp->atrs;
+  parts[Lxc_tk] = lsp->toks;
+  parts[Lxc_dfp0] = lsp->dfp0s;
+  parts[Lxc_dfp1] = lsp->dfp1s;
+  parts[Lxc_slit] = lsp->slitpool;
+  parts[Lxc_idkey] = idtab.keys;
+  parts[Lxc_id1] = id1inv;
+  parts[Lxc_id2] = id2nams;
+  parts[Lxc_src] = lsp->src;
+
+  memcpy(bas,&hdr,sizeof(hdr));
+  pos = sizeof(hdr);
+  for (i = 0; i < Lxc_cnt; i++) {
+    if (parts[i] && lens[i]) memcpy(bas + pos,parts[i],lens[i]);
+    pos = align8(pos + lens[i]);
+  }
+
+  // write aside and rename, such that readers never see a partial entry
+  mysnprintf(tnam,0,Pathname,"%s.%u",cnam,globs.pid);
+  fd = oscreate(tnam);
+  if (fd == -1) { warning("cannot create %s %s",desc,tnam); afree(bas,"lex cache",nextcnt); return; }
+  if (oswrite8(fd,(cchar *)bas,len,&nw) || nw != len) {
+    warning("cannot write %s %s",desc,tnam);
+    osclose(fd);
+    osremove(tnam);
+  } else {
+    osclose(fd);
+    if (osrename(tnam,cnam)) warning("cannot rename %s %s",desc,tnam);
+    else vrb("wrote %s %s %u`B",desc,cnam,len);
+  }
+  afree(bas,"lex cache",nextcnt);
+}
+
+// token stream to parse elsewhere, see lexstream_rd
+void lexstream_wr(cchar *path,struct prelex *presp,struct lexsyn *lsp)
+{
+#ifdef Tkpack
+  warning("%s","no token streams in packed token build");
+  return;
+#endif
+
+  lxcwrite(path,"token stream",presp,lsp);
+}
+
 cchar *lex_info(void) {
   return lexinfo;
 }
 
+// key for cached and streamed tokens
+ub4 lex_hash(void)
+{
+  ub4 hc = hashstr((const ub1 *)lexinfo,(ub4)sizeof(lexinfo),0);
+
+#ifdef Tkpack
+  hc ^= 1; // cache entries hold tkas
+#endif
+  return hc;
+}
+
 void inilex(void)
 {
   ub4 hc,i;
@@ -1405,6 +3028,7 @@ void inilex(void)
   verbose = globs.msglvl >= Vrb;
 
   sassert(sizeof(esctab) == 128,"short enums required");
+  sassert(Lxf_cnt <= Lxfparts,"token cache parts");
 
   genmsgfln(0,Info,"%s\n",lexinfo);
 
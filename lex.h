@@ -20,9 +20,15 @@
  */
 
 extern int lex(struct prelex *presp,struct lexsyn *lsp,ub8 T0);
+extern int lexedit(struct prelex *presp,struct lexsyn *lsp,ub4 fid,ub4 pos,ub4 dellen,ub4 inslen,ub8 T0);
+
+extern int lexstream_rd(cchar *path,struct lexsyn *lsp);
+extern void lexstream_wr(cchar *path,struct prelex *presp,struct lexsyn *lsp);
 
 extern void inilex(void);
 extern cchar *lex_info(void);
+extern bool lexidtab(const ub1 *nam,ub4 len,bool dun,ub4 *phc);
+extern ub4 lex_hash(void);
 
 #define Idlen 96
 
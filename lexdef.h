@@ -1,138 +1,228 @@
 /* lexdef.h - lexer definitions
 
-   generated by genlex 0.1.0-alpha  3 Oct 2022  5:12
+   generated by genlex 0.1.0-alpha 17 Oct 2026  3:00
 
-   from lua.lex 0.1.0  3 Oct 2022  5:14 lua
+   from lua.lex 0.1.0 17 Oct 2026  3:00 lua
    options: code yes  tokens yes
  */
 static const char specnam[] = "lua.lex";
 
-static const char lexinfo[] = "lua.lex 0.1.0   3 Oct 2022  5:14 lua  code yes  tokens yes";
+static const char lexinfo[] = "lua.lex 0.1.0  17 Oct 2026  3:00 lua  code yes  tokens yes";
 
 #define Cclen 4
 
-#define Kwhshmsk 63
-#define Kwhshbit  6
+#define Kwmphcnt 18
+#define Kwmphmsk 3
 
-#define x t99_count
+static const ub2 kwmphdsp[4] = {
+  147,2,10695,8
+};
 
-static const ub1 kwhsh[64] = {
-  x  ,x  ,x  ,x  ,x  ,x  ,2  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ...... elseif.........
-  19 ,x  ,4  ,x  ,x  ,x  ,3  ,1  ,13 ,20 ,x  ,x  ,x  ,7  ,x  ,x  , //  break. false... end else repeat continue... goto..
-  x  ,18 ,x  ,6  ,x  ,x  ,16 ,10 ,x  ,5  ,14 ,x  ,x  ,x  ,x  ,x  , // . while. function.. true local. for return.....
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,11 ,15 ,17 ,12 ,x  ,x   // .......... nil then until not..
-  };
-#undef x
+static const struct mphkey kwmphkey[18] = {
+  { 0x736c6166,0x65736c61,5,4 }, // false
+  { 0x65756e69746e6f63,0x65756e69746e6f63,8,20 }, // continue
+  { 0x6c696e,0x0,3,11 }, // nil
+  { 0x69746e75,0x6c69746e,5,17 }, // until
+  { 0x65736c65,0x66696573,6,2 }, // elseif
+  { 0x726f66,0x0,3,5 }, // for
+  { 0x6e656874,0x6e656874,4,15 }, // then
+  { 0x65757274,0x65757274,4,16 }, // true
+  { 0x75746572,0x6e727574,6,14 }, // return
+  { 0x6f746f67,0x6f746f67,4,7 }, // goto
+  { 0x6e6f6974636e7566,0x6e6f6974636e7566,8,6 }, // function
+  { 0x61636f6c,0x6c61636f,5,10 }, // local
+  { 0x746f6e,0x0,3,12 }, // not
+  { 0x61657262,0x6b616572,5,19 }, // break
+  { 0x65706572,0x74616570,6,13 }, // repeat
+  { 0x6c696877,0x656c6968,5,18 }, // while
+  { 0x646e65,0x0,3,3 }, // end
+  { 0x65736c65,0x65736c65,4,1 }  // else
+};
 
-#define Kwhshshift(h) h >> 5
-static const ub1 hikwlen = 8;
-static const ub1 mikwlen = 5;
 static const ub1 kwhshmap[21] = { 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,19 }; // token to Token
 
 #define Bltcnt 139
-#define Blthshmsk 1023
-#define Blthshbit  10
-
-#define x B99_count
-
-static const ub1 blthsh[1024] = {
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,85 ,111,x  ,x  ,x  ,x  ,x  ,x  , // ........ huge file......
-  x  ,73 ,x  ,x  ,x  ,77 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // . sort... asin..........
-  x  ,x  ,75 ,x  ,x  ,x  ,109,10 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // .. abs... tmpfile next........
-  x  ,x  ,x  ,x  ,130,x  ,x  ,x  ,134,x  ,x  ,74 ,91 ,x  ,x  ,x  , // .... getupvalue... setupvalue.. math modf...
-  88 ,x  ,41 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,13 , //  maxinteger. path............ print
-  x  ,78 ,x  ,x  ,x  ,x  ,61 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,81 , // . atan.... unpack........ deg
-  x  ,x  ,x  ,5  ,3  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,22 ,x  , // ... error collectgarbage......... type.
-  x  ,x  ,x  ,x  ,x  ,37 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,38 , // ..... config......... cpath
-  119,x  ,124,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , //  exit. tmpname.............
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ................
-  20 ,x  ,x  ,x  ,x  ,x  ,x  ,132,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , //  tonumber...... sethook........
-  21 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , //  tostring...............
-  x  ,x  ,102,72 ,122,31 ,48 ,x  ,x  ,x  ,x  ,25 ,2  ,x  ,x  ,79 , // .. flush remove setlocale running dump.... xpcall assert.. ceil
-  x  ,34 ,x  ,x  ,x  ,x  ,x  ,x  ,19 ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // . yield...... setmetatable.......
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,32 ,x  ,x  ,x  ,x  , // ........... status....
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,138,44 ,89 ,x  ,x  ,x  ,x  ,82 ,x  , // ....... upvaluejoin searchpath min.... exp.
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,103,x  ,113,x  ,x  ,x  ,x  ,x  , // ........ input. setvbuf.....
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ................
-  x  ,x  ,x  ,x  ,x  ,x  ,69 ,x  ,x  ,45 ,9  ,x  ,x  ,x  ,x  ,x  , // ...... concat.. string loadfile.....
-  x  ,x  ,x  ,x  ,x  ,70 ,x  ,x  ,x  ,x  ,126,x  ,x  ,x  ,x  ,x  , // ..... insert.... gethook.....
-  x  ,x  ,x  ,96 ,x  ,x  ,x  ,x  ,x  ,94 ,x  ,x  ,55 ,x  ,x  ,x  , // ... sin..... random.. match...
-  x  ,x  ,x  ,x  ,x  ,x  ,52 ,x  ,x  ,x  ,x  ,x  ,x  ,33 ,x  ,57 , // ...... gsub...... wrap. packsize
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,6  ,x  ,108,x  ,x  ,x  ,x  ,x  , // ........ getmetatable. read.....
-  84 ,x  ,x  ,x  ,x  ,60 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,83 ,x  , //  fmod.... sub........ flor.
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ................
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,125,x  ,x  ,28 ,x  , // ........... debug.. create.
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,14 ,x  ,x  ,x  ,x  ,x  ,104,x  ,137, // ....... rawequalk..... lines. upvalueid
-  x  ,x  ,x  ,120,105,x  ,x  ,x  ,17 ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ... getenv open... rawset.......
-  x  ,x  ,x  ,x  ,x  ,53 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,87 ,x  ,x  , // ..... len....... max..
-  110,x  ,x  ,x  ,x  ,x  ,x  ,29 ,80 ,x  ,x  ,x  ,x  ,x  ,x  ,x  , //  write...... isyieldable cos.......
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ................
-  36 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , //  package...............
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,54 ,x  ,x  ,x  ,x  ,x  , // .......... lower.....
-  x  ,x  ,x  ,x  ,24 ,115,x  ,x  ,x  ,x  ,67 ,x  ,71 ,x  ,x  ,x  , // .... warn clock.... offset. move...
-  30 ,x  ,x  ,x  ,x  ,65 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,50 , //  resume.... codes......... format
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,112,x  , // .............. seek.
-  x  ,x  ,x  ,x  ,8  ,x  ,x  ,x  ,46 ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // .... load... byte.......
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,118,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ........ execute.......
-  x  ,x  ,x  ,x  ,x  ,x  ,100,x  ,x  ,106,x  ,x  ,x  ,x  ,x  ,x  , // ...... ult.. output......
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ................
-  x  ,x  ,62 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // .. upper.............
-  x  ,x  ,x  ,x  ,x  ,128,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ..... getlocal..........
-  x  ,x  ,131,x  ,11 ,x  ,x  ,x  ,47 ,x  ,x  ,x  ,x  ,98 ,x  ,x  , // .. getuservale. pairs... char.... tan..
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,116,x  ,x  ,x  ,x  , // ........... date....
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,135,x  ,123,x  ,x  ,x  ,x  ,x  ,x  , // ....... setuservalue. time......
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,12 ,x  ,7  ,x  ,x  ,x  ,99 , // ......... pcall. ipairs... tointeger
-  x  ,66 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,129,x  , // . codepoint............ getregistry.
-  133,x  ,x  ,x  ,x  ,x  ,63 ,x  ,x  ,x  ,x  ,49 ,x  ,x  ,x  ,x  , //  setlocal..... utf8.... find....
-  x  ,x  ,x  ,16 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,107,x  ,x  ,51 , // ... rawlen........ popen.. gmatch
-  64 ,x  ,x  ,x  ,x  ,56 ,x  ,x  ,x  ,x  ,x  ,x  ,136,x  ,x  ,90 , //  charpattern.... pack...... traceback.. mininteger
-  x  ,x  ,x  ,x  ,x  ,86 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,93 , // ..... log......... rad
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ................
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,40 ,x  , // .............. loadlib.
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,18 ,43 ,x  ,x  , // ............ select searchers..
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,59 ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ........ reverse.......
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,117,39 , // .............. difftime loaded
-  x  ,x  ,x  ,x  ,4  ,76 ,x  ,95 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // .... dofile acos. randomseed........
-  x  ,x  ,x  ,x  ,97 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // .... sqrt...........
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,127,58 ,x  ,x  , // ............ getinfo rep..
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,35 ,x  ,x  ,x  ,x  ,0  , // .......... require.... _ENV
-  27 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,26 ,x  ,x  , //  close............ coroutine..
-  23 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,68 ,x  ,x  ,x  ,x  ,x  ,x  , //  _VERSION........ table......
-  x  ,x  ,x  ,x  ,121,42 ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,15 ,x  , // .... rename preload........ rawget.
-  x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x   // ................
-  };
-#undef x
+#define Bltmphcnt 135
+#define Bltmphmsk 31
 
-#define Blthshshift(h) h >> 9
-#define Hshseed   0x7748fa7c
-#define Duncnt 26
-#define Dun0hshmsk 31
-#define Dun0hshbit  5
-
-#define x D99_count
+static const ub2 bltmphdsp[32] = {
+  31,14,42,45,176,176,35,492,176,529,1,42,2,1665,0,54,
+  86,1,0,25,56,60,5,27,261,69,63,74,4,24,278,131
+};
 
-static const ub1 dun0hsh[32] = {
-  x  ,x  ,x  ,x  ,x  ,11 ,5  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  ,x  , // ..... bnot pow.........
-  x  ,x  ,x  ,x  ,3  ,10 ,x  ,x  ,20 ,8  ,25 ,x  ,15 ,9  ,x  ,x   // .... div bxor.. newindex band name. len bor..
-  };
-#undef x
+static const struct mphkey bltmphkey[135] = {
+  { 0x69617069,0x73726961,6,7 }, // ipairs
+  { 0x6c61636f6c746573,0x656c61636f6c7465,9,122 }, // setlocale
+  { 0x564e455f,0x564e455f,4,0 }, // _ENV
+  { 0x676564,0x0,3,81 }, // deg
+  { 0x6e696d,0x0,3,89 }, // min
+  { 0x6c61757165776172,0x6b6c617571657761,9,14 }, // rawequalk
+  { 0x65766f6d,0x65766f6d,4,71 }, // move
+  { 0x6c656979,0x646c6569,5,34 }, // yield
+  { 0x61637078,0x6c6c6163,6,25 }, // xpcall
+  { 0x75736572,0x656d7573,6,30 }, // resume
+  { 0x74616d67,0x68637461,6,51 }, // gmatch
+  { 0x6361626563617274,0x6b63616265636172,9,136 }, // traceback
+  { 0x656c6573,0x7463656c,6,18 }, // select
+  { 0x7366666f,0x74657366,6,67 }, // offset
+  { 0x66706d74,0x656c6966,7,109 }, // tmpfile
+  { 0x746174656d746567,0x656c626174617465,12,6 }, // getmetatable
+  { 0x726f6c66,0x726f6c66,4,83 }, // flor
+  { 0x65746164,0x65746164,4,116 }, // date
+  { 0x6e6974756f726f63,0x656e6974756f726f,9,26 }, // coroutine
+  { 0x75716572,0x65726975,7,35 }, // require
+  { 0x65706f70,0x6e65706f,5,107 }, // popen
+  { 0x6c696563,0x6c696563,4,79 }, // ceil
+  { 0x66646f6d,0x66646f6d,4,91 }, // modf
+  { 0x746c75,0x0,3,100 }, // ult
+  { 0x6170686372616573,0x6874617068637261,10,44 }, // searchpath
+  { 0x74617063,0x68746170,5,38 }, // cpath
+  { 0x62757367,0x62757367,4,52 }, // gsub
+  { 0x736f6c63,0x65736f6c,5,27 }, // close
+  { 0x7672657375746567,0x656c617672657375,11,131 }, // getuservale
+  { 0x627573,0x0,3,60 }, // sub
+  { 0x64616572,0x64616572,4,108 }, // read
+  { 0x6e696f7065646f63,0x746e696f7065646f,9,66 }, // codepoint
+  { 0x666e6f63,0x6769666e,6,37 }, // config
+  { 0x7265686372616573,0x7372656863726165,9,43 }, // searchers
+  { 0x69727473,0x676e6972,6,45 }, // string
+  { 0x736f6361,0x736f6361,4,76 }, // acos
+  { 0x65707075,0x72657070,5,62 }, // upper
+  { 0x76746573,0x66756276,7,113 }, // setvbuf
+  { 0x636e6f63,0x7461636e,6,69 }, // concat
+  { 0x6f6d6572,0x65766f6d,6,72 }, // remove
+  { 0x65646f63,0x7365646f,5,65 }, // codes
+  { 0x65746567,0x766e6574,6,120 }, // getenv
+  { 0x74697277,0x65746972,5,110 }, // write
+  { 0x6874616d,0x6874616d,4,74 }, // math
+  { 0x75626564,0x67756265,5,125 }, // debug
+  { 0x6c626174,0x656c6261,5,68 }, // table
+  { 0x646e6172,0x6d6f646e,6,94 }, // random
+  { 0x6e697361,0x6e697361,4,77 }, // asin
+  { 0x6c61636f6c746573,0x6c61636f6c746573,8,133 }, // setlocal
+  { 0x6765746e696e696d,0x72656765746e696e,10,90 }, // mininteger
+  { 0x65747962,0x65747962,4,46 }, // byte
+  { 0x6e6973,0x0,3,96 }, // sin
+  { 0x74617473,0x73757461,6,32 }, // status
+  { 0x656d697466666964,0x656d697466666964,8,117 }, // difftime
+  { 0x65736e69,0x74726573,6,70 }, // insert
+  { 0x6f727265,0x726f7272,5,5 }, // error
+  { 0x7478656e,0x7478656e,4,10 }, // next
+  { 0x72616863,0x72616863,4,47 }, // char
+  { 0x616e6572,0x656d616e,6,121 }, // rename
+  { 0x65736d6f646e6172,0x646565736d6f646e,10,95 }, // randomseed
+  { 0x69746567,0x6f666e69,7,127 }, // getinfo
+  { 0x6b636170,0x6b636170,4,56 }, // pack
+  { 0x646e6966,0x646e6966,4,49 }, // find
+  { 0x61706e75,0x6b636170,6,61 }, // unpack
+  { 0x6965756c61767075,0x646965756c617670,9,137 }, // upvalueid
+  { 0x677463656c6c6f63,0x6567616272616774,14,3 }, // collectgarbage
+  { 0x38667475,0x38667475,4,63 }, // utf8
+  { 0x65766572,0x65737265,7,59 }, // reverse
+  { 0x7672657375746573,0x65756c6176726573,12,135 }, // setuservalue
+  { 0x676e697274736f74,0x676e697274736f74,8,21 }, // tostring
+  { 0x68746573,0x6b6f6f68,7,132 }, // sethook
+  { 0x6e617461,0x6e617461,4,78 }, // atan
+  { 0x6374616d,0x68637461,5,55 }, // match
+  { 0x676f6c,0x0,3,86 }, // log
+  { 0x64616f6c,0x62696c64,7,40 }, // loadlib
+  { 0x6d726f66,0x74616d72,6,50 }, // format
+  { 0x656765746e696f74,0x72656765746e696f,9,99 }, // tointeger
+  { 0x73756c66,0x6873756c,5,102 }, // flush
+  { 0x6c657270,0x64616f6c,7,42 }, // preload
+  { 0x75706e69,0x7475706e,5,103 }, // input
+  { 0x4e4f49535245565f,0x4e4f49535245565f,8,23 }, // _VERSION
+  { 0x656e696c,0x73656e69,5,104 }, // lines
+  { 0x61646c6569797369,0x656c6261646c6569,11,29 }, // isyieldable
+  { 0x646f6d66,0x646f6d66,4,84 }, // fmod
+  { 0x6c61767075746567,0x65756c6176707574,10,130 }, // getupvalue
+  { 0x6c776172,0x6e656c77,6,16 }, // rawlen
+  { 0x636f6c63,0x6b636f6c,5,115 }, // clock
+  { 0x64616f6c,0x64656461,6,39 }, // loaded
+  { 0x6b636170,0x6567616b,7,36 }, // package
+  { 0x6c61636f6c746567,0x6c61636f6c746567,8,128 }, // getlocal
+  { 0x63657865,0x65747563,7,118 }, // execute
+  { 0x74726f73,0x74726f73,4,73 }, // sort
+  { 0x736261,0x0,3,75 }, // abs
+  { 0x65677568,0x65677568,4,85 }, // huge
+  { 0x68746170,0x68746170,4,41 }, // path
+  { 0x706572,0x0,3,58 }, // rep
+  { 0x74727173,0x74727173,4,97 }, // sqrt
+  { 0x656d6974,0x656d6974,4,123 }, // time
+  { 0x7474617072616863,0x6e72657474617072,11,64 }, // charpattern
+  { 0x7265626d756e6f74,0x7265626d756e6f74,8,20 }, // tonumber
+  { 0x69666f64,0x656c6966,6,4 }, // dofile
+  { 0x65737361,0x74726573,6,2 }, // assert
+  { 0x65776f6c,0x7265776f,5,54 }, // lower
+  { 0x706d7564,0x706d7564,4,48 }, // dump
+  { 0x707865,0x0,3,82 }, // exp
+  { 0x6e697270,0x746e6972,5,13 }, // print
+  { 0x656c696664616f6c,0x656c696664616f6c,8,9 }, // loadfile
+  { 0x6a65756c61767075,0x6e696f6a65756c61,11,138 }, // upvaluejoin
+  { 0x61657263,0x65746165,6,28 }, // create
+  { 0x7369676572746567,0x7972747369676572,11,129 }, // getregistry
+  { 0x6e6174,0x0,3,98 }, // tan
+  { 0x74697865,0x74697865,4,119 }, // exit
+  { 0x7074756f,0x74757074,6,106 }, // output
+  { 0x72696170,0x73726961,5,11 }, // pairs
+  { 0x656c6966,0x656c6966,4,111 }, // file
+  { 0x6765746e6978616d,0x72656765746e6978,10,88 }, // maxinteger
+  { 0x746174656d746573,0x656c626174617465,12,19 }, // setmetatable
+  { 0x6e656c,0x0,3,53 }, // len
+  { 0x6e726177,0x6e726177,4,24 }, // warn
+  { 0x6e6e7572,0x676e696e,7,31 }, // running
+  { 0x73776172,0x74657377,6,17 }, // rawset
+  { 0x646172,0x0,3,93 }, // rad
+  { 0x65707974,0x65707974,4,22 }, // type
+  { 0x657a69736b636170,0x657a69736b636170,8,57 }, // packsize
+  { 0x70617277,0x70617277,4,33 }, // wrap
+  { 0x6c616370,0x6c6c6163,5,12 }, // pcall
+  { 0x6c61767075746573,0x65756c6176707574,10,134 }, // setupvalue
+  { 0x6b656573,0x6b656573,4,112 }, // seek
+  { 0x6e706d74,0x656d616e,7,124 }, // tmpname
+  { 0x78616d,0x0,3,87 }, // max
+  { 0x6e65706f,0x6e65706f,4,105 }, // open
+  { 0x68746567,0x6b6f6f68,7,126 }, // gethook
+  { 0x67776172,0x74656777,6,15 }, // rawget
+  { 0x64616f6c,0x64616f6c,4,8 }, // load
+  { 0x736f63,0x0,3,80 }  // cos
+};
 
-#define Dun1hshmsk 31
-#define Dun1hshbit  5
+#define Duncnt 26
+#define Dunmphcnt 22
+#define Dunmphmsk 3
 
-#define x D99_count
+static const ub2 dunmphdsp[4] = {
+  0,0,108,3126
+};
 
-static const ub1 dun1hsh[32] = {
-  x  ,x  ,24 ,2  ,0  ,1  ,x  ,7  ,12 ,x  ,x  ,14 ,x  ,19 ,x  ,4  , // .. mode mul add sub. idiv shl.. concat. index. mod
-  13 ,x  ,x  ,x  ,x  ,21 ,x  ,x  ,x  ,x  ,23 ,x  ,x  ,6  ,x  ,x   //  shr.... call.... close.. unm..
-  };
-#undef x
+static const struct mphkey dunmphkey[22] = {
+  { 0x726f7862,0x726f7862,4,10 }, // bxor
+  { 0x766964,0x0,3,3 }, // div
+  { 0x746f6e62,0x746f6e62,4,11 }, // bnot
+  { 0x646e6162,0x646e6162,4,8 }, // band
+  { 0x6d6e75,0x0,3,6 }, // unm
+  { 0x636e6f63,0x7461636e,6,14 }, // concat
+  { 0x76696469,0x76696469,4,7 }, // idiv
+  { 0x6c756d,0x0,3,2 }, // mul
+  { 0x6e656c,0x0,3,15 }, // len
+  { 0x656d616e,0x656d616e,4,25 }, // name
+  { 0x726873,0x0,3,13 }, // shr
+  { 0x646461,0x0,3,0 }, // add
+  { 0x65646f6d,0x65646f6d,4,24 }, // mode
+  { 0x736f6c63,0x65736f6c,5,23 }, // close
+  { 0x6c6c6163,0x6c6c6163,4,21 }, // call
+  { 0x7865646e6977656e,0x7865646e6977656e,8,20 }, // newindex
+  { 0x776f70,0x0,3,5 }, // pow
+  { 0x65646e69,0x7865646e,5,19 }, // index
+  { 0x726f62,0x0,3,9 }, // bor
+  { 0x627573,0x0,3,1 }, // sub
+  { 0x646f6d,0x0,3,4 }, // mod
+  { 0x6c6873,0x0,3,12 }  // shl
+};
 
-#define Hshd0seed  0x0
-#define Hshd1seed  0x4a57aec
+#define Hshseed   0x0
 
-#define Dn0hshshift(h) h >> 9
-#define Dn1hshshift(h) h >> 15
 static inline enum Token lookupkw2(ub1 c,ub1 d)
 {
        if (c == 'd' && d == 'o') return Tdo;
@@ -141,44 +231,6 @@ static inline enum Token lookupkw2(ub1 c,ub1 d)
   else return T99_count;
 }
 
-static const unsigned char kwhshlut[256] = {
-    0,  2,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  2,
-    4,  0,  0,  0, 32, 17,  0,  0,  0,  0,  0,  0,  0,  0,128, 16,
-    0,  0, 16, 16,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 24,  0,
-   32,  0,  0,  0,  0,  0,  0,  0,  0,  1,  0,  0,  0,  4,  0,  0,
-    0,  0,  0,  0, 16,  0,  0,  0,  0,  0,  0, 36,  0,  0,  0,  0,
-   32,  0,  0,  0, 64,  0,  0,  0,  0,162,  0,  0,  0,  0,  0,129,
-    0,  0,  0,  0,  0,  0,128,  0,  0,  0, 32,  0,  0,  0, 72,  0,
-    0,  0,  1,128,128,  0,128,  8,  0,  0,160,  0,  8, 64,  0,  0,
-    0,  0,  0,  0, 32,  0, 96,  0,  0,  0,  0,  0,  0,  0,  0,  0,
-    0,  0, 16,  0,  2, 32,  0,  0,  1,  0,  0,  0,  0,  0,  0,  0,
-   64, 64,  0, 16,  4,  0,  0,  4,  0,  0, 64,  0,  0,  0,  0,  0,
-    0,  0,  0,  0,  0,  0,200,  0,  1,  0,  0,  0,  0,  1,  0,  0,
-    0,  0,  4,  0,  2,  0,  0,  0,  0,  0,  0,  0, 66,  0,  4,  8,
-    0,  0,  0,  0,  0,  0, 16,  0,  0,  0,  4,  0,  0,  0,  0, 16,
-    0,128,  0,  0,  0, 64,  0,  0,  2,  0,  0,  0,  0,  1,  0,  0,
-    0,  0,  0,  8,  0,  8,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
-}; // 32,36
-
-static const unsigned char blthshlut[256] = {
-   34, 34,  8,  4, 80,  0,  8,  0, 80, 44,212, 96, 96,132,  0,136,
-   18, 10, 24,  1, 33, 65,162, 32, 48, 64,  8, 70, 16,  0,  1,111,
-  192,  0,  0, 80,128,  0, 96,  0,145,  0, 10, 32,  2,  0,  8, 18,
-  128, 16, 36,136, 35, 38, 13,  9, 10,  0,  8,  1, 36, 54, 32,  4,
-   37, 16, 74, 40, 81, 20,199, 24, 28,  0,  4, 89,  0, 12, 97,128,
-   67,  4, 32, 50, 67, 48,  0,156,  4, 64, 18, 32, 66, 36,198,128,
-    1,  9,128, 32, 25, 68, 70, 74, 49,133,  2,226, 69, 66, 10,  3,
-   48,162, 17,  0, 97,  2, 57,  2,  5, 32,  0, 20, 19,224,209, 10,
-   25, 65,  8,221,  0, 68,185,  1, 16,128,200, 80,  8, 32,  6,  1,
-    8, 33,  0,208,204, 20, 32,161, 65,  0,  0, 12,112, 76,192, 98,
-   17, 64,132, 25,  4, 37,130,  3, 21,136, 32,  8, 88, 18,  8, 76,
-  136,  8,196, 21,137, 18,  2, 64,136, 26, 65,128,145, 16,128,  5,
-    1, 96,130, 24,162,  2, 51, 12,176, 45, 24, 16,134,  7, 11,  0,
-  144,  1,144, 66,130, 40,208, 66,  1,168,129,  0,116, 12,  0, 84,
-    0,  0, 43,  4, 20, 72, 65,  0,130, 32,132,128,242,160,  8, 34,
-    0,128, 64,128, 23, 64,  0, 68,  8, 18,  8,161,  2, 66, 32, 17
-}; // 172,172
-
 static inline enum Bltin lookupblt2(ub1 c,ub1 d)
 {
        if (c == '_' && d == 'G') return B_G;
@@ -230,6 +282,81 @@ static inline enum Dunder lookupdun2(ub1 c,ub1 d)
  HX  64 + ' ABCDEFabcdef'
  WS  0  - '   '
 */
+/* skip a run of set members from sp+n, at least up to the 0 at eof
+   set is two nibble tables : c is a member if set[c & 15] & set[16 + (c >> 4)], followed by a plain map
+   Most runs are short : callers only skip if the char at Runpeek is a member, within the source pad.
+   The first Runscalar chars are tested inline one by one, longer runs vectorised
+   Aligned loads never cross a page, so reading past the eof within one is harmless
+ */
+#define Runpeek 4
+#define Runscalar 8
+
+#if defined __AVX2__
+ #include <immintrin.h>
+
+static __attribute__((noinline,no_sanitize_address)) ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)
+{
+  const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set));
+  const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(set + 16)));
+  const __m256i nib = _mm256_set1_epi8(0x0f);
+  const ub1 *p = sp + n;
+  const ub1 *a = (const ub1 *)((size_t)p & ~(size_t)31);
+  ub4 x = 0xffffffffU << (p - a);
+  __m256i v,m;
+
+  do {
+    v = _mm256_load_si256((const __m256i *)a);
+    m = _mm256_and_si256(_mm256_shuffle_epi8(lo,_mm256_and_si256(v,nib)),_mm256_shuffle_epi8(hi,_mm256_and_si256(_mm256_srli_epi16(v,4),nib)));
+    x &= (ub4)_mm256_movemask_epi8(_mm256_cmpeq_epi8(m,_mm256_setzero_si256()));
+    if (x) break;
+    a += 32; x = 0xffffffffU;
+  } while (1);
+  return (ub4)(a - sp) + (ub4)__builtin_ctz(x);
+}
+
+#elif defined __SSSE3__
+ #include <tmmintrin.h>
+
+static __attribute__((noinline,no_sanitize_address)) ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)
+{
+  const __m128i lo = _mm_loadu_si128((const __m128i *)set);
+  const __m128i hi = _mm_loadu_si128((const __m128i *)(set + 16));
+  const __m128i nib = _mm_set1_epi8(0x0f);
+  const ub1 *p = sp + n;
+  const ub1 *a = (const ub1 *)((size_t)p & ~(size_t)15);
+  ub4 x = 0xffffU << (p - a);
+  __m128i v,m;
+
+  do {
+    v = _mm_load_si128((const __m128i *)a);
+    m = _mm_and_si128(_mm_shuffle_epi8(lo,_mm_and_si128(v,nib)),_mm_shuffle_epi8(hi,_mm_and_si128(_mm_srli_epi16(v,4),nib)));
+    x &= (ub4)_mm_movemask_epi8(_mm_cmpeq_epi8(m,_mm_setzero_si128()));
+    if (x) break;
+    a += 16; x = 0xffffU;
+  } while (1);
+  return (ub4)(a - sp) + (ub4)__builtin_ctz(x);
+}
+
+#else
+
+static ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)
+{
+  while (set[32 + sp[n]]) n++;
+  return n;
+}
+
+#endif
+
+static inline ub4 runskip(const ub1 *sp,ub4 n,const ub1 *set)
+{
+  ub4 e = n + Runscalar;
+
+  do {
+    if (set[32 + sp[n]] == 0) return n;
+  } while (++n < e);
+  return runskipv(sp,n,set);
+}
+
 #define x  27
 
 static unsigned char ctab[256] = {
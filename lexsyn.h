@@ -24,13 +24,21 @@
 struct lexsyn {
   ub4 tkcnt,tbcnt,cmtcnt;
   const ub1 *toks; // enum Token tok.h
-  const ub2 *atrs;
+  const ub2 *atrs; // atrcnt, only for tokens having one
+  ub4 atrcnt;
   const ub8 *bits;
   const ub1 *dfp0s;
   const ub1 *dfp1s;
+  ub4 dfp0cnt,dfp1cnt;
   const ub4 *cmts;
 
+  const ub4 *pks; // packed tokens, Tkpack only
+  const ub8 *pkxs;
+  ub4 pkxcnt;
+
   void *tkbas;
+  bool keep; // streams stay after syn, for lexedit
+  ub4 tkmaplen; // tkbas is a read-only file mapping of this len, see lexcache_rd
 
   struct map *idtab;
 
@@ -57,6 +65,15 @@ struct lexsyn {
 
 #define Tkpad 10
 
+/* packed token stream, built with -DTkpack (build.sh -p) : one ub4 per token
+   tk.6 dfp.10 atr.16 : token, start delta and attribute. Bits stay in their own stream, in token order
+   a delta of Pk_dfpx or more is in pkxs as ti.32 dfp.32, in token order
+ */
+#define Pk_tkmsk 0x3f
+#define Pk_dfpbit 6
+#define Pk_dfpx 0x3ff
+#define Pk_atrbit 16
+
 #define Lxop2 0x200
 #define Lxoe  0x100
 
@@ -100,11 +117,11 @@ struct lexsyn {
 #define Las_lenmsk 3
 #define Las_v2 0 // todo
 
-// nlit ctl typ.2 val.6 / exp.2 dot.4
-//          v1  0
+// nlit ctl typ.2 val.6
+//          0  int 0..63 in val
 #define Lan_v2 0x40
-#define Lan_v8 0x80
-#define Lan_a  0xc0
+#define Lan_v8 0x80 // int in bits
+#define Lan_f8 0xc0 // double in bits
 #define Lan_im  0 // todo
 
 extern void addmod(const ub1 *nam,ub4 len,bool isfile);
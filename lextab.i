@@ -1,8 +1,8 @@
 /* lextab.i - lexer core, pass 1
 
-   generated by genlex 0.1.0-alpha  3 Oct 2022  5:12
+   generated by genlex 0.1.0-alpha 17 Oct 2026  3:00
 
-   from lua.lex 0.1.0  3 Oct 2022  5:14 lua
+   from lua.lex 0.1.0 17 Oct 2026  3:00 lua
    options: code yes  tokens yes
  */
 #define UU 0  //  ' _'
@@ -38,7 +38,7 @@
 #define WS 0  // - '   '
 
 
-  void *compgo1_root[28] = {
+  static void * const compgo1_root[28] = {
   &&lx_u1,	// t=uu uu
   &&lx_id1_Caf_0,	// t=af af
   &&lx_znlit0,	// t=n0 n0
@@ -51,7 +51,7 @@
   &&lx_slit0_Cqq_0,	// t=qq qq
   &&lx_root_gentk_0,	// t=co co tk co
   &&lx_root_gentk_0,	// t=ro ro tk ro
-  &&lx_root_gentk_0,	// t=so so tk so
+  &&lx_lbo1,	// t=so so
   &&lx_root_gentk_0,	// t=cc cc tk cc
   &&lx_root_gentk_0,	// t=rc rc tk rc
   &&lx_root_gentk_0,	// t=sc sc tk sc
@@ -67,13 +67,20 @@
   &&lx_op21_Co2_0,	// t=o2 o2
   &&lx_eof,	// t=EOF EOF
   
-  &&lxer_root_28_1};	// ln 547
+  &&lxer_root_28_1};	// ln 613
 
 
-  ub1 tktab_root[21] = { T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,Tco,Tro,Tso,Tcc,Trc,Tsc,T99_count,T99_count,T99_count,Tsepa,Tcomma };
+  static const ub1 tktab_root[21] = { T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,T99_count,Tco,Tro,T99_count,Tcc,Trc,Tsc,T99_count,T99_count,T99_count,Tsepa,Tcomma };
 
  
-// N  c 1  t 27  u 0
+  static const ub1 run_root[32 + 256] = {
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 }; // 1 chars
+
+// NR  c 1  t 27  u 0
 lx_root_tk:
   dfp0 = N - prvN;
   dfp1 = n - prvn;
@@ -82,27 +89,28 @@ lx_root_tk:
   if (dfp0 > 1) {
     tk |= 0x80;
     if (dfp0 < 0x80) dfp0s[fn0++] = dfp0;
-    else { dfp0s[fn0++] = dfp0 & 0x80; dfp0s[fn0++] = dfp0 >> 7; dfp0s[fn0++] = dfp0 >> 15; }
+    else { dfp0s[fn0++] = (dfp0 & 0x7f) | 0x80; dfp0s[fn0++] = dfp0 >> 7; dfp0s[fn0++] = dfp0 >> 15; }
   }
   if (dfp1 > 1) {
     tk |= 0x40;
     if (dfp1 < 0x80) dfp1s[fn1++] = dfp1;
-    else { dfp1s[fn1++] = dfp1 & 0x80; dfp1s[fn1++] = dfp1 >> 7; dfp1s[fn1++] = dfp1 >> 15; }
+    else { dfp1s[fn1++] = (dfp1 & 0x7f) | 0x80; dfp1s[fn1++] = dfp1 >> 7; dfp1s[fn1++] = dfp1 >> 15; }
   }
-  tks[dn] = tk;
+  tkamark();
+  tks[dn++] = tk;
+  tkck();
   
 
 lx_root:
   
-  while (sp[n] == ' ') n++; // 32 
+  while (sp[n] == ' ') { if (sp[++n] == ' ') { n = runskip(sp,n,run_root); break; } } // 32 
   N = n; c = sp[n++];
 
    t = ctab[c];  goto *compgo1_root[t];
   
 lx_root_Cnl_0: // from root.nl set 7 ctl 1
 // donl
-lntab[l] = n;
-  // sinfo(n,"ln %u n %u",l,n);
+// sinfo(n,"ln %u n %u",l,n);
   l++;
   nlcol = n;
   
@@ -119,7 +127,7 @@ lx_id1_Caf_0: // from root.af set 1 ctl 1
 prvc1 = c;   goto lx_id1;
 
 lx_slit0_Cqq_0: // from root.qq set 9 ctl 1
-Q=c;   goto lx_slit0;
+Q=c; slitx = slitp0;   goto lx_slit0;
 
 lx_op11_Co1_0: // from root.o1 set 24 ctl 1
 atrs[an++] = c;   goto lx_op11;
@@ -140,6 +148,88 @@ tk = Top; goto lx_root_tk; // csw
 } else  { tk = Tdas; goto lx_root_tk; // csw
 }  
 
+//   c 0  t 2  u 0
+lx_lbo1:
+  
+  c = sp[n];
+      if ( (t = ctab[c]) == SO) { n++; 
+  lvl = 0;
+// lslit
+len = scanlong(sp+n,slen-n,lvl,&lnl,&lnx);
+  if (n + len >= slen) lxerror(l,n-nlcol,"lslit","",lvl,"missing long string close");
+  if (lnl) { l += lnl; nlcol = n + lnx; }
+  len += n; // close
+  if (sp[n] == '\r') n++;
+  if (n < len && sp[n] == '\n') n++; // first newline is not part of the string
+  len -= n;
+  slitx = slitp0;
+  memcpy(slitpool + slitx,sp + n,len);
+  slitx += len;
+  n += len + lvl + 2;
+  
+ 
+
+goto lx_lslit0; // csw
+}  else if (t == EQ   ) { n++; lvl = 1; 
+goto lx_lbo2; // csw
+} else  { tk = Tso; goto lx_root_tk; // csw
+}  
+
+//   c 0  t 2  u 0
+lx_lbo2:
+  
+  c = sp[n];
+      if ( (t = ctab[c]) == EQ) { n++; lvl++; 
+goto lx_lbo2; // csw
+}  else if (t == SO   ) { n++; 
+  // lslit
+len = scanlong(sp+n,slen-n,lvl,&lnl,&lnx);
+  if (n + len >= slen) lxerror(l,n-nlcol,"lslit","",lvl,"missing long string close");
+  if (lnl) { l += lnl; nlcol = n + lnx; }
+  len += n; // close
+  if (sp[n] == '\r') n++;
+  if (n < len && sp[n] == '\n') n++; // first newline is not part of the string
+  len -= n;
+  slitx = slitp0;
+  memcpy(slitpool + slitx,sp + n,len);
+  slitx += len;
+  n += len + lvl + 2;
+  
+ 
+
+goto lx_lslit0; // csw
+} else  { 
+  lxerror(l,n-nlcol,"lbo2","ot",c,"invalid long bracket"); 
+
+goto lx_root; // csw
+}  
+
+//   c 0  t 0  u 0
+lx_lslit0:
+  
+       { 
+  // slit
+// vrb(" add slit pos %u len %2u typ %u.%u '%s'",dn1,len,sla,R0,chprintn(sp+N-1,min(len,512),nil,sla));
+  len = slitx - slitp0;
+  switch(len) {
+  case 1: atr = slitpool[slitp0]; ctl |= 1; break;
+  case 2: atr = (slitpool[slitp0] << 8) | slitpool[slitp0]; ctl |= 2; break;
+  default: id = par ? 1 : slitgetadd(n,slitpool,slitx,ctl);
+           if (id <= hi16) { atr = id; ctl |= Las_v2; }
+           else { atr = La_slit; bits[bn++] = id; }
+           ctl |= 3;
+  }
+  if (par) slitp0 = lxslitev(rp,n,slitp0,slitx,an,bn);
+  else slitp0 = slitpos;
+  R0=ctl=0;
+  atrs[an++] = atr;
+  ctls[cn++] = ctl;
+  
+ 
+
+tk = Tslit; goto lx_root_tk; // csw
+}  
+
 //   c 0  t 1  u 0
 lx_col1:
   
@@ -213,22 +303,73 @@ lx_op22:
 } else  { tk = Top; goto lx_root_tk; // csw
 }  
 
-//   c 0  t 0  u 0
+//   c 0  t 1  u 0
 lx_cmt0:
   
-       { cmt0 = N; 
+  c = sp[n];
+      if (c == '['  ) { n++; cmt0 = N; 
+goto lx_lcmt1; // csw
+} else  { cmt0 = N; 
 goto lx_cmt; // csw
 }  
 
-//   c 1  t 0  u 0
+//   c 0  t 2  u 0
+lx_lcmt1:
+  
+  c = sp[n];
+      if ( (t = ctab[c]) == SO) { n++; 
+  lvl = 0;
+// lcmt
+len = scanlong(sp+n,slen-n,lvl,&lnl,&lnx);
+  if (n + len >= slen) lxerror(l,n-nlcol,"lcmt","",lvl,"missing long comment close");
+  if (lnl) { l += lnl; nlcol = n + lnx; }
+  n += len + lvl + 2;
+  cmtcnt++;
+  
+ 
+
+goto lx_root; // csw
+}  else if (t == EQ   ) { n++; lvl = 1; 
+goto lx_lcmt2; // csw
+} else  { goto lx_cmt; // csw
+}  
+
+//   c 0  t 2  u 0
+lx_lcmt2:
+  
+  c = sp[n];
+      if ( (t = ctab[c]) == EQ) { n++; lvl++; 
+goto lx_lcmt2; // csw
+}  else if (t == SO   ) { n++; 
+  // lcmt
+len = scanlong(sp+n,slen-n,lvl,&lnl,&lnx);
+  if (n + len >= slen) lxerror(l,n-nlcol,"lcmt","",lvl,"missing long comment close");
+  if (lnl) { l += lnl; nlcol = n + lnx; }
+  n += len + lvl + 2;
+  cmtcnt++;
+  
+ 
+
+goto lx_root; // csw
+} else  { goto lx_cmt; // csw
+}  
+
+  static const ub1 run_cmt[32 + 256] = {
+    0x02,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x02,0x03,0x03,0x03,0x03,0x03,0x01,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,
+    0,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1 }; // 254 chars
+
+// R  c 1  t 0  u 0
 lx_cmt:
   
+  if (run_cmt[32 + sp[n + Runpeek]]) n = runskip(sp,n,run_cmt);
   c = sp[n++];
       if (c == '\n' ) { 
   cmtcnt++;
 // donl
-lntab[l] = n;
-  // sinfo(n,"ln %u n %u",l,n);
+// sinfo(n,"ln %u n %u",l,n);
   l++;
   nlcol = n;
   
@@ -245,7 +386,9 @@ lx_u1:
       if (c == '_'  ) { n++; N=n; 
 goto lx_dun0; // csw
 }  else if ( (utab[c] & AN) ) { n++; goto lx_id2; // csw
-} else  { id1cnt++; atrs[an++] = id1getadd('_') | La_id1; 
+} else  { 
+  id1cnt++; atrs[an] = (par ? lxid1ev(rp,'_',an) : id1getadd('_')) | La_id1; an++; 
+
 tk = Tid; goto lx_root_tk; // csw
 }  
 
@@ -259,8 +402,8 @@ lx_dun0:
 // id2u
 id2cnt++;
   // info("add id.2  %s%s",chprint(prvc1),chprint(prvc2));
-  if (prvc1 < id2loch1) id2loch1 = prvc1;
-   else if (prvc1 > id2hich1) id2hich1 = prvc1;
+  if (prvc1 < id2lo) id2lo = prvc1;
+   else if (prvc1 > id2hi) id2hi = prvc1;
   tk = Tid;
   an++;
   
@@ -293,17 +436,18 @@ lx_dun:
 } else  { 
   // dunder
 idcnt++;
-  len = n - N;
+  len = n - N; // N is past the __
   // info("add id.%-2u __%.*s",len,len,chprintn(sp+N,len));
-  len2 = len - 2;
+  len2 = len;
+  hc = hashstr(sp+N,len2,Hshseed);
   if (len2 == 2) dun = lookupdun2(sp[N],sp[N+1]);
-  else dun = lookupdun(sp+N,len2);
-  if (dun < D99_count) atrs[dn] = dun | La_iddun;
+  else dun = lookupdun(sp+N,len2,hc);
+  if (dun < D99_count) atr = dun | La_iddun;
   else {
-    x4 = mapgetadd(&idtab,sp+N,len2,hc);
+    x4 = par ? lxidev(rp,N,len2,hc,dn,bn) : mapgetadd(&idtab,sp+N,len2,hc);
     if (x4 < La_idprv) atr = x4;
     else {
-      bits[bn++] = x4 | ((ub8)dn << 32); atr = La_id4;
+      bits[bn++] = x4 | ((ub8)(dn + dnb) << 32); atr = La_id4;
     }
   }
   
@@ -318,7 +462,7 @@ lx_id1:
   c = sp[n];
       if ( (utab[c] & AN) ) { n++; goto lx_id2; // csw
 } else  { 
-  id1cnt++; atrs[an++] = id1getadd(prvc1) | La_id1; 
+  id1cnt++; atrs[an] = (par ? lxid1ev(rp,prvc1,an) : id1getadd(prvc1)) | La_id1; an++; 
 
 tk = Tid; goto lx_root_tk; // csw
 }  
@@ -339,8 +483,8 @@ lx_id2:
   else if ( (blt = lookupblt2(prvc1,prvc2)) < B99_count) { tk = id; atrs[an++] = blt | La_idblt; bltcnt++; }
   else {
     id2cnt++;
-    if (prvc1 < id2loch1) id2loch1 = prvc1;
-    else if (prvc1 > id2hich1) id2hich1 = prvc1;
+    if (prvc1 < id2lo) id2lo = prvc1;
+    else if (prvc1 > id2hi) id2hi = prvc1;
     tk = Tid;
     an++;
   }
@@ -373,10 +517,10 @@ len = n - N;
       blt = lookupblt(sp+N,len2,hc);
       if (blt < B99_count) { atr = blt | La_idblt; bltcnt++; }
       else {
-        x4 = mapgetadd(&idtab,sp+N,len2,hc);
+        x4 = par ? lxidev(rp,N,len2,hc,dn,bn) : mapgetadd(&idtab,sp+N,len2,hc);
         if (x4 < La_idprv) atr = x4;
         else {
-          bits[bn++] = x4 | ((ub8)dn << 32); atr = La_id4;
+          bits[bn++] = x4 | ((ub8)(dn + dnb) << 32); atr = La_id4;
        }
      }
    }
@@ -408,9 +552,9 @@ lx_znlit0:
 goto lx_nlit1; // csw
 }  else if (t == DT   ) { n++; goto lx_flitf0; // csw
 }  else if ((c | 0x20) == 'e') { n++; goto lx_nlite0; // csw
-}  else if (c == 'j'  ) { n++; ctls[cn++] = Lan_im;  
+}  else if (c == 'j'  ) { n++; ctls[cn++] = Lan_im; ilit1cnt++;  
 tk = Tnlit; goto lx_root_tk; // csw
-} else  { ctls[cn++] = 0;  
+} else  { ctls[cn++] = 0; ilit1cnt++;  
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
@@ -424,9 +568,43 @@ lx_nlit0:
 goto lx_nlit1; // csw
 }  else if (t == DT   ) { n++; goto lx_flitf0; // csw
 }  else if ((c | 0x20) == 'e') { n++; goto lx_nlite0; // csw
-}  else if (c == 'j'  ) { n++; ctls[cn++] = Lan_im;  
+}  else if (c == 'j'  ) { n++; 
+  // ilitn
+len = n - N;
+  x1 = 0;
+  if (sp[n-1] == 'j') { len--; x1 = Lan_im; }
+  if (str2int(sp+N,len,&i8)) {
+    str2flt(sp+N,len,&fval);
+    ctls[cn++] = Lan_f8 | x1;
+    bits[bn++] = flt2bits(fval);
+    flitcnt++;
+  } else {
+    if (i8 < 64) ctls[cn++] = (ub1)i8 | x1;
+    else { ctls[cn++] = Lan_v8 | x1; bits[bn++] = i8; }
+    ilitcnt++;
+  }
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
-} else  { ctls[cn++] = 0;  
+} else  { 
+  // ilitn
+len = n - N;
+  x1 = 0;
+  if (sp[n-1] == 'j') { len--; x1 = Lan_im; }
+  if (str2int(sp+N,len,&i8)) {
+    str2flt(sp+N,len,&fval);
+    ctls[cn++] = Lan_f8 | x1;
+    bits[bn++] = flt2bits(fval);
+    flitcnt++;
+  } else {
+    if (i8 < 64) ctls[cn++] = (ub1)i8 | x1;
+    else { ctls[cn++] = Lan_v8 | x1; bits[bn++] = i8; }
+    ilitcnt++;
+  }
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
@@ -434,31 +612,71 @@ tk = Tnlit; goto lx_root_tk; // csw
 lx_nlit1:
   
   c = sp[n];
-      if ( (t = ctab[c]) == N0) { n++; ipart4 *= 10; 
-goto lx_nlit; // csw
-}  else if (t == NM   ) { n++; ipart4 = ipart4 * 10 + (c - '0'); 
-goto lx_nlit; // csw
+      if ( (t = ctab[c]) == N0) { n++; goto lx_nlit; // csw
+}  else if (t == NM   ) { n++; goto lx_nlit; // csw
 }  else if (t == DT   ) { n++; goto lx_flitf0; // csw
 }  else if ((c | 0x20) == 'e') { n++; goto lx_flitxs; // csw
-}  else if (t == UU   ) { n++; goto lx_nlit1; // csw
-}  else if (c == 'j'  ) { n++; ctls[cn++] = (ub1)ipart4 | Lan_im;  
+}  else if (t == UU   ) { n++; goto lx_nlit; // csw
+}  else if (c == 'j'  ) { n++; ctls[cn++] = (ub1)ipart4 | Lan_im; ilit1cnt++;  
 tk = Tnlit; goto lx_root_tk; // csw
-} else  { ctls[cn++] = ipart4;  
+} else  { ctls[cn++] = ipart4; ilit1cnt++;  
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
-// nlit 3+ int digits  c 2  t 4  u 0
+  static const ub1 run_nlit[32 + 256] = {
+    0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x01,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 }; // 11 chars
+
+// R nlit 2+ int digits, value from text  c 2  t 4  u 0
 lx_nlit:
   
+  if (run_nlit[32 + sp[n + Runpeek]]) n = runskip(sp,n,run_nlit);
   c = sp[n];
       if ( (t = ctab[c]) == N0) { n++; goto lx_nlit; // csw
 }  else if (t == NM   ) { n++; goto lx_nlit; // csw
 }  else if (t == DT   ) { n++; goto lx_flitf0; // csw
 }  else if ((c | 0x20) == 'e') { n++; goto lx_flitxs; // csw
 }  else if (t == UU   ) { n++; goto lx_nlit; // csw
-}  else if (c == 'j'  ) { n++; ctls[cn++] = Lan_a | Lan_im; 
+}  else if (c == 'j'  ) { n++; 
+  // ilitn
+len = n - N;
+  x1 = 0;
+  if (sp[n-1] == 'j') { len--; x1 = Lan_im; }
+  if (str2int(sp+N,len,&i8)) {
+    str2flt(sp+N,len,&fval);
+    ctls[cn++] = Lan_f8 | x1;
+    bits[bn++] = flt2bits(fval);
+    flitcnt++;
+  } else {
+    if (i8 < 64) ctls[cn++] = (ub1)i8 | x1;
+    else { ctls[cn++] = Lan_v8 | x1; bits[bn++] = i8; }
+    ilitcnt++;
+  }
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
-} else  { ctls[cn++] = Lan_a; 
+} else  { 
+  // ilitn
+len = n - N;
+  x1 = 0;
+  if (sp[n-1] == 'j') { len--; x1 = Lan_im; }
+  if (str2int(sp+N,len,&i8)) {
+    str2flt(sp+N,len,&fval);
+    ctls[cn++] = Lan_f8 | x1;
+    bits[bn++] = flt2bits(fval);
+    flitcnt++;
+  } else {
+    if (i8 < 64) ctls[cn++] = (ub1)i8 | x1;
+    else { ctls[cn++] = Lan_v8 | x1; bits[bn++] = i8; }
+    ilitcnt++;
+  }
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
@@ -467,25 +685,76 @@ lx_flitf0:
   
   c = sp[n];
       if ( (t = ctab[c]) == N0) { n++; goto lx_flitf0; // csw
-}  else if (t == NM   ) { n++; ctls[cn] = min(n-N,15) | Lan_a; 
-goto lx_flitf; // csw
+}  else if (t == NM   ) { n++; goto lx_flitf; // csw
 }  else if ((c | 0x20) == 'e') { n++; goto lx_flitxs; // csw
-}  else if (c == 'j'  ) { n++; ctls[cn++] = Lan_a | Lan_im; 
+}  else if (c == 'j'  ) { n++; 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
-} else  { ctls[cn++] = Lan_a; 
+} else  { 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
-// flit fraction digits  c 2  t 1  u 1
+  static const ub1 run_flitf[32 + 256] = {
+    0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x01,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 }; // 11 chars
+
+// R flit fraction digits  c 2  t 1  u 1
 lx_flitf:
   
+  if (run_flitf[32 + sp[n + Runpeek]]) n = runskip(sp,n,run_flitf);
   c = sp[n];
       if ( (utab[c] & NU) ) { n++; goto lx_flitf; // csw
 }  else if (c == '_'  ) { n++; goto lx_flitf; // csw
 }  else if ((c | 0x20) == 'e') { n++; goto lx_flitxs; // csw
-}  else if (c == 'j'  ) { n++; ctls[cn++] |= Lan_im; 
+}  else if (c == 'j'  ) { n++; 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
-} else  { cn++; 
+} else  { 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
@@ -496,7 +765,8 @@ lx_flitxs:
       if (c == '+'  ) { goto lx_flitx0; // csw
 }  else if (c == '-'  ) { goto lx_flitx0; // csw
 }  else if ( (t = ctab[c]) == N0) { goto lx_flitx0; // csw
-}  else if (t == NM   ) { goto lx_flitx; // csw
+}  else if (t == NM   ) { exdig=1; 
+goto lx_flitx; // csw
 } else  { goto lxer_flitxs_4_1; // csw
 }  
 
@@ -508,7 +778,18 @@ lx_flitx0:
 }  else if (t == UU   ) { n++; goto lx_flitx0; // csw
 }  else if (t == NM   ) { n++; exdig=1; 
 goto lx_flitx; // csw
-} else  { ctls[cn++] = Lan_a; 
+} else  { 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
@@ -521,10 +802,30 @@ lx_flitx:
 
 goto lx_flitx; // csw
 }  else if (c == '_'  ) { n++; goto lx_flitx; // csw
-}  else if (c == 'j'  ) { n++; exdig=min(exdig,3); ctls[cn++] = exdig << 4; 
+}  else if (c == 'j'  ) { n++; 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
 } else  { 
-  exdig=min(exdig,3); ctls[cn++] = Lan_a | (exdig << 4); 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
+  
+ 
 
 tk = Tnlit; goto lx_root_tk; // csw
 }  
@@ -543,7 +844,18 @@ lx_nlite:
   
   c = sp[n];
       if ( (utab[c] & NU) ) { n++; goto lx_nlite; // csw
-} else  { ctls[cn++] = 0; 
+} else  { 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
+  
+ 
+
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
@@ -551,7 +863,8 @@ tk = Tnlit; goto lx_root_tk; // csw
 lx_ilitb0:
   
   c = sp[n++];
-      if ( (t = ctab[c]) == N0) { goto lx_ilitb0; // csw
+      if ( (t = ctab[c]) == N0) { i8 = 0; 
+goto lx_ilitb; // csw
 }  else if (c == '1'  ) { i8 = 1; 
 goto lx_ilitb; // csw
 }  else if (t == UU   ) { goto lx_ilitb0; // csw
@@ -570,43 +883,110 @@ goto lx_ilitb; // csw
 } else  { 
   // ilit
 if (i8 < 64) ctls[cn++] = (ub1)i8;
-  else if (i8 <= hi16) { ctls[cn++] = (ub1)i8; }
-  else { bits[bn++] = i8; }
+  else { ctls[cn++] = Lan_v8; bits[bn++] = i8; }
+  ilitcnt++;
   
  
 
 tk = Tnlit; goto lx_root_tk; // csw
 }  
 
-//   c 0  t 3  u 1
+  static void * const compgo1_ilitx0[28] = {
+  &&lx_ilitx0,	// t=uu uu
+  &&lxer_ilitx0_5_1,	// t=af 
+  &&lx_ilitx,	// t=n0 n0
+  &&lx_ilitx,	// t=nm nm
+  &&lxer_ilitx0_5_1,	// t=ht 
+  &&lxer_ilitx0_5_1,	// t=vt 
+  &&lxer_ilitx0_5_1,	// t=cr 
+  &&lxer_ilitx0_5_1,	// t=nl 
+  &&lxer_ilitx0_5_1,	// t=hs 
+  &&lxer_ilitx0_5_1,	// t=qq 
+  &&lxer_ilitx0_5_1,	// t=co 
+  &&lxer_ilitx0_5_1,	// t=ro 
+  &&lxer_ilitx0_5_1,	// t=so 
+  &&lxer_ilitx0_5_1,	// t=cc 
+  &&lxer_ilitx0_5_1,	// t=rc 
+  &&lxer_ilitx0_5_1,	// t=sc 
+  &&lxer_ilitx0_5_1,	// t=ao 
+  &&lxer_ilitx0_5_1,	// t=ac 
+  &&lxer_ilitx0_5_1,	// t=cl 
+  &&lxer_ilitx0_5_1,	// t=sm 
+  &&lxer_ilitx0_5_1,	// t=ca 
+  &&lx_flith,	// t=dt dt
+  &&lxer_ilitx0_5_1,	// t=eq 
+  &&lxer_ilitx0_5_1,	// t=pm 
+  &&lxer_ilitx0_5_1,	// t=o1 
+  &&lxer_ilitx0_5_1,	// t=o2 
+  &&lxer_ilitx0_5_1,	// t=EOF 
+  
+  &&lxer_ilitx0_5_1};	// ln 856
+
+
+//   c 0  t 4  u 1
 lx_ilitx0:
   
   c = sp[n++];
-      if ( (t = ctab[c]) == N0) { goto lx_ilitx0; // csw
-}  else if (t == NM   ) { i8 = c - '0'; 
-goto lx_ilitx; // csw
-}  else if ( (utab[c] & HX) ) { i8 = (c | 0x20) - 'a'; 
-goto lx_ilitx; // csw
-}  else if (t == UU   ) { goto lx_ilitx0; // csw
-} else  { goto lxer_ilitx0_4_1; // csw
-}  
+      if ( (utab[c] & HX) ) { goto lx_ilitx; // csw
+}    else { t = ctab[c];  goto *compgo1_ilitx0[t];}
+  
+
+  static const ub1 run_ilitx[32 + 256] = {
+    0x01,0x03,0x03,0x03,0x03,0x03,0x03,0x01,0x01,0x01,0x00,0x00,0x00,0x00,0x00,0x04,0x00,0x00,0x00,0x01,0x02,0x04,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,
+    0,1,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,1,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 }; // 23 chars
 
-//   c 0  t 3  u 1
+// R hex digits, value from text  c 1  t 4  u 1
 lx_ilitx:
   
+  if (run_ilitx[32 + sp[n + Runpeek]]) n = runskip(sp,n,run_ilitx);
   c = sp[n];
-      if ( (t = ctab[c]) == N0) { n++; i8 <<= 4; 
-goto lx_ilitx; // csw
-}  else if (t == NM   ) { n++; i8 = i8 <<4 | (c - '0'); 
-goto lx_ilitx; // csw
-}  else if ( (utab[c] & HX) ) { n++; i8 = i8 <<4 | ((c | 0x20) - 'a'); 
-goto lx_ilitx; // csw
+      if ( (t = ctab[c]) == N0) { n++; goto lx_ilitx; // csw
+}  else if (t == NM   ) { n++; goto lx_ilitx; // csw
+}  else if ( (utab[c] & HX) ) { n++; goto lx_ilitx; // csw
+}  else if (t == DT   ) { n++; goto lx_flith; // csw
+}  else if ((c | 0x20) == 'p') { n++; goto lx_flitxs; // csw
 }  else if (t == UU   ) { n++; goto lx_ilitx; // csw
 } else  { 
-  // ilit
-if (i8 < 64) ctls[cn++] = (ub1)i8;
-  else if (i8 <= hi16) { ctls[cn++] = (ub1)i8; }
-  else { bits[bn++] = i8; }
+  // ilitn
+len = n - N;
+  x1 = 0;
+  if (sp[n-1] == 'j') { len--; x1 = Lan_im; }
+  if (str2int(sp+N,len,&i8)) {
+    str2flt(sp+N,len,&fval);
+    ctls[cn++] = Lan_f8 | x1;
+    bits[bn++] = flt2bits(fval);
+    flitcnt++;
+  } else {
+    if (i8 < 64) ctls[cn++] = (ub1)i8 | x1;
+    else { ctls[cn++] = Lan_v8 | x1; bits[bn++] = i8; }
+    ilitcnt++;
+  }
+  
+ 
+
+tk = Tnlit; goto lx_root_tk; // csw
+}  
+
+//   c 1  t 1  u 2
+lx_flith:
+  
+  c = sp[n];
+      if ( ( (u = utab[c]) & NU) ) { n++; goto lx_flith; // csw
+}  else if ( (u & HX) ) { n++; goto lx_flith; // csw
+}  else if (c == '_'  ) { n++; goto lx_flith; // csw
+}  else if ((c | 0x20) == 'p') { n++; goto lx_flitxs; // csw
+} else  { 
+  // flit
+len = n - N;
+  x1 = Lan_f8;
+  if (sp[n-1] == 'j') { len--; x1 |= Lan_im; }
+  if (str2flt(sp+N,len,&fval)) lxerror(l,0,"flit","",c,"invalid float literal");
+  bits[bn++] = flt2bits(fval);
+  ctls[cn++] = x1;
+  flitcnt++;
   
  
 
@@ -620,7 +1000,16 @@ lx_slit0:
       if (c == Q    ) { n++; len = 0;  
 goto lx_slitcat0; // csw
 }  else if (c == '\\' ) { goto lx_slit; // csw
-} else  { n++; N=n; slitx = slitpos; slitpool[slitx++] = c; 
+} else  { n++; 
+  N=n; slitx = slitp0;
+// slitrun
+len = slitscan(sp,n,Q) - n + 1;
+  memcpy(slitpool + slitx,sp + n - 1,len);
+  slitx += len;
+  n += len - 1;
+  
+ 
+
 goto lx_slit; // csw
 }  
 
@@ -633,7 +1022,15 @@ goto lx_slitcat0; // csw
 }  else if (c == '\\'  &&  sp[n] == Q) { n++; slitpool[slitx++] = Q; 
 goto lx_slit; // csw
 }  else if (c == '\\' ) { goto lx_slitesc; // csw
-} else  { slitpool[slitx++] = c; 
+} else  { 
+  // slitrun
+len = slitscan(sp,n,Q) - n + 1;
+  memcpy(slitpool + slitx,sp + n - 1,len);
+  slitx += len;
+  n += len - 1;
+  
+ 
+
 goto lx_slit; // csw
 }  
 
@@ -646,7 +1043,7 @@ c = sp[n++];
   if (c < 0x80) x1 = esctab[c];
   else x1 = 0;
   switch(x1) {
-  case Esc_nl: lntab[l++] = n; nlcol=n; break;
+  case Esc_nl: l++; nlcol=n; break;
   case Esc_o:
     x1 = c - '0';
     c = sp[n];
@@ -662,7 +1059,7 @@ c = sp[n++];
   case Esc_N: n=doescn(sp,n,slitpool,&slitx);    break;
   case Esc_inv:
     // sinfo(n,"'\\%s'",chprint(c));
-    // lxwarn(l,0,787,c,"unrecognised escape sequence");
+    // lxwarn(l,0,893,c,"unrecognised escape sequence");
     slitpool[slitx] = '\\';
     slitpool[slitx+1] = c;
     slitx += 2;
@@ -684,15 +1081,17 @@ lx_slitcat0:
 } else  { 
   // slit
 // vrb(" add slit pos %u len %2u typ %u.%u '%s'",dn1,len,sla,R0,chprintn(sp+N-1,min(len,512),nil,sla));
-  len = slitx - slitpos;
+  len = slitx - slitp0;
   switch(len) {
-  case 1: atr = slitpool[slitpos]; ctl |= 1; break;
-  case 2: atr = (slitpool[slitpos] << 8) | slitpool[slitpos]; ctl |= 2; break;
-  default: id = slitgetadd(n,slitpool,slitx,ctl);
+  case 1: atr = slitpool[slitp0]; ctl |= 1; break;
+  case 2: atr = (slitpool[slitp0] << 8) | slitpool[slitp0]; ctl |= 2; break;
+  default: id = par ? 1 : slitgetadd(n,slitpool,slitx,ctl);
            if (id <= hi16) { atr = id; ctl |= Las_v2; }
-           else bits[bn++] = id;
+           else { atr = La_slit; bits[bn++] = id; }
            ctl |= 3;
   }
+  if (par) slitp0 = lxslitev(rp,n,slitp0,slitx,an,bn);
+  else slitp0 = slitpos;
   R0=ctl=0;
   atrs[an++] = atr;
   ctls[cn++] = ctl;
@@ -736,7 +1135,7 @@ lxer_root_28_1: lxerror(l,n-nlcol,"root",nil,c,"unexpected char");
 lxer_flitxs_4_1: lxerror(l,n-nlcol,"flitxs",nil,c,"unexpected char");
 lxer_nlite0_2_1: lxerror(l,n-nlcol,"nlite0",nil,c,"unexpected char");
 lxer_ilitb0_3_1: lxerror(l,n-nlcol,"ilitb0",nil,c,"unexpected char");
-lxer_ilitx0_4_1: lxerror(l,n-nlcol,"ilitx0",nil,c,"unexpected char");
+lxer_ilitx0_5_1: lxerror(l,n-nlcol,"ilitx0",nil,c,"unexpected char");
 
 lx_eof:
 
@@ -24,6 +24,7 @@
 
 #include <stddef.h>
 #include <string.h>
+#include <setjmp.h>
 
 #include "base.h"
 
@@ -31,11 +32,15 @@
 
 #include "os.h"
 
+#include "fmt.h"
+
 static ub4 msgfile = Shsrc_main;
 #include "msg.h"
 
 #include "dia.h"
 
+#include "map.h"
+
 #include "util.h"
 
 #include "pre.h"
@@ -53,7 +58,7 @@ static bool do_chkmem = 0;
 
 struct globs globs;
 
-enum Cmdopt { Co_until=1,Co_prog,Co_emit,Co_trace,Co_noabr,Co_erabr,Co_pretty,Co_runast,Co_nocol,Co_include,
+enum Cmdopt { Co_until=1,Co_prog,Co_emit,Co_trace,Co_noabr,Co_erabr,Co_pretty,Co_runast,Co_nocol,Co_include,Co_mmap,Co_huge,Co_jobs,Co_cache,Co_tokens,Co_window,Co_watch,Co_lexstat,Co_lexprof,Co_mapbench,Co_tkbench,Co_lexbench,
   Co_Werror,Co_Wwarn,Co_Winfo,Co_Wtrace };
 
 static ub2 msgopt = Msg_shcoord | Msg_lno | Msg_col | Msg_Lvl;
@@ -62,11 +67,186 @@ static ub2 msgopt = Msg_shcoord | Msg_lno | Msg_col | Msg_Lvl;
 static const char *incdirs[Incdir];
 static ub2 incdircnt;
 
-static int docc(cchar *src,ub4 slen,bool isfile)
+static bool domap;
+static ub2 thrcnt;
+static ub4 window;
+static cchar *cachedir;
+static cchar *tkout;
+static bool dowatch;
+static bool lexstat;
+static bool tkbench;
+static cchar *lexprof;
+static ub4 mapbenchcnt;
+static ub4 lexbenchlen;
+
+// parse and build ast from lexed unit
+static int dosyn(struct lexsyn *lsp,ub8 T0)
 {
   int rv;
-  ub8 T0 = 0,T1 = 0;
+  ub8 T1 = 0;
   struct ast *ap;
+
+  if (globs.rununtil == 3) { info("until lex %u",globs.rununtil); return 0; }
+
+  if (lsp->tkcnt == 0) {
+    info("%s is empty",lsp->name ? lsp->name : "cmdline");
+    return 0;
+  }
+
+  if (inisyn()) return 1;
+  iniast();
+
+  struct synast *sa = minalloc(sizeof(struct synast),8,0,"synast");
+
+  timeit(&T1,nil);
+
+  rv = syn(lsp,sa,T0);
+
+  timeit2(&T1,lsp->srclen,"parse took ");
+
+  timeit2(&T0,lsp->srclen,"lex + parse took ");
+
+  if (rv) return rv;
+
+  if (sa->aidcnt == 0) {
+    info("%s is empty",lsp->name);
+    return 0;
+  }
+
+  if (globs.rununtil == 4) { info("until syn %u",globs.rununtil); return 0; }
+
+  ap = mkast(sa);
+
+  timeit2(&T1,lsp->srclen,"ast took ");
+
+  if (rv) return 1;
+
+//  afree(ls.tkbas,"lex tokens",nextcnt);
+
+  return 0;
+}
+
+#define Watchmax 256
+#define Watchquiet 50 // msec without events before rebuild
+
+struct watchset {
+  cchar *src;
+  struct prelex *pls;
+  struct lexsyn *lsp;
+  int wfd;
+  int *wdtab;
+  ub4 wdcnt;
+  bool full; // module graph or file layout changed, or last rebuild failed
+};
+
+/* rebuild after cnt changes in chg
+   A changed file is prelexed again on its own. A changed module graph redoes prelex for the unit
+   A single changed file is relexed around the changed range only, see lexedit
+   returns 0 if rebuilt, 1 on error, -1 if no watched file changed
+ */
+static int rebuild(struct watchset *ws,ub4 *chg,ub4 cnt)
+{
+  struct prelex *pls = ws->pls;
+  struct filinf *fip;
+  ub4 i,fid,wd,hit = 0,upd = 0,efid = 0;
+  ub4 dmg[3];
+  int rv = 0;
+  ub8 T0 = 0;
+
+  timeit(&T0,nil);
+
+  for (i = 0; i < cnt; i++) {
+    wd = chg[i] & ~Bit31;
+    for (fid = 0; fid < ws->wdcnt && ws->wdtab[fid] != (int)wd; fid++) ;
+    if (fid == ws->wdcnt) continue;
+    fip = pls->files + fid;
+    info("%s changed",fip->nam);
+    hit++;
+    if (chg[i] & Bit31) ws->wdtab[fid] = oswatchadd(ws->wfd,fip->nam); // replaced by editor
+    if (ws->full == 0 && rv == 0) { rv = preupdate(pls,fid,dmg); upd++; efid = fid; }
+    if (rv == 2) ws->full = 1;
+  }
+  if (hit == 0) return -1;
+  if (rv == 1) { ws->full = 1; return 1; }
+  if (ws->full) rv = prelex(ws->src,Inone,pls,T0);
+  if (rv) return rv;
+
+  if (ws->full || upd != 1) efid = hi32; // lex all
+  ws->full = 1; // until done
+  rv = lexedit(pls,ws->lsp,efid,dmg[0],dmg[1],dmg[2],T0);
+  if (rv) return rv;
+  ws->full = 0;
+
+  dosyn(ws->lsp,T0);
+  return 0;
+}
+
+// as above, with a fatal source error returned as 1 instead of exiting
+static int rebuildx(struct watchset *ws,ub4 *chg,ub4 cnt)
+{
+  jmp_buf jb;
+  int rv;
+
+  if (setjmp(jb)) {
+    osexitjmp(nil);
+    ws->full = 1;
+    return 1;
+  }
+  osexitjmp(jb);
+  rv = rebuild(ws,chg,cnt);
+  osexitjmp(nil);
+  return rv;
+}
+
+/* stay resident and rebuild on changes to any file of the unit
+   Errors in a rebuild are reported, and the watch goes on. The next change redoes the unit
+ */
+static int watch(cchar *src,struct prelex *pls,struct lexsyn *lsp)
+{
+  struct watchset ws;
+  struct filinf *fip;
+  ub4 chg[Watchmax];
+  ub4 fid;
+  int cnt;
+  int wfd = oswatchini();
+
+  if (wfd == -1) return 1;
+
+  memset(&ws,0,sizeof(ws));
+  ws.src = src; ws.pls = pls; ws.lsp = lsp;
+  ws.wfd = wfd;
+  ws.full = 1;
+
+  do {
+    if (ws.full) { // (re)watch all
+      for (fid = 0; fid < ws.wdcnt; fid++) if (ws.wdtab[fid] != -1) oswatchdel(wfd,ws.wdtab[fid]);
+      ws.wdcnt = pls->filcnt;
+      ws.wdtab = remalloc(ws.wdtab,ws.wdcnt * sizeof(int));
+      for (fid = 0; fid < ws.wdcnt; fid++) {
+        fip = pls->files + fid;
+        if (fip->seg && fip->fofs) ws.wdtab[fid] = -1; // segment of previous
+        else ws.wdtab[fid] = oswatchadd(wfd,fip->nam);
+      }
+    }
+    info("watching %u files",ws.wdcnt);
+    msgfls();
+
+    cnt = oswatchwait(wfd,chg,Watchmax,Watchquiet);
+    if (cnt < 0) break;
+
+    if (rebuildx(&ws,chg,(ub4)cnt) == 1) info("%s","rebuild failed, waiting for changes");
+  } while (1);
+
+  mfree(ws.wdtab);
+  osclose(wfd);
+  return 1;
+}
+
+static int docc(cchar *src,ub4 slen,bool isfile)
+{
+  int rv;
+  ub4 len;
+  ub8 T0 = 0;
   enum Inctyp inc;
   struct prelex pls;
   struct lexsyn ls;
@@ -76,6 +256,15 @@ static int docc(cchar *src,ub4 slen,bool isfile)
 
   pls.incdircnt = incdircnt;
   pls.incdirs = incdirs;
+  pls.domap = domap;
+  pls.thrcnt = thrcnt;
+  pls.window = window;
+  pls.lexstat = lexstat;
+  pls.tkbench = tkbench;
+  pls.lexprof = lexprof;
+  pls.edit = dowatch;
+  if (dowatch == 0) pls.cachedir = cachedir; // edits relex in place
+  pls.lexhc = lex_hash();
 
   inipre();
 
@@ -88,57 +277,219 @@ static int docc(cchar *src,ub4 slen,bool isfile)
     vrb("compile from cmdline len %u '%.16s%s'",slen,src,slen > 16 ? "..." : "");
     inc = Icmd;
   }
-  rv = prelex(src,inc,&pls,T0);
-  if (rv) return rv;
+  if (isfile && (len = (ub4)strlen(src)) > 4 && strcmp(src + len - 4,".lxt") == 0) { // lexed elsewhere
+    if (lexstream_rd(src,&ls)) return 1;
+    if (globs.rununtil <= 3) return 0;
+  } else {
+    rv = prelex(src,inc,&pls,T0);
+    if (rv) return rv;
 
-  if (globs.rununtil == 2) { info("until prelex %u",globs.rununtil); return 0; }
+    if (globs.rununtil <= 2) { info("until prelex %u",globs.rununtil); return 0; }
 
-  if (pls.tkcnt == 0) {
-    info("%s is empty",isfile ? src : "cmdline");
-    return 0;
-  }
+    if (pls.tkcnt == 0) {
+      info("%s is empty",isfile ? src : "cmdline");
+      return 0;
+    }
 
-  rv = lex(&pls,&ls,T0);
-  if (rv) return rv;
+    rv = lex(&pls,&ls,T0);
+    if (rv) return rv;
 
-  if (globs.rununtil == 3) { info("until lex %u",globs.rununtil); return 0; }
+    if (tkout && ls.tkcnt) lexstream_wr(tkout,&pls,&ls);
+  }
 
-  if (ls.tkcnt == 0) {
-    info("%s is empty",isfile ? src : "cmdline");
-    return 0;
+  if (dowatch && isfile) {
+    dosyn(&ls,T0);
+    return watch(src,&pls,&ls);
   }
 
-  if (inisyn()) return 1;
-  iniast();
+  return dosyn(&ls,T0);
+}
 
-  struct synast *sa = minalloc(sizeof(struct synast),8,0,"synast");
+/* lexer throughput on synthetic corpora, one per token class
+   each is written to a scratch file, then prelexed and lexed as a regular unit
+ */
+enum Lbcls { Lb_id,Lb_num,Lb_str,Lb_cmt,Lb_op,Lb_cnt };
 
-  timeit(&T1,nil);
+static cchar *lbnams[Lb_cnt] = { "ident","number","string","comment","operator" };
 
-  rv = syn(&ls,sa,T0);
+static ub8 lbrnd = 0x9e3779b97f4a7c15UL;
 
-  timeit2(&T1,ls.srclen,"parse took ");
+static ub4 lbrand(ub4 n)
+{
+  lbrnd = lbrnd * 6364136223846793005UL + 1442695040888963407UL;
+  return (ub4)(lbrnd >> 33) % n;
+}
 
-  timeit2(&T0,ls.srclen,"lex + parse took ");
+// ident for key k : one letter, or letter digits and an optional tail. Never a keyword
+static char *lbname(char *p,ub4 k)
+{
+  ub4 i,n,x;
+
+  *p++ = 'a' + k % 26;
+  k /= 26;
+  if (k == 0) return p;
+  x = k;
+  do { *p++ = '0' + x % 10; x /= 10; } while (x);
+  if (k & 1) return p;
+  n = lbrand(8);
+  for (i = 0; i < n; i++) *p++ = i ? 'a' + lbrand(26) : '_';
+  return p;
+}
 
-  if (rv) return rv;
+static char *lbword(char *p)
+{
+  ub4 i,n = lbrand(9) + 1;
 
-  if (sa->aidcnt == 0) {
-    info("%s is empty",ls.name);
-    return 0;
+  for (i = 0; i < n; i++) *p++ = 'a' + lbrand(26);
+  return p;
+}
+
+static char *lbnum(char *p)
+{
+  ub4 x = lbrand(1U << (lbrand(5) * 6 + 6));
+
+  switch (lbrand(4)) {
+  case 0: p += mysnprintf(p,0,32,"%u",x); break;
+  case 1: p += mysnprintf(p,0,32,"0x%x",x | 0x10); break;
+  case 2: p += mysnprintf(p,0,32,"%u.%u",x,lbrand(1000)); break;
+  case 3: p += mysnprintf(p,0,32,"%ue-%u",x,lbrand(30)); break;
   }
+  return p;
+}
 
-  if (globs.rununtil == 4) { info("until syn %u",globs.rununtil); return 0; }
+static const char *lbops[] = { "+","-","*","/","//","%","^","..","==","~=","<=",">=","<",">","<<",">>","&","|","~","and","or" };
 
-  ap = mkast(sa);
+// one line of the given class
+static char *lbline(char *p,enum Lbcls cls)
+{
+  ub4 i,n,k,op;
+
+  switch (cls) {
+  case Lb_id:
+    memcpy(p,"local ",6); p += 6;
+    n = lbrand(5) + 2;
+    for (i = 0; i < n; i++) {
+      k = lbrand(lbrand(4096) + 1); // skewed towards low keys
+      p = lbname(p,k);
+      *p++ = i == 0 ? '=' : (i + 1 < n ? '.' : ' ');
+    }
+    break;
+
+  case Lb_num:
+    memcpy(p,"v = {",5); p += 5;
+    n = lbrand(6) + 2;
+    for (i = 0; i < n; i++) { p = lbnum(p); *p++ = ','; }
+    *p++ = '}';
+    break;
+
+  case Lb_str:
+    memcpy(p,"s = ",4); p += 4;
+    if (lbrand(8) == 0) {
+      memcpy(p,"[[",2); p += 2;
+      n = lbrand(12) + 1;
+      for (i = 0; i < n; i++) { p = lbword(p); *p++ = i & 3 ? ' ' : '\n'; }
+      memcpy(p,"]]",2); p += 2;
+      break;
+    }
+    n = lbrand(4) + 1;
+    for (i = 0; i < n; i++) {
+      *p++ = i & 1 ? '\'' : '"';
+      k = lbrand(6);
+      while (k--) { p = lbword(p); *p++ = ' '; }
+      if (lbrand(4) == 0) { *p++ = '\\'; *p++ = 'n'; }
+      *p++ = i & 1 ? '\'' : '"';
+      if (i + 1 < n) { memcpy(p," .. ",4); p += 4; }
+    }
+    break;
+
+  case Lb_cmt:
+    *p++ = '#';
+    if (lbrand(8) == 0) {
+      memcpy(p,"[[",2); p += 2;
+      n = lbrand(24) + 1;
+      for (i = 0; i < n; i++) { p = lbword(p); *p++ = i & 7 ? ' ' : '\n'; }
+      memcpy(p,"]]",2); p += 2;
+      break;
+    }
+    n = lbrand(12) + 1;
+    for (i = 0; i < n; i++) { *p++ = ' '; p = lbword(p); }
+    break;
+
+  case Lb_op:
+    *p++ = 'a' + lbrand(26);
+    memcpy(p," = ",3); p += 3;
+    n = lbrand(12) + 4;
+    for (i = 0; i < n; i++) {
+      *p++ = 'a' + lbrand(26);
+      if (i + 1 == n) break;
+      op = lbrand(sizeof(lbops) / sizeof(*lbops));
+      *p++ = ' ';
+      k = (ub4)strlen(lbops[op]);
+      memcpy(p,lbops[op],k); p += k;
+      *p++ = ' ';
+    }
+    break;
 
-  timeit2(&T1,ls.srclen,"ast took ");
+  case Lb_cnt: break;
+  }
+  *p++ = '\n';
+  return p;
+}
 
-  if (rv) return 1;
+static int lexbench(ub4 len)
+{
+  struct prelex pls;
+  struct lexsyn ls;
+  enum Msglvl lvl = getmsglvl();
+  enum Lbcls cls;
+  char nam[64],desc[64];
+  char *buf,*p,*top;
+  ub8 T0,T1;
+  unsigned long nw;
+  int fd,rv = 0;
+
+  len = max(len,1U << 16);
+  buf = myalloc(len + 4096);
+  globs.resusg = 1; // for timeit2
 
-//  afree(ls.tkbas,"lex tokens",nextcnt);
+  inipre();
 
-  return 0;
+  info("lexing %u`B corpora of %s to %s",len,lbnams[0],lbnams[Lb_cnt-1]);
+
+  for (cls = 0; cls < Lb_cnt && rv == 0; cls++) {
+    p = buf; top = buf + len;
+    while (p < top) p = lbline(p,cls);
+
+    fmtstring(nam,"lexbench-%s.lua",lbnams[cls]);
+    fd = oscreate(nam);
+    if (fd == -1) return 1;
+    rv = oswrite8(fd,buf,(ub8)(p - buf),&nw);
+    osclose(fd);
+    if (rv) break;
+
+    memset(&pls,0,sizeof(pls));
+    memset(&ls,0,sizeof(ls));
+    pls.domap = domap;
+    pls.thrcnt = thrcnt;
+
+    setmsglvl(Warn,msgopt);
+    T0 = 0;
+    timeit(&T0,nil);
+    rv = prelex(nam,Inone,&pls,T0);
+    if (rv == 0) rv = lex(&pls,&ls,T0);
+    T1 = T0;
+    setmsglvl(lvl,msgopt);
+
+    osremove(nam);
+    if (rv) { error("%s corpus did not lex",lbnams[cls]); break; }
+
+    fmtstring(desc,"%-8s ` bytes in",lbnams[cls]);
+    timeit2(&T0,(ub4)(p - buf),desc);
+    fmtstring(desc,"%-8s ` tokens in",lbnams[cls]);
+    timeit2(&T1,ls.tkcnt,desc);
+  }
+  mfree(buf);
+  return rv;
 }
 
 static struct cmdopt cmdopts[] = {
@@ -153,6 +504,18 @@ static struct cmdopt cmdopts[] = {
   { "error-abr",   ' ', Co_erabr,   nil,    "Automatic bug report for all errors" },
 
   { "include", 'I', Co_include, "dir",  "add directory to include search path" },
+  { "mmap",    ' ', Co_mmap,    nil,    "map large source files instead of reading" },
+  { "hugepages",' ',Co_huge,    "%eoff,thp,tlb", "large arenas on transparent huge pages, or hugetlbfs pages falling back to those" },
+  { "cache",   ' ', Co_cache,   "dir",  "token cache directory, skip prelex and lex of unchanged files" },
+  { "tokens",  ' ', Co_tokens,  "file", "write the token stream to file, to parse later as <name>.lxt without sources" },
+  { "jobs",    'j', Co_jobs,    "%ucount", "threads to prelex and lex required modules with" },
+  { "watch",   ' ', Co_watch,   nil,    "stay resident and rebuild on source changes" },
+  { "window",  ' ', Co_window,  "%uKiB", "process sources above this size in windows. Bounds the mapped source only, a unit stays below 2^28 tokens" },
+  { "lexstat", ' ', Co_lexstat, nil,    "show estimated versus actual lexer buffer sizes" },
+  { "lexprof", ' ', Co_lexprof, "file", "correction profile for lexer buffer sizes, updated after each run" },
+  { "mapbench",' ', Co_mapbench,"%ucount", "benchmark ident interning with count lookups on 1, 4 and 16 threads" },
+  { "tkbench", ' ', Co_tkbench, nil,    "benchmark a parser-like walk of split versus packed token streams" },
+  { "lexbench",' ', Co_lexbench,"%uKiB", "lexer throughput on generated ident, number, string, comment and operator corpora" },
 
   { "Werror",  ' ', Co_Werror,  "list", "comma-separated list of diags to report as error" },
   { "Wwarn",   ' ', Co_Wwarn,   "list", "comma-separated list of diags to report as warning" },
@@ -267,6 +630,18 @@ static int cmdline(int argc, char *argv[])
       case Co_include:if (incdircnt < Incdir) incdirs[incdircnt++] = sval;
                       else warning("Exceeding %u inc dir limit",Incdir);
                       break;
+      case Co_mmap:   domap = 1; break;
+      case Co_huge:   globs.hugepg = (ub1)uval; break;
+      case Co_cache:  cachedir = sval; break;
+      case Co_tokens: tkout = sval; break;
+      case Co_watch:  dowatch = 1; break;
+      case Co_jobs:   thrcnt = (ub2)min(uval,64); break;
+      case Co_window: window = min(uval,hi32 >> 10) << 10; break;
+      case Co_lexstat:lexstat = 1; break;
+      case Co_lexprof:lexprof = sval; break;
+      case Co_mapbench:mapbenchcnt = max(uval,1); break;
+      case Co_tkbench:tkbench = 1; break;
+      case Co_lexbench:lexbenchlen = min(uval,hi32 >> 11) << 10; break;
 
       case Co_prog:   cmdprog = sval; cmdprglen = coval.vlen; break;
       case Co_until:  globs.rununtil = uval; break;
@@ -335,11 +710,23 @@ int main(int argc, char *argv[])
 
   inilex();
 
+  if (mapbenchcnt) {
+    mapbench(mapbenchcnt);
+    myexit();
+    return 0;
+  }
+
+  if (lexbenchlen) {
+    rv = lexbench(lexbenchlen);
+    myexit();
+    return rv;
+  }
+
   if (cmdprog) {
     rv = docc(cmdprog,cmdprglen,0);
   } else if (srcnam) {
     if (*srcnam == 0) { errorfln(FLN,0,"empty script name"); return 1; }
-    rv = docc(srcnam,0,0);
+    rv = docc(srcnam,0,1);
   } else {
     errorfln(FLN,0,"script file or script arg expected");
     return 1;
@@ -1,8 +1,8 @@
 /* lua_pre.i - lexer core, pass 1
 
-   generated by genlex 0.1.0-alpha  3 Oct 2022  5:12
+   generated by genlex 0.1.0-alpha 17 Oct 2026  3:37
 
-   from pre.lex 0.1.0  3 Oct 2022  4:46 lua
+   from pre.lex 0.1.0 17 Oct 2026  3:37 lua
    options: code yes  tokens yes
  */
 #define AF 0  //  ' ABCDEFGHIJKLMNOPQSTUVWXYZ_abcdefghijklmnopqstuvwxyz'
@@ -16,19 +16,20 @@
 #define SQ 8  //  ' ' '
 #define DQ 9  //  ' " '
 #define RR 10 //  ' r'
-#define BO 11 //  ' ( [ { '
-#define BC 12 //  ' ) ] } '
-#define DT 13 //  ' . '
-#define OP 14 //  ' ! % & * + - / < > @ ^ | ~ '
-#define PC 15 //  ' , : ; = ? '
-#define EOF 16 //  ' \0 '
+#define BO 11 //  ' ( { '
+#define SO 12 //  ' [ '
+#define BC 13 //  ' ) ] } '
+#define DT 14 //  ' . '
+#define OP 15 //  ' ! % & * + - / < > @ ^ | ~ '
+#define PC 16 //  ' , : ; = ? '
+#define EOF 17 //  ' \0 '
 #define AN 1  // + ' 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz'
 #define NX 2  // + ' . 0123456789_'
 #define XN 4  // + ' 0123456789ABCDEF_abcdef'
 #define WS 0  // - '   '
 
 
-  void *compgo1_root[18] = {
+  static void * const compgo1_root[19] = {
   &&lx_id,	// t=af af
   &&lx_nm,	// t=nm nm
   &&lx_n0,	// t=n0 n0
@@ -36,24 +37,32 @@
   &&lx_root,	// t=vt vt
   &&lx_root,	// t=cr cr
   &&lx_root_Cnl_0,	// t=nl nl
-  &&lx_cmt,	// t=hs hs
+  &&lx_cmt0,	// t=hs hs
   &&lx_slits0,	// t=sq sq
   &&lx_slitd0,	// t=dq dq
   &&lx_xid,	// t=rr rr
   &&lx_root_Cbo_0,	// t=bo bo
+  &&lx_lbo1,	// t=so so
   &&lx_root_Cbc_0,	// t=bc bc
   &&lx_dot,	// t=dt dt
   &&lx_root_Cop_0,	// t=op op
   &&lx_root_Cpc_0,	// t=pc pc
   &&lx_root_CEOF_0,	// t=EOF EOF
   
-  &&lxer_root_18_1};	// ln 162
+  &&lxer_root_19_1};	// ln 193
 
 
-// N  c 1  t 17  u 0
+  static const ub1 run_root[32 + 256] = {
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 }; // 1 chars
+
+// NR  c 1  t 18  u 0
 lx_root:
   
-  while (sp[n] == ' ') n++; // 32 
+  while (sp[n] == ' ') { if (sp[++n] == ' ') { n = runskip(sp,n,run_root); break; } } // 32 
   N = n; c = sp[n++];
 
    t = ctab[c];  goto *compgo1_root[t];
@@ -71,14 +80,14 @@ if (bolvl >= Depth) lxerror(l,0,"root",nil,bolvl,"exceeding nesting depth");
  
   goto lx_root;
 
-lx_root_Cbc_0: // from root.bc set 12 ctl 1
+lx_root_Cbc_0: // from root.bc set 13 ctl 1
 // dobc
 if (bolvl == 0) {
     lxinfo(bclvls[0],0,"final close here");
     lxerror(l,0,"root",nil,c,"unbalanced");
   }
   bolvl--;
-  if (bolvlc[bolvl] != c) {
+  if (bolvlc[bolvl] != (c == ')' ? '(' : c - 2)) { // ]} are [{ + 2
     lxinfo(bolvls[bolvl],0,"opened here");
     lxerror(l,0,"root",nil,c,"unmatched");
   }
@@ -88,25 +97,82 @@ if (bolvl == 0) {
  
   goto lx_root;
 
-lx_root_Cop_0: // from root.op set 14 ctl 1
+lx_root_Cop_0: // from root.op set 15 ctl 1
 tacnt++;   goto lx_root;
 
-lx_root_Cpc_0: // from root.pc set 15 ctl 1
+lx_root_Cpc_0: // from root.pc set 16 ctl 1
 tkcnt++;   goto lx_root;
 
-lx_root_CEOF_0: // from root.EOF set 16 ctl 1
-if (bolvl) { lxinfo(l,0,"opened here"); lxerror(l,0,"root","EOF",bolvlc[0],"unmatched"); } 
+lx_root_CEOF_0: // from root.EOF set 17 ctl 1
+if (bolvl && pf->more == 0) { lxinfo(bolvls[bolvl-1],0,"opened here"); lxerror(l,0,"root","EOF",bolvlc[bolvl-1],"unmatched"); } 
   goto lx_eof;
 
 
-//   c 2  t 0  u 0
+//   c 0  t 1  u 0
+lx_cmt0:
+  
+  c = sp[n];
+      if (c == '['  ) { n++; goto lx_lcmt1; // csw
+} else  { goto lx_cmt; // csw
+}  
+
+//   c 1  t 1  u 0
+lx_lcmt1:
+  
+  c = sp[n];
+      if (c == '['  ) { n++; 
+  lvl = 0;
+// docmt
+lx = scanlong(sp+n,slen-n,lvl,&lnl,&lnx);
+  if (n + lx >= slen) lxerror(l,n-nlcol,"docmt",nil,lvl,"missing long comment close");
+  if (lnl) { l += lnl; nlcol = n + lnx; }
+  n += lx + lvl + 2;
+  cmtcnt++;
+  
+ 
+
+goto lx_root; // csw
+}  else if (c == '='  ) { n++; lvl = 1; 
+goto lx_lcmt2; // csw
+} else  { goto lx_cmt; // csw
+}  
+
+//   c 1  t 1  u 0
+lx_lcmt2:
+  
+  c = sp[n];
+      if (c == '='  ) { n++; lvl++; 
+goto lx_lcmt2; // csw
+}  else if (c == '['  ) { n++; 
+  // docmt
+lx = scanlong(sp+n,slen-n,lvl,&lnl,&lnx);
+  if (n + lx >= slen) lxerror(l,n-nlcol,"docmt",nil,lvl,"missing long comment close");
+  if (lnl) { l += lnl; nlcol = n + lnx; }
+  n += lx + lvl + 2;
+  cmtcnt++;
+  
+ 
+
+goto lx_root; // csw
+} else  { goto lx_cmt; // csw
+}  
+
+  static const ub1 run_cmt[32 + 256] = {
+    0x02,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x02,0x03,0x03,0x03,0x03,0x03,0x01,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,
+    0,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1 }; // 254 chars
+
+// R  c 2  t 0  u 0
 lx_cmt:
   
+  if (run_cmt[32 + sp[n + Runpeek]]) n = runskip(sp,n,run_cmt);
   c = sp[n++];
       if (c == '\n' ) { cmtcnt++; 
 goto lx_root; // csw
 }  else if (c == 0    ) { 
-  if (bolvl) { lxinfo(l,0,"opened here"); lxerror(l,0,"cmt",".EOF",bolvlc[0],"unmatched"); } 
+  if (bolvl && pf->more == 0) { lxinfo(bolvls[bolvl-1],0,"opened here"); lxerror(l,0,"cmt",".EOF",bolvlc[bolvl-1],"unmatched"); } 
 
 goto lx_eof; // csw
 } else  { goto lx_cmt; // csw
@@ -122,6 +188,80 @@ lx_dot:
 goto lx_root; // csw
 }  
 
+//   c 1  t 1  u 0
+lx_lbo1:
+  
+  c = sp[n];
+      if (c == '['  ) { n++; 
+  lvl = 0;
+// dolong
+lx = scanlong(sp+n,slen-n,lvl,&lnl,&lnx);
+  if (n + lx >= slen) lxerror(l,n-nlcol,"dolong",nil,lvl,"missing long string close");
+  if (lnl) { l += lnl; nlcol = n + lnx; }
+  lx += n; // close
+  if (sp[n] == '\r') n++;
+  if (n < lx && sp[n] == '\n') n++; // first newline is not part of the string
+  lx -= n;
+  n += lx + lvl + 2;
+  isreq = 0;
+  switch (lx) {
+  case 1: slit1cnt++; break;
+  case 2: slit2cnt++; break;
+  default: slitncnt++;
+  }
+  slitpos += lx;
+  
+ 
+
+goto lx_root; // csw
+}  else if (c == '='  ) { n++; lvl = 1; 
+goto lx_lbo2; // csw
+} else  { 
+  c = '[';
+// dobo
+if (bolvl >= Depth) lxerror(l,0,"root",nil,bolvl,"exceeding nesting depth");
+  bolvls[bolvl] = l;
+  bolvlc[bolvl++] = c;
+  tkcnt++;
+  
+ 
+
+goto lx_root; // csw
+}  
+
+//   c 1  t 1  u 0
+lx_lbo2:
+  
+  c = sp[n];
+      if (c == '='  ) { n++; lvl++; 
+goto lx_lbo2; // csw
+}  else if (c == '['  ) { n++; 
+  // dolong
+lx = scanlong(sp+n,slen-n,lvl,&lnl,&lnx);
+  if (n + lx >= slen) lxerror(l,n-nlcol,"dolong",nil,lvl,"missing long string close");
+  if (lnl) { l += lnl; nlcol = n + lnx; }
+  lx += n; // close
+  if (sp[n] == '\r') n++;
+  if (n < lx && sp[n] == '\n') n++; // first newline is not part of the string
+  lx -= n;
+  n += lx + lvl + 2;
+  isreq = 0;
+  switch (lx) {
+  case 1: slit1cnt++; break;
+  case 2: slit2cnt++; break;
+  default: slitncnt++;
+  }
+  slitpos += lx;
+  
+ 
+
+goto lx_root; // csw
+} else  { 
+  lxerror(l,n-nlcol,"lbo2","ot",c,"invalid long bracket"); 
+
+goto lx_root; // csw
+}  
+
 //   c 0  t 0  u 1
 lx_id:
   
@@ -145,18 +285,29 @@ lx_id2:
   
   c = sp[n];
       if ( (utab[c] & AN) ) { n++; goto lx_id2; // csw
-} else  { tacnt++; 
+} else  { 
+  tacnt++;
+// id
+len = n - N;
+  if (len > 2) {
+    idcnt++;
+    dx = (sp[N] == '_' && sp[N+1] == '_') ? 2 : 0; // dunders are keyed past the __
+    if (lexidtab(sp + N + dx,len - dx,dx != 0,&hc)) hll_add(idregs,hc); // same set as idtab
+  }
+  
+ 
+
 goto lx_root; // csw
 }  
 
-//   c 1  t 1  u 0
+//   c 1  t 0  u 1
 lx_xid:
   
   c = sp[n];
-      if (ctab[c] == AF) { n++; goto lx_xid; // csw
+      if ( (utab[c] & AN) ) { n++; goto lx_xid; // csw
 }  else if (c == ' '  ) { n++; 
   // chkimp
-len = n - N;
+len = n - 1 - N; // past ws
   if (len == 8 && memcmp(sp+N,"requires",8) == 0) {
     isreq = 1;
   } else { isreq = 0; tacnt++; }
@@ -169,9 +320,9 @@ goto lx_root; // csw
 // id
 len = n - N;
   if (len > 2) {
-    hc = hashstr(sp + N,len,0);
     idcnt++;
-    exp_first0(hc,idsketchs);
+    dx = (sp[N] == '_' && sp[N+1] == '_') ? 2 : 0; // dunders are keyed past the __
+    if (lexidtab(sp + N + dx,len - dx,dx != 0,&hc)) hll_add(idregs,hc); // same set as idtab
   }
   
  
@@ -179,12 +330,13 @@ len = n - N;
 goto lx_root; // csw
 }  
 
-//   c 1  t 0  u 1
+//   c 2  t 0  u 1
 lx_n0:
   
   c = sp[n];
       if ((c | 0x20) == 'x') { n++; goto lx_xnm; // csw
 }  else if ( (utab[c] & NX) ) { n++; goto lx_nm1; // csw
+}  else if ((c | 0x20) == 'e') { n++; goto lx_fxp0; // csw
 } else  { nlit1cnt++; 
 goto lx_root; // csw
 }  
@@ -195,7 +347,7 @@ lx_nm1:
   c = sp[n];
       if ( (utab[c] & NX) ) { n++; goto lx_nm; // csw
 }  else if ((c | 0x20) == 'e') { n++; goto lx_fxp0; // csw
-} else  { nlit1cnt++; 
+} else  { nlit1cnt++; bitcnt++; 
 goto lx_root; // csw
 }  
 
@@ -205,16 +357,18 @@ lx_nm:
   c = sp[n];
       if ( (utab[c] & NX) ) { n++; goto lx_nm; // csw
 }  else if ((c | 0x20) == 'e') { n++; goto lx_fxp0; // csw
-} else  { nlitcnt++; if (n - N < 4) acnt++; else bitcnt++; 
+} else  { nlitcnt++; if (n - N < 4) acnt++; bitcnt++;  
 goto lx_root; // csw
 }  
 
-// 0x  c 0  t 0  u 1
+// 0x  c 1  t 1  u 1
 lx_xnm:
   
   c = sp[n];
       if ( (utab[c] & XN) ) { n++; goto lx_xnm; // csw
-} else  { nlitcnt++; if (n - N < 4) acnt++; else bitcnt++; 
+}  else if (c == '.'  ) { n++; goto lx_xnm; // csw
+}  else if ((c | 0x20) == 'p') { n++; goto lx_fxp0; // csw
+} else  { nlitcnt++; if (n - N < 4) acnt++; bitcnt++; 
 goto lx_root; // csw
 }  
 
@@ -224,7 +378,7 @@ lx_fxp0:
   c = sp[n];
       if (c == 'p'   &&  sp[n+1] == 'm') { n += 2; goto lx_fxp; // csw
 }  else if (ctab[c] == NM) { n++; goto lx_fxp; // csw
-} else  { nlitcnt++; 
+} else  { nlitcnt++; bitcnt++; 
 goto lx_root; // csw
 }  
 
@@ -233,7 +387,7 @@ lx_fxp:
   
   c = sp[n];
       if (ctab[c] == NM) { n++; goto lx_fxp; // csw
-} else  { nlitcnt++; 
+} else  { nlitcnt++; bitcnt++; 
 goto lx_root; // csw
 }  
 
@@ -241,12 +395,12 @@ goto lx_root; // csw
 lx_slits0:
   
   c = sp[n];
-      if (c == '\'' ) { n++; tacnt++;  
+      if (c == '\'' ) { n++; tacnt++; slit1cnt++;  
 goto lx_root; // csw
 }  else if (c == '\n' ) { goto lx_slits; // csw
 }  else if (c == 0    ) { goto lx_slits; // csw
 }  else if (c == '\\' ) { goto lx_slits; // csw
-} else  { n++; N=n; L=l; Nlcol=nlcol; 
+} else  { n++; N=n-1; L=l; Nlcol=nlcol; 
 goto lx_slits; // csw
 }  
 
@@ -254,18 +408,26 @@ goto lx_slits; // csw
 lx_slitd0:
   
   c = sp[n];
-      if (c == '"'  ) { n++; tacnt++; 
+      if (c == '"'  ) { n++; tacnt++; slit1cnt++; 
 goto lx_root; // csw
 }  else if (c == '\n' ) { goto lx_slitd; // csw
 }  else if (c == 0    ) { goto lx_slitd; // csw
 }  else if (c == '\\' ) { goto lx_slitd; // csw
-} else  { n++; N=n; L=l; Nlcol=nlcol; 
+} else  { n++; N=n-1; L=l; Nlcol=nlcol; 
 goto lx_slitd; // csw
 }  
 
-// string literal  c 6  t 0  u 0
+  static const ub1 run_slits[32 + 256] = {
+    0x0e,0x0f,0x0f,0x0f,0x0f,0x0f,0x0f,0x0b,0x0f,0x0f,0x0e,0x0f,0x07,0x0f,0x0f,0x0f,0x01,0x02,0x04,0x02,0x02,0x08,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,
+    0,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1 }; // 252 chars
+
+// R string literal  c 6  t 0  u 0
 lx_slits:
   
+  if (run_slits[32 + sp[n + Runpeek]]) n = runskip(sp,n,run_slits);
   c = sp[n++];
       if (c == '\'' ) { goto lx_slit9; // csw
 }  else if (c == '\\'  &&  ctab[sp[n]] == SQ) { n++; goto lx_slits; // csw
@@ -285,9 +447,17 @@ lx_slits:
 } else  { goto lx_slits; // csw
 }  
 
-// string literal  c 6  t 0  u 0
+  static const ub1 run_slitd[32 + 256] = {
+    0x0e,0x0f,0x0b,0x0f,0x0f,0x0f,0x0f,0x0f,0x0f,0x0f,0x0e,0x0f,0x07,0x0f,0x0f,0x0f,0x01,0x02,0x04,0x02,0x02,0x08,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,
+    0,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1 }; // 252 chars
+
+// R string literal  c 6  t 0  u 0
 lx_slitd:
   
+  if (run_slitd[32 + sp[n + Runpeek]]) n = runskip(sp,n,run_slitd);
   c = sp[n++];
       if (c == '"'  ) { goto lx_slit9; // csw
 }  else if (c == '\\'  &&  ctab[sp[n]] == DQ) { n++; goto lx_slitd; // csw
@@ -312,7 +482,7 @@ lx_slit9:
   
        { 
   // doslit
-len = n - N;
+len = n - 1 - N; // excl quote
   if (isreq) {
     isreq=0;
     addmod(spos,N,len,1);
@@ -341,6 +511,7 @@ goto lx_root; // csw
 #undef DQ
 #undef RR
 #undef BO
+#undef SO
 #undef BC
 #undef DT
 #undef OP
@@ -350,7 +521,7 @@ goto lx_root; // csw
 #undef NX
 #undef XN
 #undef WS
-lxer_root_18_1: lxerror(l,n-nlcol,"root",nil,c,"unexpected char");
+lxer_root_19_1: lxerror(l,n-nlcol,"root",nil,c,"unexpected char");
 
 lx_eof:
 
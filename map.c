@@ -30,9 +30,11 @@
 static ub4 msgfile = Shsrc_map;
 #include "msg.h"
 
+#include "fmt.h"
+
 #include "map.h"
 
-//#include "hash.h"
+#include "hash.h"
 
 /*
   string key
@@ -47,48 +49,62 @@ enum Size { Sznil,Szmin,Szmal,Szmap };
 static const ub4 Minalloc = 16;
 static const ub4 Malloc = 4096 * 16;
 
-static void *expand(void *op,ub4 on,ub4 nn,ub2 algn,ub1 *ps)
+// grow from on to nn elements of elsiz. New part is zeroed
+static void *expand(void *op,ub4 on,ub4 nn,ub2 elsiz,ub1 *ps)
 {
   enum Size s = *ps;
+  ub4 olen = on * elsiz;
+  ub4 nlen = nn * elsiz;
   ub1 *np;
 
   switch(s) {
   case Sznil: case Szmin:
-    if (nn < Minalloc) {
-      np = minalloc(nn,algn,Mnofil,"");
+    if (nlen < Minalloc) {
+      np = minalloc(nlen,elsiz,0,"map");
       s = Szmin;
-    } else if (nn < Malloc) {
-      np = myalloc(nn);
+    } else if (nlen < Malloc) {
+      np = myalloc(nlen);
+      memset(np,0,nlen);
       s = Szmal;
     } else {
-      np = osmmapfln(FLN,nn,1,1);
+      np = osmmapfln(FLN,nlen,1,1);
       s = Szmap;
     }
-    if (s == Szmin) memcpy(np,op,nn - on);
+    if (olen) memcpy(np,op,olen);
     break;
   case Szmal:
-    if (nn < Malloc) {
-      np = remalloc(op,nn);
+    if (nlen < Malloc) {
+      np = remalloc(op,nlen);
+      memset(np + olen,0,nlen - olen);
     } else {
-      np = osmmapfln(FLN,nn,1,1);
-      memcpy(np,op,nn - on);
+      np = osmmapfln(FLN,nlen,1,1);
+      memcpy(np,op,olen);
+      mfree(op);
       s = Szmap;
     }
     break;
   default:
-    np = osmremapfln(FLN,op,1,on,nn);
+    np = osmremapfln(FLN,op,1,olen,nlen);
   }
   *ps = s;
 
   return np;
 }
 
+static void drop(void *p,ub4 len,ub1 siz)
+{
+  switch (siz) {
+    case Sznil: case Szmin: return;
+    case Szmal: mfree(p); break;
+    default: osmunmap(p,len);
+  }
+}
+
 void mkmap(struct map *m,ub4 estcnt,ub4 estkeylen)
 {
   ub4 hlen,itmtop;
-  ub4 *tab;
   ub1 kbit,bit = 0;
-  ub1 tsiz,ksiz,isiz;
+  ub1 tsiz=Sznil,ksiz=Sznil,isiz=Sznil;
 
   memset(m,0,sizeof(*m));
 
@@ -104,85 +120,102 @@ void mkmap(struct map *m,ub4 estcnt,ub4 estkeylen)
 
   m->tbit = bit;
 
-  tab = expand(nil,0,hlen,4,&tsiz);
-  if (tsiz == Szmal) memset(tab,0,hlen);
+  m->tab = expand(nil,0,hlen,4,&tsiz);
 
   estkeylen = nxpwr2(estkeylen,&kbit);
+  m->kbit = kbit;
   m->keys = expand(nil,0,estkeylen,1,&ksiz);
 
   m->items = expand(nil,0,itmtop,8,&isiz);
+  m->items[0] = 1;
   m->siz = (ksiz << 4) | (isiz << 2) | tsiz;
 }
 
+// free the lookup table. Keys and items stay for getkey()
 void finmap(struct map *m)
 {
   ub4 *tab = m->tab;
 
   if (tab == nil) return;
-  switch (m->siz & 3) {
-    case Sznil: case Szmin: return;
-    case Szmal: mfree(tab); break;
-    default: osmunmap(tab,1U << m->tbit);
-  }
+  drop(tab,(1U << m->tbit) * 4,m->siz & 3);
+  m->tab = nil;
 }
 
-static ub4 mapadd(struct map *m,const ub1 *nam,ub2 len,ub4 v)
+// free all, keys and items too
+void rmmap(struct map *m)
+{
+  finmap(m);
+  if (m->items) drop(m->items,(1U << m->ibit) * 8,(m->siz >> 2) & 3);
+  if (m->keys) drop(m->keys,1U << m->kbit,m->siz >> 4);
+  memset(m,0,sizeof(*m));
+}
+
+// first free slot along the probe sequence used by mapgetadd
+static ub4 slot(const ub4 *tab,ub1 tbit,ub4 hc)
+{
+  ub4 msk = (1U << tbit) - 1;
+  ub4 v = hc & msk;
+
+  if (tab[v] == 0) return v;
+  v = (v + (hc >> tbit)) & msk;
+  while (tab[v]) v = (v + 1) & msk;
+  return v;
+}
+
+static ub4 mapadd(struct map *m,const ub1 *nam,ub2 len,ub4 v,ub4 hc)
 {
   ub4 *ntab,*tab = m->tab;
-  ub4 x;
-  ub4 w;
-  ub4 np,id;
+  ub4 np,id,x;
   ub1 ibit = m->ibit;
-  ub4 nlen,ilen = 1U << ibit;
+  ub4 ilen = 1U << ibit;
   ub8 *items = m->items;
   ub1 kbit = m->kbit;
   ub4 klen = 1U << kbit;
   ub1 *keys = m->keys;
   ub1 tbit = m->tbit;
   ub4 tlen = 1U << tbit;
-  ub4 hsh,msk;
   ub1 tsiz,ksiz,isiz,siz = m->siz;
 
-  id = items ? (ub4)items[0] : 1;
+  id = (ub4)items[0];
 
   if (id >= ilen) { // resize items
-    nlen = ilen * 2;
     isiz = (siz >> 2) & 3;
-    info("hsh %p resize items to %u",m,nlen);
-    items = expand(items,ilen,nlen,8,&isiz);
+    vrb("map %p resize items to %u",m,ilen * 2);
+    items = expand(items,ilen,ilen * 2,8,&isiz);
     m->items = items;
+    m->ibit = ++ibit;
+    siz = (siz & ~0xc) | (isiz << 2);
   }
   items[0] = id + 1;
 
-  if (id * 2 > tlen) {
-    tsiz = siz & 3;
-    ntab = expand(tab,tlen,tlen * 2,4,&tsiz);
-    msk = tlen * 2 - 1;
-    for (w = 0; w < tlen; w++) {
-      x = tab[w];
-      if (x == 0) continue;
-      hsh = items[x] >> 32;
-      if (hsh & tbit) { // new bit set, move
-        ntab[w << 1] = x;
-        ntab[w] = 0;
-      }
-    }
+  if (id * 2 > tlen) { // rehash into double table
+    tsiz = Sznil;
+    ntab = expand(nil,0,tlen * 2,4,&tsiz);
+    for (x = 1; x < id; x++) ntab[slot(ntab,tbit+1,items[x] >> 32)] = x;
+    drop(tab,tlen * 4,siz & 3);
+    tab = m->tab = ntab;
+    m->tbit = ++tbit;
+    siz = (siz & ~3) | tsiz;
+    v = slot(tab,tbit,hc);
   }
 
   tab[v] = id;
   np = m->keypos;
 
-  if (np + len + 1 > klen) {
+  while (np + len + 1 > klen) {
     ksiz = (siz >> 4) & 3;
-    info("hsh %p resize keys %u %u",m,np+len,klen * 2);
+    vrb("map %p resize keys %u %u",m,np+len,klen * 2);
     keys = expand(keys,klen,klen * 2,1,&ksiz);
     m->keys = keys;
+    m->kbit = ++kbit;
+    klen <<= 1;
+    siz = (siz & 0xf) | (ksiz << 4);
   }
+  m->siz = siz;
   memcpy(keys+np,nam,len);
   keys[np+len] = 0;
 
-  items[id] = np;
-  info("add id %u nid %u",id,np);
+  items[id] = np | (ub8)hc << 32;
   m->keypos = np + len + 1;
 
   return id; // new
@@ -214,31 +247,229 @@ ub4 mapgetadd(struct map *m,const ub1 *nam,ub2 len,ub4 hc)
   // info("add %.*s",len,nam);
   v = hc & msk;
   x = tab[v];
-  if (x == 0) return mapadd(m,nam,len,v);
-  else if (check(m,nam,len,x)) return x;
+  if (x == 0) return mapadd(m,nam,len,v,hc);
+  else if (check(m,nam,len,x) != hi32) return x;
   else { // probe once with second hash
     hc2 = hc >> tbit;
     v = (v + hc2) & msk;
     x = tab[v];
-    if (x == 0) return mapadd(m,nam,len,v);
-    else if (check(m,nam,len,x)) return x;
+    if (x == 0) return mapadd(m,nam,len,v,hc);
+    else if (check(m,nam,len,x) != hi32) return x;
     else {
       do { // linear
         v = (v + 1) & msk;
         x = tab[v];
-        if (x == 0) return mapadd(m,nam,len,v);
-        else if (check(m,nam,len,x)) return x;
+        if (x == 0) return mapadd(m,nam,len,v,hc);
+        else if (check(m,nam,len,x) != hi32) return x;
       } while (1);
     }
   }
 }
 
+// get only, 0 if none. No modification, safe for concurrent readers
+ub4 mapget(struct map *m,const ub1 *nam,ub2 len,ub4 hc)
+{
+  ub1 tbit = m->tbit;
+  ub4 msk = (1U << tbit) - 1;
+  ub4 *tab = m->tab;
+  ub4 v,x;
+
+  if (tab == nil) return 0;
+  v = hc & msk;
+  x = tab[v];
+  if (x == 0 || check(m,nam,len,x) != hi32) return x;
+  v = (v + (hc >> tbit)) & msk;
+  while ( (x = tab[v]) ) {
+    if (check(m,nam,len,x) != hi32) return x;
+    v = (v + 1) & msk;
+  }
+  return 0;
+}
+
 ub1 *getkey(struct map *m,ub4 x)
 {
   ub4 np = m->items[x] & hi32;
   return m->keys + np;
 }
 
+void mkcmap(struct cmap *m,ub4 maxcnt)
+{
+  ub4 tlen;
+  ub1 tbit;
+
+  memset(m,0,sizeof(*m));
+  maxcnt = max(maxcnt,4096);
+  tlen = nxpwr2(maxcnt * 2,&tbit);
+  m->tbit = tbit;
+  m->tab = osmmapfln(FLN,tlen,8,1);
+  m->itmtop = maxcnt;
+  m->keys = osmmapfln(FLN,maxcnt,sizeof(ub1 *),1);
+  m->lens = osmmapfln(FLN,maxcnt,2,1);
+}
+
+void fincmap(struct cmap *m)
+{
+  if (m->tab == nil) return;
+  osmunmap(m->tab,(1UL << m->tbit) * 8);
+  osmunmap(m->keys,m->itmtop * sizeof(ub1 *));
+  osmunmap(m->lens,m->itmtop * 2);
+  m->tab = nil;
+}
+
+/* Lock-free : a new item is filled first, then published by a single cas on an empty slot
+   a thread losing the race for the same key returns the winner and leaves its item unused
+   The table is at least twice the item count, so probing ends
+ */
+ub4 cmapgetadd(struct cmap *m,const ub1 *nam,ub2 len,ub4 hc)
+{
+  ub4 msk = (1U << m->tbit) - 1;
+  ub4 v = hc & msk;
+  ub8 *tab = m->tab;
+  ub8 e,ne;
+  ub4 x = 0,y;
+
+  do {
+    e = __atomic_load_n(tab + v,__ATOMIC_ACQUIRE);
+    if (e == 0) {
+      if (x == 0) {
+        x = __atomic_add_fetch(&m->itmcnt,1,__ATOMIC_RELAXED);
+        if (x >= m->itmtop) return hi32;
+        m->keys[x] = nam;
+        m->lens[x] = len;
+      }
+      ne = (ub8)hc << 32 | x;
+      if (__atomic_compare_exchange_n(tab + v,&e,ne,0,__ATOMIC_RELEASE,__ATOMIC_ACQUIRE)) return x;
+    }
+    if ((e >> 32) == hc) { // e is set here, also after a lost cas
+      y = e & hi32;
+      if (m->lens[y] == len && memcmp(m->keys[y],nam,len) == 0) return y;
+    }
+    v = (v + 1) & msk;
+  } while (1);
+}
+
+/* map benchmark : intern a skewed stream of identifier-like keys
+   into a map behind a lock and into a cmap, on 1, 4 and 16 threads
+ */
+#define Mbchunk 4096
+
+struct mbjob {
+  struct map *m;
+  struct cmap *cm;
+  const ub1 *pool;
+  const ub4 *ofs,*hcs,*seq;
+  ub4 cnt,chunks;
+  ub4 ucnt; // distinct keys in seq
+  ub4 nxt;  // atomic
+  ub8 sum;  // atomic
+  bool lock;
+};
+
+static void *mbworker(void *arg)
+{
+  struct mbjob *jp = arg;
+  const ub4 *ofs = jp->ofs;
+  ub4 c,i,k,n;
+  ub2 len;
+  ub8 sum = 0;
+
+  while ( (c = __atomic_fetch_add(&jp->nxt,1,__ATOMIC_RELAXED)) < jp->chunks) {
+    i = c * Mbchunk;
+    n = min(i + Mbchunk,jp->cnt);
+    for (; i < n; i++) {
+      k = jp->seq[i];
+      len = (ub2)(ofs[k+1] - ofs[k]);
+      if (jp->cm) sum += cmapgetadd(jp->cm,jp->pool + ofs[k],len,jp->hcs[k]);
+      else {
+        if (jp->lock) oslock();
+        sum += mapgetadd(jp->m,jp->pool + ofs[k],len,jp->hcs[k]);
+        if (jp->lock) osunlock();
+      }
+    }
+  }
+  __atomic_fetch_add(&jp->sum,sum,__ATOMIC_RELAXED);
+  return nil;
+}
+
+static void mbrun(struct mbjob *jp,ub4 kcnt,ub4 thr,bool conc)
+{
+  struct map m;
+  struct cmap cm;
+  ub8 T0 = 0;
+  char desc[64];
+
+  jp->nxt = 0;
+  jp->sum = 0;
+  jp->lock = (thr > 1);
+  if (conc) { mkcmap(&cm,kcnt * 2); jp->cm = &cm; jp->m = nil; }
+  else { mkmap(&m,kcnt,kcnt * 8); jp->m = &m; jp->cm = nil; }
+
+  mysnprintf(desc,0,64,"%s on %2u thread%.*s ` lookups in",conc ? "cmap" : jp->lock ? "map + lock" : "map",thr,thr > 1,"s");
+  timeit(&T0,nil);
+  thr = (ub4)osrunpar(thr,mbworker,jp);
+  timeit2(&T0,jp->cnt,desc);
+
+  if (conc) {
+    if (cm.itmcnt < jp->ucnt) ice(0,0,"cmap %u keys %u items",jp->ucnt,cm.itmcnt);
+    vrb("cmap %u keys %u items",jp->ucnt,cm.itmcnt); // above for lost races
+    fincmap(&cm);
+  } else {
+    if ((ub4)m.items[0] != jp->ucnt + 1) ice(0,0,"map %u keys %u items",jp->ucnt,(ub4)m.items[0] - 1);
+    rmmap(&m);
+  }
+}
+
+void mapbench(ub4 cnt)
+{
+  static const ub1 thrs[] = { 1,4,16 };
+  static const char alf[] = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  struct mbjob job;
+  ub4 kcnt,k,i,len,pos,r;
+  ub4 *ofs,*hcs,*seq;
+  ub1 *pool;
+  ub8 rnd = 0x9e3779b97f4a7c15UL;
+
+  cnt = max(cnt,Mbchunk);
+  kcnt = min(max(cnt / 16,256),62 * 62 * 62 * 62); // typical repeat rate for idents
+
+  ofs = myalloc((kcnt + 1) * 4);
+  hcs = myalloc(kcnt * 4);
+  seq = myalloc(cnt * 4);
+  pool = myalloc(kcnt * 16);
+
+  for (pos = k = 0; k < kcnt; k++) { // unique by fixed-width base-62 prefix
+    ofs[k] = pos;
+    r = k;
+    for (i = 0; i < 4; i++) { pool[pos++] = alf[r % 62]; r /= 62; }
+    len = k % 9;
+    for (i = 0; i < len; i++) pool[pos++] = alf[(k * 7 + i * 13) % 53];
+    hcs[k] = hashstr(pool + ofs[k],pos - ofs[k],0);
+  }
+  ofs[kcnt] = pos;
+
+  memset(&job,0,sizeof(job));
+
+  for (i = 0; i < cnt; i++) { // skewed towards low keys
+    rnd = rnd * 6364136223846793005UL + 1442695040888963407UL;
+    r = (ub4)(rnd >> 33);
+    seq[i] = k = (ub4)(((ub8)r * r >> 31) * kcnt >> 31);
+    if ((ofs[k] & Bit31) == 0) { ofs[k] |= Bit31; job.ucnt++; }
+  }
+  for (k = 0; k < kcnt; k++) ofs[k] &= ~Bit31;
+
+  info("interning %u` lookups of %u` keys",cnt,job.ucnt);
+
+  job.pool = pool;
+  job.ofs = ofs; job.hcs = hcs; job.seq = seq;
+  job.cnt = cnt;
+  job.chunks = (cnt + Mbchunk - 1) / Mbchunk;
+
+  for (i = 0; i < sizeof(thrs); i++) mbrun(&job,kcnt,thrs[i],0);
+  for (i = 0; i < sizeof(thrs); i++) mbrun(&job,kcnt,thrs[i],1);
+
+  mfree(pool); mfree(seq); mfree(hcs); mfree(ofs);
+}
+
 void inimap(void)
 {
   lastcnt
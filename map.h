@@ -34,10 +34,35 @@ struct map { // 32
 
 extern void mkmap(struct map *m,ub4 estcnt,ub4 estkeylen);
 extern void finmap(struct map *m);
+extern void rmmap(struct map *m);
 
 // get or if none insert
 extern ub4 mapgetadd(struct map *m,const ub1 *nam,ub2 len,ub4 hc);
 
+// get only
+extern ub4 mapget(struct map *m,const ub1 *nam,ub2 len,ub4 hc);
+
 extern ub1 *getkey(struct map *m,ub4 x);
 
+/* concurrent insert-only map for many threads, fixed size
+   keys stay in caller memory. Ids are dense from 1 but depend on thread timing
+ */
+struct cmap {
+  ub8 *tab;         // hash.32 item.32, 0 is free
+  const ub1 **keys;
+  ub2 *lens;
+
+  ub4 itmcnt;       // atomic
+  ub4 itmtop;
+  ub1 tbit;
+};
+
+extern void mkcmap(struct cmap *m,ub4 maxcnt);
+extern void fincmap(struct cmap *m);
+
+// get or if none insert. hi32 if full
+extern ub4 cmapgetadd(struct cmap *m,const ub1 *nam,ub2 len,ub4 hc);
+
+extern void mapbench(ub4 cnt);
+
 extern void inimap(void);
@@ -21,9 +21,13 @@
 
 /* math utilities */
 
+#include <stdlib.h>
+
 #include "base.h"
 #include "math.h"
 
+#include "flttab.i"
+
 // wikipedia xorshift
 static ub8 xorshift64star(void)
 {
@@ -70,6 +74,332 @@ double frnd(ub4 range)
   return x;
 }
 
+/* SWAR digit runs : 8 ascii digits per ub8 load, first digit in the low byte
+   A chunk is only taken whole when all 8 are digits, else the caller steps one char
+ */
+#define Ones 0x0101010101010101UL
+#define Highs 0x8080808080808080UL
+
+static inline ub8 ld8(const ub1 *p)
+{
+  ub8 v;
+
+  __builtin_memcpy(&v,p,8);
+  return v;
+}
+
+static inline bool isdig8(ub8 v)
+{
+  return ((v & 0xf0f0f0f0f0f0f0f0UL) | (((v + 0x0606060606060606UL) & 0xf0f0f0f0f0f0f0f0UL) >> 4)) == 0x3333333333333333UL;
+}
+
+static inline ub8 hasbyte(ub8 v,ub1 c)
+{
+  v ^= Ones * c;
+  return (v - Ones) & ~v & Highs;
+}
+
+// 8 decimal digits to 0..99999999 : pairs, quads, then the two quads
+static inline ub4 dig8(ub8 v)
+{
+  v -= Ones * '0';
+  v = v * 10 + (v >> 8);
+  v = ((v & 0x000000ff000000ffUL) * 0x000f424000000064UL + ((v >> 16) & 0x000000ff000000ffUL) * 0x0000271000000001UL) >> 32;
+  return (ub4)v;
+}
+
+// 8 hex digits to 32 bits. Letters have bit 6 set, their low nibble is 1 .. 6
+static inline ub4 hex8(ub8 v)
+{
+  v = (v & 0x0f0f0f0f0f0f0f0fUL) + ((v >> 6) & Ones) * 9;
+  v = (v << 4 | v >> 8) & 0x00ff00ff00ff00ffUL;
+  v = (v << 8 | v >> 16) & 0x0000ffff0000ffffUL;
+  return (ub4)(v << 16 | v >> 32);
+}
+
+/* integer literal as lexed : digits and _ only, optional 0x prefix
+   hex wraps around, decimal above 2^63-1 returns 1 to be read as float instead
+ */
+int str2int(const ub1 *s,ub4 len,ub8 *pv)
+{
+  const ub1 *p = s,*e = s + len;
+  ub8 x = 0,v;
+  ub4 nd = 0;
+  ub1 c;
+
+  if (len > 1 && s[0] == '0' && (s[1] | 0x20) == 'x') {
+    for (p += 2; p < e; ) {
+      if (p + 8 <= e && hasbyte(v = ld8(p),'_') == 0) { x = x << 32 | hex8(v); p += 8; continue; }
+      c = *p++;
+      if (c == '_') continue;
+      x = x << 4 | ((c & 0xf) + (c >> 6) * 9);
+    }
+    *pv = x;
+    return 0;
+  }
+
+  while (p < e && (*p == '0' || *p == '_')) p++;
+  while (p < e) {
+    if (p + 8 <= e && isdig8(v = ld8(p))) { x = x * 100000000 + dig8(v); nd += 8; p += 8; continue; }
+    c = *p++;
+    if (c == '_') continue;
+    x = x * 10 + (c - '0'); nd++;
+  }
+  *pv = x;
+  return nd > 19 || x > (ub8)0x7fffffffffffffffUL; // 19 digits do not wrap
+}
+
+/* float literals, correctly rounded
+
+   decimal : up to 19 significant digits go into a ub8 mantissa w, the rest only adjust the exponent q
+   Clinger : w <= 2^53 and |q| <= 22 is exact in double arithmetic
+   Eisel-Lemire : otherwise, one 64x128 bit product of w with the normalised 5^q from flttab.i
+   Longer mantissas are tried with w and w+1. If these round differently, strtod decides.
+
+   hex : up to 64 mantissa bits plus a sticky bit, rounded to nearest even by hand
+ */
+
+#define Mandig 19
+#define Slowdig 780 // enough to round any double
+
+static const double pow10tab[23] = {
+  1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+  1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22
+};
+
+#define Manmsk 0xfffffffffffffUL
+#define Infbits 0x7ff0000000000000UL
+
+static ub8 mul64(ub8 a,ub8 b,ub8 *lo)
+{
+  unsigned __int128 p = (unsigned __int128)a * b;
+
+  *lo = (ub8)p;
+  return (ub8)(p >> 64);
+}
+
+// w > 0, Pow5min <= q <= Pow5max
+static ub8 lemire(ub8 w,int q)
+{
+  const ub8 *p5 = pow5tab + 2 * (q - Pow5min);
+  ub4 lz = (ub4)__builtin_clzl(w);
+  ub8 hi,lo,hi2,lo2,m;
+  ub4 up,sh;
+  int e2;
+
+  w <<= lz;
+  hi = mul64(w,p5[0],&lo);
+  if ((hi & 0x1ff) == 0x1ff) { // low bits may carry into the result
+    hi2 = mul64(w,p5[1],&lo2);
+    lo += hi2;
+    if (hi2 > lo) hi++;
+  }
+
+  up = (ub4)(hi >> 63);
+  sh = up + 9;
+  m = hi >> sh; // 54 bits
+  e2 = ((217706 * q) >> 16) + 63 + (int)up - (int)lz + 1023;
+
+  if (e2 <= 0) { // subnormal
+    if (1 - e2 >= 64) return 0;
+    m >>= 1 - e2;
+    m += m & 1; m >>= 1;
+    return m; // rounding up to 2^52 gives the least normal
+  }
+
+  // exactly halfway can only occur for small q : round to even
+  if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << sh) == hi) m &= ~1UL;
+
+  m += m & 1; m >>= 1;
+  if (m >= (2UL << 52)) { m = 1UL << 52; e2++; }
+  if (e2 >= 0x7ff) return Infbits;
+  return (ub8)e2 << 52 | (m & Manmsk);
+}
+
+static int rdexp(const ub1 **pp,const ub1 *e,int *px)
+{
+  const ub1 *p = *pp;
+  int x = 0;
+  bool neg = 0,any = 0;
+  ub1 c;
+
+  if (p < e && (*p == '+' || *p == '-')) neg = *p++ == '-';
+  for (; p < e; p++) {
+    c = *p;
+    if (c == '_') continue;
+    if (c < '0' || c > '9') break;
+    if (x < 100000) x = x * 10 + (c - '0');
+    any = 1;
+  }
+  *pp = p;
+  *px = neg ? -x : x;
+  return any == 0;
+}
+
+// rare : long mantissa close to a tie. Rebuild as 0.<digits>e<x> for strtod
+static double slowflt(const ub1 *p,const ub1 *e,int x)
+{
+  char buf[Slowdig + 32];
+  char xb[12];
+  ub4 n = 2,xn = 0;
+  int dx = 0;
+  bool dot = 0,lead = 1,sticky = 0;
+  ub1 c;
+
+  buf[0] = '0'; buf[1] = '.';
+  for (; p < e; p++) {
+    c = *p;
+    if (c == '_') continue;
+    if (c == '.') { dot = 1; continue; }
+    if (c < '0' || c > '9') break;
+    if (lead && c == '0') { dx -= dot; continue; }
+    lead = 0;
+    dx += !dot;
+    if (n < Slowdig) buf[n++] = (char)c;
+    else sticky |= c != '0';
+  }
+  if (sticky) buf[n++] = '1';
+  buf[n++] = 'e';
+  x += dx;
+  if (x < 0) { buf[n++] = '-'; x = -x; }
+  do { xb[xn++] = (char)('0' + x % 10); x /= 10; } while (x);
+  while (xn) buf[n++] = xb[--xn];
+  buf[n] = 0;
+  return strtod(buf,nil);
+}
+
+// m * 2^x rounded to nearest even, sticky for nonzero bits below m
+static ub8 hexbits(ub8 m,int x,bool sticky)
+{
+  ub4 lz,sh;
+  ub8 r,rem,half;
+  int e2;
+
+  if (m == 0) return 0;
+  lz = (ub4)__builtin_clzl(m);
+  m <<= lz; x -= (int)lz;
+  e2 = x + 63 + 1023;
+
+  if (e2 >= 0x7ff) return Infbits;
+  if (e2 > 0) sh = 11;
+  else if (12 - e2 > 64) return 0;
+  else sh = (ub4)(12 - e2);
+
+  if (sh == 64) { r = 0; rem = m; half = 1UL << 63; }
+  else { r = m >> sh; rem = m & ((1UL << sh) - 1); half = 1UL << (sh - 1); }
+  if (rem > half || (rem == half && (sticky || (r & 1)))) r++;
+
+  if (e2 <= 0) return r; // 2^52 gives the least normal
+  r += (ub8)(e2 - 1) << 52; // implicit bit carries into the exponent
+  return r >= Infbits ? Infbits : r;
+}
+
+static int hex2flt(const ub1 *p,const ub1 *e,double *pv)
+{
+  ub8 m = 0;
+  int x = 0,ex;
+  bool dot = 0,any = 0,sticky = 0;
+  ub1 c,d;
+
+  for (; p < e; p++) {
+    c = *p;
+    if (c == '_') continue;
+    if (c == '.' && dot == 0) { dot = 1; continue; }
+    if (c >= '0' && c <= '9') d = c - '0';
+    else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') d = (c | 0x20) - 'a' + 10;
+    else break;
+    any = 1;
+    if (m >> 60) { sticky |= d != 0; x += dot ? 0 : 4; }
+    else { m = m << 4 | d; x -= dot ? 4 : 0; }
+  }
+  if (any == 0) return 1;
+  if (p < e && (*p | 0x20) == 'p') {
+    p++;
+    if (rdexp(&p,e,&ex)) return 1;
+    x += ex;
+  }
+  if (p != e) return 1;
+  *pv = bits2flt(hexbits(m,x,sticky));
+  return 0;
+}
+
+// over Mandig digits : skip leading zeroes, keep Mandig and note whether the rest is nonzero
+static ub8 longman(const ub1 *p,const ub1 *e,int *pq,bool *ptrunc)
+{
+  ub8 w = 0;
+  ub4 nd = 0;
+  int q = 0;
+  bool dot = 0,trunc = 0;
+  ub1 c;
+
+  for (; p < e; p++) {
+    c = *p;
+    if (c == '_') continue;
+    if (c == '.') { dot = 1; continue; }
+    if (c < '0' || c > '9') break;
+    if (nd == 0 && c == '0') { q -= dot; continue; }
+    if (nd < Mandig) { w = w * 10 + (c - '0'); q -= dot; }
+    else { trunc |= c != '0'; q += !dot; }
+    nd++;
+  }
+  *pq = q;
+  *ptrunc = trunc;
+  return w;
+}
+
+// convert literal at s[0..len). Returns 0 if valid
+int str2flt(const ub1 *s,ub4 len,double *pv)
+{
+  const ub1 *p = s,*e = s + len;
+  ub8 w = 0,x8,v;
+  ub4 nd = 0,fd = 0;
+  int q = 0,ex = 0;
+  bool trunc = 0;
+  ub1 d;
+
+  if (len > 1 && s[0] == '0' && (s[1] | 0x20) == 'x') return hex2flt(s + 2,e,pv);
+
+  while (p < e) { // wraps beyond Mandig, redone below
+    if (p + 8 <= e && isdig8(v = ld8(p))) { w = w * 100000000 + dig8(v); nd += 8; p += 8; continue; }
+    d = *p - '0';
+    if (d > 9) { if (*p != '_') break; p++; continue; }
+    w = w * 10 + d; nd++; p++;
+  }
+  if (p < e && *p == '.') {
+    for (p++; p < e; ) {
+      if (p + 8 <= e && isdig8(v = ld8(p))) { w = w * 100000000 + dig8(v); nd += 8; fd += 8; p += 8; continue; }
+      d = *p - '0';
+      if (d > 9) { if (*p != '_') break; p++; continue; }
+      w = w * 10 + d; nd++; fd++; p++;
+    }
+  }
+  if (nd == 0) return 1;
+  if (p < e && (*p | 0x20) == 'e') {
+    p++;
+    if (rdexp(&p,e,&ex)) return 1;
+  }
+  if (p != e) return 1;
+
+  if (nd > Mandig) { w = longman(s,e,&q,&trunc); q += ex; }
+  else q = ex - (int)fd;
+
+  if (w == 0) { *pv = 0; return 0; }
+
+  if (trunc == 0 && w <= (1UL << 53) && q >= -22 && q <= 22) {
+    *pv = q < 0 ? (double)w / pow10tab[-q] : (double)w * pow10tab[q];
+    return 0;
+  }
+
+  if (q < Pow5min) x8 = 0;
+  else if (q > Pow5max) x8 = Infbits;
+  else {
+    x8 = lemire(w,q);
+    if (trunc && lemire(w + 1,q) != x8) { *pv = slowflt(s,e,ex); return 0; }
+  }
+  *pv = bits2flt(x8);
+  return 0;
+}
+
 int inimath(void)
 {
   ub8 x;
@@ -3,4 +3,10 @@
 extern ub4 rnd(ub4 range);
 extern double frnd(ub4 range);
 
+extern int str2int(const ub1 *s,ub4 len,ub8 *pv);
+extern int str2flt(const ub1 *s,ub4 len,double *pv);
+
+static inline double bits2flt(ub8 x) { union { ub8 u; double d; } v; v.u = x; return v.d; }
+static inline ub8 flt2bits(double x) { union { ub8 u; double d; } v; v.d = x; return v.u; }
+
 extern int inimath(void);
@@ -68,6 +68,8 @@ static const ub4 mmap_thres = 65536;
 
 static const ub4 mini_thres = 1024;
 
+static const ub8 huge_thres = 2 * Oshugepage; // rounded up to whole huge pages, wasting under a third
+
 static const ub4 maxalign = 16;
 static const ub4 stdalign = 8;
 static const ub4 minalignmask = 7;
@@ -81,6 +83,9 @@ static ub4 aiuses[2];
 
 static ub4 totalkb,maxkb;
 
+static ub8 pgcnts[3]; // pages mapped : small, huge advised, hugetlbfs
+static ub4 hugefall; // huge page requests that got less
+
 static cchar *descs[Memdesc * (Shsrc_mem+1)];
 static ub4 flns[Memdesc * (Shsrc_mem+1)];
 static ub2 elsizes[Memdesc * (Shsrc_mem+1)];
@@ -189,14 +194,14 @@ void *minalloc_fln(ub4 fln,ub4 n,ub2 a,ub2 fill,cchar *dsc)
 
   minpos = align4(minpos+redzone,a);
   if (minpos + n + redzone > mintop) {
-    if (mintop - minpos >= 65536) {
+    if (n >= 65536) { // large, own mapping
       n += redzone;
       vrb("mmap %u`",n);
       p = osmmap(n,ub1,1);
       return p;
     }
     if (mintop) {
-      inc = max(minchk,mintop - (minpos + n + redzone));
+      inc = max(minchk,n + 2 * redzone + a);
       info("inc %u` top %u",inc,mintop);
     } else {
       inc = minchk;
@@ -252,8 +257,8 @@ static struct ainfo *getai(const void *p,bool ismmap,bool add)
   pos = (hsh + hsh2) & mask;
   ai = aibas + pos;
   if (ai->ptr == p) return ai;
+  pos0 = pos;
   do {
-    pos0 = pos;
     pos = (pos + 1) & mask;
     ai = aibas + pos;
     if (ai->ptr == p) return ai;
@@ -327,7 +332,8 @@ void *alloc_fln(ub4 fln,ub8 nelem,ub4 elsiz,ub2 fil,const char *desc,ub2 counter
   ub4 nm,totalmb;
   struct ainfo *ai;
   ub2 allan,mod;
-  bool ismmap;
+  ub1 pgtyp;
+  bool ismmap,huge;
 
   if (elsiz == 0) fatal(fln,"zero elsize for %s",desc);
 
@@ -360,11 +366,21 @@ void *alloc_fln(ub4 fln,ub8 nelem,ub4 elsiz,ub2 fil,const char *desc,ub2 counter
   }
 
   nn = align8(fln,n,nxpwr2(align,nil),desc);
+  huge = (globs.hugepg && nn >= huge_thres);
+  if (huge) nn = (nn + Oshugepage - 1) & ~(Oshugepage - 1);
   addsum(nn);
   if (nn >= mmap_thres) {
     ismmap = 1;
     genmsg2(fln,Vrb,"Alloc %lu``B %s",nn,desc);
-    p = osmmap(nn,ub1,(fil & Mnores) != 0);
+    if (huge) {
+      p = osmmaphuge(fln,nn,globs.hugepg,(fil & Mnores) != 0,&pgtyp);
+      if (pgtyp) pgcnts[pgtyp] += nn / Oshugepage;
+      else pgcnts[0] += nn / ospagesize;
+      if (pgtyp < globs.hugepg) hugefall++;
+    } else {
+      p = osmmap(nn,ub1,(fil & Mnores) != 0);
+      pgcnts[0] += (nn + pagemask) / ospagesize;
+    }
     if (!p) fatal(fln,"cannot alloc %lu``B, total %u MB for %s: %m",nn,totalmb,desc);
     if (fil && fil < Mnofil) { genmsg2(fln,Info,"set %x for %s",fil,desc); memset(p,fil,nn); }
   } else {
@@ -534,9 +550,9 @@ ub4 blkexp_fln(ub4 fln,struct expmem *xp,ub4 cnt,ub4 typsiz)
   }
 
   nn = align4(cnt * elsiz,align);
-  xp->pos = nn;
+  xp->pos = pos + nn;
   if (bas == nil) {
-    nn = max(nn * elsiz,xp->ini);
+    nn = max(nn,xp->ini);
     if (nn <= Inilim) {
       bas = minalloc_fln(fln,nn,align,0,"blkexp");
       xp->min = 1;
@@ -610,4 +626,7 @@ void eximem(bool show)
 {
   vrb("max ai use %u,%u",aiuses[0],aiuses[1]);
   if (show & globs.resusg) info("max net   mem use %lu`B",(ub8)maxkb << 10);
+  if (show && (globs.resusg || globs.hugepg)) {
+    info("mapped pages %lu` of %u`B, %lu` huge advised, %lu` hugetlbfs, %u huge fallback%s",pgcnts[0],ospagesize,pgcnts[1],pgcnts[2],hugefall,hugefall == 1 ? "" : "s");
+  }
 }
@@ -157,10 +157,12 @@ static const char *shflnames[Shsrc_count] = {
   [Shsrc_msg]    = "msg",
   [Shsrc_lex]    = "lex",
   [Shsrc_lex1]   = "lextab",
+  [Shsrc_map]    = "map",
   [Shsrc_pre]    = "pre",
   [Shsrc_genir]  = "genir",
   [Shsrc_genlex] = "genlex",
   [Shsrc_gensyn] = "gensyn",
+  [Shsrc_genflt] = "genflt",
   [Shsrc_os]     = "os",
   [Shsrc_syn]    = "syn",
   [Shsrc_main]   = "lua",
@@ -393,15 +395,74 @@ void msglog(cchar *fnam,cchar *fext,cchar *desc)
   info("%s - intermediate %s code dump\n",path,desc);
 }
 
-/* returns file name,line,col given 32-bit linear pos
- * uses file and line table
- * interprets pos as line if no line table
+static struct filinf *srcfips;
+static ub4 srcfilcnt;
+static const ub1 *srcbas;
+
+/* files that positions refer to, in unit position order. Their line tables are left until a diag needs them
+   src is the base for files without their own buffer
+ */
+void setmsgsrc(struct filinf *fips,ub4 cnt,const ub1 *src)
+{
+  srcfips = fips;
+  srcfilcnt = cnt;
+  srcbas = src;
+}
+
+// file holding unit pos : the last one starting at or before
+static struct filinf *srcfile(ub4 pos)
+{
+  ub4 lo = 0,hi = srcfilcnt,m;
+
+  while (hi - lo > 1) {
+    m = (lo + hi) / 2;
+    if (srcfips[m].pos <= pos) lo = m;
+    else hi = m;
+  }
+  return srcfips + lo;
+}
+
+// line starts : 0, then offset past each newline. A streamed segment is mapped for this
+static ub4 *mksrclntab(struct filinf *fip)
+{
+  ub8 pagemsk = ospagesize - 1;
+  ub8 bas,mlen = 0;
+  ub4 delta;
+  ub1 *map = nil;
+  const ub1 *sp;
+  ub4 *tab;
+  int fd;
+
+  if (fip->src == hi32) return nil; // source not at hand
+  if (fip->seg) {
+    bas = fip->fofs & ~pagemsk;
+    delta = (ub4)(fip->fofs - bas);
+    mlen = min(delta + fip->src + fip->len,fip->flen - bas);
+    fd = osopen(fip->nam);
+    if (fd == -1) return nil;
+    map = osmmapfdwin(fd,bas,mlen,0);
+    osclose(fd);
+    if (map == nil) return nil;
+    sp = map + delta + fip->src;
+  } else sp = (fip->bas ? fip->bas : srcbas) + fip->src;
+
+  tab = myalloc((fip->lncnt + 1) * 4);
+  tab[0] = 0;
+  scannl(sp,fip->len,tab + 1,1);
+  fip->lntab = tab;
+  if (map) osmunmap(map,mlen);
+  return tab;
+}
+
+/* returns file name,line,col given 32-bit unit pos
+ * the file is found from its unit start pos. Its line table is built here on first use
+ * interprets pos as line if no source
  */
 static const char *getsrcpos(ub4 fpos,ub4 *plno,ub4 *pcol,ub4 *pparfpos)
 {
-  ub4 n,pos,len,lno,col,fpos0;
-  ub4 lncnt=0,*lntab=nil;
-  ub4 filcnt;
+  ub4 pos,len,lno,col;
+  ub4 lncnt,*lntab;
+  struct filinf *fip;
   bool linonly=0;
 
   *plno = 0; *pcol = 0;
@@ -410,13 +471,19 @@ static const char *getsrcpos(ub4 fpos,ub4 *plno,ub4 *pcol,ub4 *pparfpos)
   if (fpos == hi32) return nil;
   else if (fpos & Lno) { linonly = 1; fpos &= ~Lno; }
 
-  pos = fpos;
-  len = 0;
-  if (lntab == nil || linonly) { *plno = fpos; return ""; } // pass line numbers directly if no lntab
+  if (srcfilcnt == 0 || linonly) { *plno = fpos; return ""; } // pass line numbers directly if no source
+
+  fip = srcfile(fpos);
+  pos = fpos - fip->pos;
+  len = fip->len;
+  lncnt = fip->lncnt + 1;
+  lntab = fip->lntab;
+  if (lntab == nil) lntab = mksrclntab(fip);
+  if (lntab == nil) { *plno = fip->ln0; return fip->nam; }
 
   if (pos >= len) {
     if (pos - len > 4) warning("invalid pos %u.%4x above %u",pos,pos,len);
-    lno = lncnt; col = 0;
+    lno = lncnt - 1; pos = lntab[lno]; // past the last newline
   } else if (lncnt < 2) lno = 0;
   else {
     lno = bsearch4(lntab,lncnt,pos,FLN,"srcpos");
@@ -427,10 +494,10 @@ static const char *getsrcpos(ub4 fpos,ub4 *plno,ub4 *pcol,ub4 *pparfpos)
     col = pos - lntab[lno];
   } else col = pos;
   col++;
-  lno++;
+  lno += fip->ln0 + 1;
   *plno = lno; *pcol = col;
 
-  return "";
+  return fip->nam;
 }
 
 ub4 getsrcln(ub4 fpos)
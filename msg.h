@@ -39,22 +39,32 @@ enum Msgopts {
 struct filinf {
   cchar *path;
   char *nam;
+  ub1 *bas; // private mapping, nil if in prelex src
   ub4 lncnt;
+  ub4 *lntab; // line starts, built on the first diag that needs them
   ub4 src;
   ub4 len;
   ub4 parfid;
-  ub4 pos;
+  ub4 pos; // unit pos of first byte, as in token positions
   ub4 modid; // src byte offset of mod name
 
   ub4 ino,dev;
+  ub8 mtime; // in nsec as opened, for token cache
+  ub8 flen;
+  ub1 *lxf; // token cache entry on a hit, mapped
+  ub4 lxflen;
 
   ub2 incdir;
   ub2 dirsep;
   ub2 pfxno;
   ub1 typ;
-  ub1 dummy;
+  ub1 seg; // streamed window, not resident
+  ub1 mapped; // bas is a file mapping
+  ub4 ln0;  // first line of segment in file
+  ub8 fofs; // file offset of segment
 };
 
+extern void setmsgsrc(struct filinf *fips,ub4 cnt,const ub1 *src);
 extern ub4 getsrcln(ub4 fpos);
 
 extern ub4 msgwarncnt(void);
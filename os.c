@@ -47,9 +47,16 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
+
+#ifdef __linux__
+ #include <sys/inotify.h>
+#endif
 #include <unistd.h>
 
 #include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
 #include <signal.h>
 
 #ifdef USE_GLIBC_EXT
@@ -86,8 +93,20 @@ static ub4 errcnt;
 
 static volatile int sig_alrm,sig_vtalrm;
 
+static Thrlocal jmp_buf *exitjmp;
+
+// while set, a fatal error on this thread returns to setjmp(jb) instead of exiting. Used by watch. Returns the previous
+void *osexitjmp(void *jb)
+{
+  jmp_buf *prv = exitjmp;
+
+  exitjmp = (jmp_buf *)jb;
+  return prv;
+}
+
 Noret void doexit(int code)
 {
+  if (exitjmp) longjmp(*exitjmp,1);
   eximsg();
   _exit(code);
 }
@@ -109,6 +128,94 @@ int osopen(const char *name)
   return fd;
 }
 
+// call fn for each entry in dir except . and .. Returns entry count or -1
+int osdirlist(const char *dir,void (*fn)(void *arg,const char *nam,ub4 len),void *arg)
+{
+  DIR *d = opendir(dir);
+  struct dirent *de;
+  const char *nam;
+  int cnt = 0;
+
+  if (d == NULL) return -1;
+  while ( (de = readdir(d)) ) {
+    nam = de->d_name;
+    if (nam[0] == '.' && (nam[1] == 0 || (nam[1] == '.' && nam[2] == 0))) continue;
+    fn(arg,nam,(ub4)strlen(nam));
+    cnt++;
+  }
+  closedir(d);
+  return cnt;
+}
+
+// file change notification. Returns watch fd or -1 if unsupported
+int oswatchini(void)
+{
+#ifdef __linux__
+  int fd = inotify_init1(IN_CLOEXEC);
+
+  if (fd == -1) errorfln(FLN,0,"cannot init file watch: %m");
+  return fd;
+#else
+  return -1;
+#endif
+}
+
+// watch a file for completed writes and replacement. Returns watch id or -1
+int oswatchadd(int wfd,const char *name)
+{
+#ifdef __linux__
+  int wd = inotify_add_watch(wfd,name,IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF | IN_ATTRIB);
+
+  if (wd == -1) warning("cannot watch %s: %m",name);
+  return wd;
+#else
+  return -1;
+#endif
+}
+
+void oswatchdel(int wfd,int wd)
+{
+#ifdef __linux__
+  inotify_rm_watch(wfd,wd);
+#endif
+}
+
+/* wait for changes, then collect until quiet for ms to coalesce editor saves
+   stores unique watch ids in wds. Bit31 flags a replaced file : watch is gone
+   Returns count or -1
+ */
+int oswatchwait(int wfd,ub4 *wds,ub4 len,ub4 ms)
+{
+#ifdef __linux__
+  char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *ev;
+  struct pollfd pfd;
+  ssize_t nr;
+  ub4 i,wd,cnt = 0;
+  int tmo = -1;
+
+  pfd.fd = wfd;
+  pfd.events = POLLIN;
+
+  while (poll(&pfd,1,tmo) > 0) {
+    nr = read(wfd,buf,sizeof(buf));
+    if (nr <= 0) return -1;
+    for (ev = (const struct inotify_event *)buf; (char *)ev < buf + nr; ev = (const struct inotify_event *)((const char *)ev + sizeof(*ev) + ev->len)) {
+      if (ev->wd < 0 || (ev->mask & IN_IGNORED)) continue;
+      wd = (ub4)ev->wd;
+      if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) wd |= Bit31;
+      for (i = 0; i < cnt && (wds[i] & ~Bit31) != (wd & ~Bit31); i++) ;
+      if (i < cnt) wds[i] |= wd;
+      else if (cnt < len) wds[cnt++] = wd;
+    }
+    tmo = (int)ms;
+  }
+  return (int)cnt;
+#else
+  return -1;
+#endif
+}
+
 int osopenseq(const char *name,int *pfd)
 {
   int e;
@@ -138,6 +245,20 @@ int osfdinfo(struct osstat *sp,int fd)
 
   if (fstat(fd,&ino)) return 1;
   sp->mtime = (ub8)ino.st_mtime;
+  sp->mtimns = (ub8)ino.st_mtim.tv_sec * 1000000000UL + (ub8)ino.st_mtim.tv_nsec;
+  sp->len = (ub8)ino.st_size;
+  sp->ino = ino.st_ino;
+  sp->dev = ino.st_dev;
+  return 0;
+}
+
+int osfilinfo(struct osstat *sp,cchar *nam)
+{
+  struct stat ino;
+
+  if (stat(nam,&ino)) return 1;
+  sp->mtime = (ub8)ino.st_mtime;
+  sp->mtimns = (ub8)ino.st_mtim.tv_sec * 1000000000UL + (ub8)ino.st_mtim.tv_nsec;
   sp->len = (ub8)ino.st_size;
   sp->ino = ino.st_ino;
   sp->dev = ino.st_dev;
@@ -340,6 +461,40 @@ void *osmmapfd(ub8 len,int fd)
   return p;
 }
 
+/* map file window at page-aligned ofs private and writable, followed by at least pad writable bytes
+   A tail page is reserved anonymously and the file mapped over its start
+ */
+void *osmmapfdwin(int fd,ub8 ofs,ub8 len,ub4 pad)
+{
+#ifdef MAP_ANONYMOUS
+  ub8 pagemsk = ospagesize - 1;
+  ub8 flen = (len + pagemsk) & ~pagemsk;
+  ub8 mlen = (len + pad + pagemsk) & ~pagemsk;
+  int prot = PROT_READ | PROT_WRITE;
+  void *p,*q;
+
+  if (len == 0 || (ofs & pagemsk)) return nil;
+
+  p = mmap(NULL,mlen,prot,MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,-1,0);
+  if (p == MAP_FAILED) return nil;
+
+  q = mmap(p,flen,prot,MAP_PRIVATE | MAP_FIXED,fd,(off_t)ofs);
+  if (q == MAP_FAILED) {
+    munmap(p,mlen);
+    return nil;
+  }
+  posix_madvise(q,flen,POSIX_MADV_SEQUENTIAL);
+  return q;
+#else
+  return nil;
+#endif
+}
+
+void *osmmapfdpad(ub8 len,ub4 pad,int fd)
+{
+  return osmmapfdwin(fd,0,len,pad);
+}
+
 void *osmmapfln(ub4 fln,size_t nel,ub4 elsiz,bool reserve)
 {
   ub8 len;
@@ -380,6 +535,48 @@ void *osmmapfln(ub4 fln,size_t nel,ub4 elsiz,bool reserve)
   fatal(fln,"mmap failed for %lu` * %u: %m",nel,elsiz);
 }
 
+/* anonymous mapping of len, a multiple of Oshugepage, on huge pages where possible
+   mode 2 tries hugetlbfs pages first, as reserved in vm.nr_hugepages. Else, or mode 1, the range is aligned and advised for transparent huge pages
+   pgtyp tells what it got : 2 hugetlbfs, 1 advised, 0 plain pages
+ */
+void *osmmaphuge(ub4 fln,ub8 len,ub1 mode,bool reserve,ub1 *pgtyp)
+{
+#if defined __linux__ && defined MAP_ANONYMOUS && defined MADV_HUGEPAGE
+  int prot = PROT_READ | PROT_WRITE;
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  ub1 *p,*a;
+  ub8 hlen = len + Oshugepage;
+
+  if (len & (Oshugepage - 1)) fatal(fln,"huge mmap len %lu` not a multiple of %lu`",len,Oshugepage);
+
+#ifdef MAP_NORESERVE
+  if (reserve == 0) flags |= MAP_NORESERVE;
+#endif
+
+#ifdef MAP_HUGETLB
+  if (mode == 2) {
+    p = mmap(NULL,len,prot,MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,-1,0); // reserved, else a short pool faults on use
+    if (p != MAP_FAILED) { *pgtyp = 2; return p; }
+    genmsg2(fln,Vrb,"no hugetlb pages for %lu`B: %m",len);
+  }
+#endif
+
+  // map one more, then trim to an aligned range
+  p = mmap(NULL,hlen,prot,flags,-1,0);
+  if (p == MAP_FAILED) fatal(fln,"mmap failed for %lu`B: %m",hlen);
+  a = (ub1 *)(((ub8)p + Oshugepage - 1) & ~(Oshugepage - 1));
+  if (a > p) munmap(p,a - p);
+  if (a + len < p + hlen) munmap(a + len,p + hlen - (a + len));
+
+  *pgtyp = madvise(a,len,MADV_HUGEPAGE) == 0;
+  if (*pgtyp == 0) genmsg2(fln,Vrb,"no transparent huge pages for %lu`B: %m",len);
+  return a;
+#else
+  *pgtyp = 0;
+  return osmmapfln(fln,len,1,reserve);
+#endif
+}
+
 void *osmremapfln(ub4 fln,void *p,size_t elsiz,ub4 oldel,ub4 newel)
 {
   ub8 olen = elsiz * oldel;
@@ -537,6 +734,35 @@ static Noret void mysigact(int sig,siginfo_t *si,void *pp)
   _exit(rv);
 }
 
+/* run fn on cnt threads including the caller, wait for all
+   falls back to fewer threads if creation fails
+ */
+int osrunpar(ub4 cnt,void *(*fn)(void *),void *arg)
+{
+  pthread_t tids[64];
+  ub4 n,i;
+  int rv;
+
+  cnt = min(cnt,64);
+  for (n = 1; n < cnt; n++) {
+    rv = pthread_create(tids + n,NULL,fn,arg);
+    if (rv) {
+      warning("cannot create thread %u: %s",n,strerror(rv));
+      break;
+    }
+  }
+  fn(arg);
+
+  for (i = 1; i < n; i++) pthread_join(tids[i],NULL);
+  return (int)n;
+}
+
+static pthread_mutex_t osmtx = PTHREAD_MUTEX_INITIALIZER;
+
+// one process-wide lock
+void oslock(void) { pthread_mutex_lock(&osmtx); }
+void osunlock(void) { pthread_mutex_unlock(&osmtx); }
+
 void setsigs(void)
 {
   struct sigaction sa;
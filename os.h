@@ -21,6 +21,7 @@
 
 struct osstat {
   ub8 mtime;
+  ub8 mtimns; // mtime in nsec
   ub8 len;
   ub8 ino;
   ub8 dev;
@@ -38,6 +39,13 @@ extern char *getoserr(int *pe);
 
 extern int osopen(const char *name);
 extern int osopenseq(const char *name,int *pfd);
+extern void *osexitjmp(void *jb);
+
+extern int oswatchini(void);
+extern int oswatchadd(int wfd,const char *name);
+extern void oswatchdel(int wfd,int wd);
+extern int oswatchwait(int wfd,ub4 *wds,ub4 len,ub4 ms);
+extern int osdirlist(const char *dir,void (*fn)(void *arg,const char *nam,ub4 len),void *arg);
 extern int osappend(const char *name);
 
 extern int osread(int fd,char *buf,ub4 len,ub4 *nread);
@@ -50,6 +58,7 @@ extern int osclose(int fd);
 extern ub4 osseek(int fd,ub4 ofs,int org);
 
 extern int osfdinfo(struct osstat *mf,int fd);
+extern int osfilinfo(struct osstat *mf,cchar *nam);
 extern ub8 osfiltim(cchar *nam);
 
 extern int osremove(const char *name);
@@ -62,6 +71,9 @@ extern int osrewind(int fd);
 
 extern void *osmmapfln(ub4 fln,ub8 nel,ub4 elsiz,bool reserve);
 extern void *osmmapfd(ub8 len,int fd);
+extern void *osmmapfdpad(ub8 len,ub4 pad,int fd);
+extern void *osmmapfdwin(int fd,ub8 ofs,ub8 len,ub4 pad);
+extern void *osmmaphuge(ub4 fln,ub8 len,ub1 mode,bool reserve,ub1 *pgtyp);
 extern void *osmremapfln(ub4 fln,void *p,ub8 elsiz,ub4 oldel,ub4 newel);
 extern int osmunmapfln(ub4 fln,const void *p,ub8 len);
 
@@ -69,6 +81,10 @@ extern int osmunmapfln(ub4 fln,const void *p,ub8 len);
 // extern int osmlock(void);
 // extern int osmunlock(void);
 
+extern int osrunpar(ub4 cnt,void *(*fn)(void *),void *arg);
+extern void oslock(void);
+extern void osunlock(void);
+
 extern void setsigs(void);
 extern int oslimits(void);
 
@@ -78,3 +94,6 @@ extern int inios(void);
 extern void exios(bool show);
 
 extern ub4 ospagesize;
+
+#define Oshugepage (1UL << 21) // x86-64 and arm64 with 4KB pages
+
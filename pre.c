@@ -26,6 +26,8 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
+#include <setjmp.h>
 
 #include "base.h"
 #include "chr.h"
@@ -38,23 +40,27 @@
 
 #include "hash.h"
 
+#include "map.h"
+
 static ub4 msgfile = Shsrc_pre;
 #include "msg.h"
 
 #include "util.h"
 
 #include "pre.h"
+#include "lexsyn.h"
+#include "lex.h"
 
 #include "predef.h" // generated by genlex
 
 #define Depth 256
 
-// max token stream len
+// max token stream len, tokens plus lines of a unit. Also bounds streamed files : dense code reaches it near 1GiB
 #define Tokencnt (1U << 28)
 
 static bool verbose;
 
-static cchar *srcnam;
+static Thrlocal cchar *srcnam;
 
 static void lxdiag(enum Msglvl lvl,ub4 ln,ub4 col,cchar *state,cchar *pat,ub4 c,cchar *msg)
 {
@@ -83,44 +89,83 @@ static void lxinfo(ub4 ln,ub4 col,cchar *msg)
   vpmsg(FLN,Info,srcnam,ln+1,col+1,"",nil,msg);
 }
 
-static ub1 inolut[256];
-
-static bool samefile(ub4 cnt,struct filinf *files,struct osstat *osp)
-{
-  ub8 ino = osp->ino;
-  ub8 dev = osp->dev;
-
-  ub4 i = (ino & hi32) ^ (ino >> 32);
-  ub4 f;
+/* set of (dev,ino) for files seen, open addressing with linear probe
+   A lookup hitting an empty slot first is short-circuited : no key compare
+   ord is the order seen, to count what a linear scan over the files would have compared
+ */
+struct inokey {
+  ub8 ino,dev;
+  ub4 ord;
+};
 
-  ub1 x = inolut[i & 0xff]
-      | inolut[(i >> 8) & 0xff]
-      | inolut[(i >> 16) & 0xff]
-      | inolut[i >> 24];
-  if (x != 0xf) return 0;
+static struct inokey *inoset;
+static ub4 inosetlen,inosetcnt;
+static ub4 inolookups,inoshort,inoprobes;
+static ub8 inoscans;
 
-  ub4 d = (dev & hi32) ^ (dev >> 32);
+static void mkinoset(ub4 len)
+{
+  inosetlen = len;
+  inosetcnt = 0;
+  inoset = alloc(len,struct inokey,0,"pre inoset",nextcnt);
+}
 
-  x = inolut[d & 0xff]
-      | inolut[(d >> 8) & 0xff]
-      | inolut[(d >> 16) & 0xff]
-      | inolut[d >> 24];
+static ub4 inohome(ub8 ino,ub8 dev,ub4 len)
+{
+  ub8 h = (ino ^ (dev << 29) ^ (dev >> 35)) * 0x9e3779b97f4a7c15UL;
 
-  if (x != 0xf0) return 0;
+  return (ub4)(h >> 32) & (len - 1);
+}
 
-  for (f = 0; f < cnt; f++) {
-    if (files[f].ino == ino && files[f].dev == dev) return 1;
+static ub4 inoslot(struct inokey *set,ub4 len,ub8 ino,ub8 dev)
+{
+  ub4 v = inohome(ino,dev,len);
+  struct inokey *kp;
+
+  while (1) {
+    kp = set + v;
+    if (kp->ino == 0 && kp->dev == 0) return v;
+    if (kp->ino == ino && kp->dev == dev) return v;
+    v = (v + 1) & (len - 1);
   }
-  inolut[i & 0xff] |= 1;
-  inolut[(i >> 8) & 0xff] |= 2;
-  inolut[(i >> 16) & 0xff] |= 4;
-  inolut[i >> 24] |= 8;
-
-  inolut[d & 0xff] |= 16;
-  inolut[(d >> 8) & 0xff] |= 32;
-  inolut[(d >> 16) & 0xff] |= 64;
-  inolut[d >> 24] |= 128;
+}
 
+// return 1 if seen before, else add
+static bool samefile(struct osstat *osp)
+{
+  ub8 ino = osp->ino;
+  ub8 dev = osp->dev;
+  struct inokey *kp,*nset;
+  ub4 i,v,nlen;
+
+  if (ino == 0 && dev == 0) ino = hi32; // reserved as empty
+
+  inolookups++;
+  v = inoslot(inoset,inosetlen,ino,dev);
+  inoprobes += ((v - inohome(ino,dev,inosetlen)) & (inosetlen - 1)) + 1;
+  kp = inoset + v;
+  if (kp->ino == ino && kp->dev == dev) { // duplicate, not loaded again
+    inoshort++;
+    inoscans += kp->ord + 1;
+    return 1;
+  }
+  inoscans += inosetcnt;
+
+  kp->ino = ino;
+  kp->dev = dev;
+  kp->ord = inosetcnt;
+
+  if (++inosetcnt * 2 > inosetlen) { // grow at half load
+    nlen = inosetlen * 2;
+    nset = alloc(nlen,struct inokey,0,"pre inoset",nextcnt);
+    for (i = 0; i < inosetlen; i++) {
+      kp = inoset + i;
+      if (kp->ino | kp->dev) nset[inoslot(nset,nlen,kp->ino,kp->dev)] = *kp;
+    }
+    afree(inoset,"pre inoset",nextcnt);
+    inoset = nset;
+    inosetlen = nlen;
+  }
   return 0;
 }
 
@@ -140,93 +185,311 @@ static int tryopen(cchar *dir,cchar *name,bool need)
   return fd;
 }
 
+/* include path index, built once per run and freed after its file opens
+   top-level entry name to mask of include dirs holding it. Read-only while workers run
+ */
+static struct map incmap;
+static ub8 *incmasks;
+static ub4 incmasklen;
+static ub2 incdircnt;
+static ub4 incscans,incavoid;
+
+static void incadd(void *arg,cchar *nam,ub4 len)
+{
+  ub2 dir = *(ub2 *)arg;
+  ub4 x,nlen;
+
+  if (len >= hi16) return;
+  x = mapgetadd(&incmap,(const ub1 *)nam,(ub2)len,hashstr((const ub1 *)nam,len,0));
+  if (x >= incmasklen) {
+    nlen = incmasklen * 2;
+    incmasks = remalloc(incmasks,nlen * 8);
+    memset(incmasks + incmasklen,0,(nlen - incmasklen) * 8);
+    incmasklen = nlen;
+  }
+  incmasks[x] |= 1UL << dir;
+}
+
+// dir contents may change between runs, as in watch
+static void rmincidx(void)
+{
+  if (incmasks == nil) return;
+  rmmap(&incmap);
+  mfree(incmasks);
+  incmasks = nil;
+  incmasklen = 0;
+  incdircnt = 0;
+}
+
+static void mkincidx(struct prelex *presp)
+{
+  ub2 dir;
+
+  rmincidx(); // left by a failed run
+  incdircnt = 0;
+  incscans = incavoid = 0;
+  if (presp->incdircnt == 0 || presp->incdircnt > 64) return;
+
+  mkmap(&incmap,256,4096);
+  incmasklen = 256;
+  incmasks = myalloc(incmasklen * 8);
+  memset(incmasks,0,incmasklen * 8);
+
+  for (dir = 0; dir < presp->incdircnt; dir++) {
+    if (osdirlist(presp->incdirs[dir],incadd,&dir) < 0) vrb("cannot read include dir %s",presp->incdirs[dir]);
+    incscans++;
+  }
+  incdircnt = presp->incdircnt;
+}
+
+// open path in the first include dir holding it. Only dirs having its first component are tried
+static int incopen(char *chkpath,cchar *path,ub2 plen,cchar **incdirs,ub4 *pavoid)
+{
+  ub2 dlen = 0;
+  ub4 x,tries = 0;
+  ub8 mask;
+  ub2 dir = incdircnt;
+  int fd = -1;
+
+  while (dlen < plen && path[dlen] != '/') dlen++;
+  x = mapget(&incmap,(const ub1 *)path,dlen,hashstr((const ub1 *)path,dlen,0));
+  mask = x ? incmasks[x] : 0;
+
+  while (mask) {
+    dir = (ub2)__builtin_ctzll(mask);
+    mask &= mask - 1;
+    mysnprintf(chkpath,0,Pathname-2,"%s/%.*s",incdirs[dir],plen,path);
+    tries++;
+    fd = tryopen(nil,chkpath,0);
+    if (fd != -1) break;
+    dir = incdircnt;
+  }
+  *pavoid = min(dir + 1,incdircnt) - tries; // linear search would have tried all up to dir
+  return fd;
+}
+
 static ub4 wrfid(ub1 *p,ub4 n,ub4 id)
 {
   p[n] = id & 0xff;
   p[n+1] = (id >> 8) & 0xff;
-  p[n+3] = (id >> 16) & 0xff;
+  p[n+2] = (id >> 16) & 0xff;
   return n+3;
 }
 
-static ub4 idsketch;
-#define R(x) ~(x) & ((x)+1)
+/* hyperloglog ident cardinality, after flajolet et al '07 and heule et al '13
+   2^Hllbit one-byte registers, std error 1.04 / sqrt(Hllcnt) ~ 3%. Merged by max
+ */
+#define Hllbit 10
+#define Hllcnt (1U << Hllbit)
 
-// cs.princeton.edu/~rs/talks/AC11-Cardinality.pdf  philippe flajolet / martin '85
-static void exp_first0(ub4 x,ub4 *sketchs)
+static void hll_add(ub1 *regs,ub4 hc)
 {
-  ub4 i,s = ((x >> 16) ^ x) * 0x45d9f3b; // int32 hash after thomas muller
-
-  s = ((s >> 16) ^ s) * 0x45d9f3b;
-  s = (s >> 16) ^ s;
-  i = s & 0xf;
+  ub8 h = hc * 0x9e3779b97f4a7c15UL; // spread 32-bit hash to 64 after splitmix64
+  ub4 i;
+  ub1 r;
 
-  ub4 e = R(x);
+  h ^= h >> 31; h *= 0xbf58476d1ce4e5b9UL;
+  h ^= h >> 27; h *= 0x94d049bb133111ebUL;
+  h ^= h >> 31;
 
-  sketchs[i] |= e;
-  idsketch |= e;
+  i = (ub4)(h >> (64 - Hllbit));
+  r = (ub1)__builtin_clzll((h << Hllbit) | (1UL << (Hllbit - 1))) + 1;
+  if (r > regs[i]) regs[i] = r;
 }
 
-static ub4 exp_est(ub4 *sketchs)
+static ub4 hll_est(const ub1 *regs)
 {
-  ub4 x,sum=0,i;
+  double sum = 0,e;
+  double m = Hllcnt;
+  ub4 i,zcnt = 0;
 
-  for (i=0; i < 16; i++) {
-    x = R(sketchs[i]);
-    vrbo("%2u %08x",i,x);
-    sum += x;
+  for (i = 0; i < Hllcnt; i++) {
+    sum += 1.0 / (double)(1UL << regs[i]);
+    if (regs[i] == 0) zcnt++;
   }
-//  sum >>= 4;
-  x = R(idsketch);
-  info("  sketch %x vs %x",sum,x);
+  e = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
 
-  return sum + (sum >> 1);
+  if (e <= 2.5 * m && zcnt) e = m * log(m / zcnt); // linear counting for small sets
+  return (ub4)(e + 0.5);
 }
 
 #define Modstk 256
 
+// scan estimates of a file, kept per file for incremental update
+struct precnt {
+  ub4 tkcnt,tacnt,cmtcnt;
+  ub4 idcnt;
+  ub4 slitncnt,slit1cnt,slit2cnt,slitpos;
+  ub4 nlit1cnt,nlitcnt;
+  ub4 acnt,bitcnt;
+  ub4 lncnt;
+  ub4 modhc; // required module names
+  ub2 hidepth;
+
+  ub1 idregs[Hllcnt];
+};
+
+// module found in source, relative to its sp
 struct mod {
   ub4 nam;
   ub2 len;
   ub1 typ;
 };
 
-static struct mod modstk[Modstk];
-static ub2 modsp;
+static ub2 Pad = 6; // 2 eof 1 nl 3 fid
 
-static void addmod(ub4 spos,ub4 N,ub4 len,ub1 typ)
-{
-  struct mod *m = modstk + modsp;
+// files below this are read, larger ones mapped if enabled
+#define Mapthres (1U << 16)
 
-  m->nam = spos + N;
-  m->len = len;
-  m->typ = typ;
-  modsp++;
-}
+// default window for files above 4G
+#define Window (1U << 28)
 
-static ub2 Pad = 6; // 2 eof 1 nl 3 fid
+// open brackets carried from one segment to the next
+struct prebo {
+  ub2 lvl;
+  ub1 c[Depth];
+  ub4 ln[Depth];
+};
 
-int prelex(cchar *srcpath,enum Inctyp inc,struct prelex *presp,ub8 T0)
+enum Prest { Pre_ok,Pre_dup,Pre_empty,Pre_noopen,Pre_noinfo,Pre_stream,Pre_rderr,Pre_lxerr };
+
+/* per-file work item. Loaded and scanned by a worker in parallel mode, then merged in fixed order
+   Keeps all counts local such that merge order alone defines the result
+ */
+struct prefil {
+  char path[Pathname]; // as given
+  char chkpath[Pathname]; // as opened
+  ub2 plen;
+  ub1 typ;
+  enum Prest st;
+  bool own; // own buffer, else in srcmem
+  bool mapped;
+  bool cont; // continuation window of streamed file
+  bool more; // streamed, not the last window
+  struct prebo *bo; // streamed : brackets open at start, at end after scan
+  ub4 ln0; // streamed : first line
+  ub4 incavoid; // failed opens saved by include index
+  int fd; // open for streaming
+
+  ub1 *src;
+  ub4 spos; // in srcmem if not own
+  ub4 slen;
+  ub4 ofs; // bom + shebang
+
+  struct osstat ino;
+
+  struct precnt c;
+
+  ub1 *lxf; // token cache entry on a hit
+  ub4 lxflen;
+
+  ub2 modcnt;
+  struct mod mods[Modstk];
+};
+
+static struct expmem srcmem;
+static struct expmem filmem;
+
+static ub4 mapcnt;
+
+// resolve, open and read or map. In parallel mode on a worker: no messages, no shared state
+static enum Prest preload(struct prefil *pf,enum Inctyp inc,struct prelex *presp,bool par)
 {
-  int rv = 1;
-  ub4 t0 = (ub4)(T0 / 1000);
-  ub4 dirsep = 0;
+  cchar *path = pf->path;
+  ub2 plen = pf->plen;
+  ub2 incdir = 0;
+  char *chkpath = pf->chkpath;
+  struct osstat *ino = &pf->ino;
+  ub1 *src = nil;
+  ub4 slen,nr;
   int fd;
-  cchar *parpath = nil;
-  cchar *path;
-  ub2 plen;
 
-  struct filinf *fip=nil;
-  ub4 filcnt = 0;
-  ub4 filid = 0,parfid;
+  if (inc == Icmd) {
+    fd = -1;
+    slen = plen;
+    strcpy(chkpath,"(cmdline)");
+  } else if (inc == Isys) { // search in system dirs and -I
+    if (incdircnt) fd = incopen(chkpath,path,plen,presp->incdirs,&pf->incavoid);
+    else {
+      fd = -1;
+      while (fd == -1 && incdir < presp->incdircnt) {
+        mysnprintf(chkpath,0,Pathname-2,"%s/%.*s",presp->incdirs[incdir++],plen,path);
+        fd = tryopen(nil,chkpath,0);
+      }
+    }
+    if (fd == -1) return Pre_noopen;
+  } else {
+    memcpy(chkpath,path,plen);
+    chkpath[plen] = 0;
+    fd = tryopen(nil,chkpath,0);
+    if (fd == -1 && inc == Iuser && presp->incdircnt) return preload(pf,Isys,presp,par); // then -I
+    if (fd == -1) return Pre_noopen;
+  }
 
-  struct mod *modp;
-  ub4 modid=0;
-  ub4 modcnt=0;
-  ub1 modtyp=0;
+  if (fd != -1) {
+    if (osfdinfo(ino,fd)) { osclose(fd); return Pre_noinfo; }
 
-  struct expmem srcmem;
-  struct expmem filmem;
-  ub4 spos=0;
+    if (par == 0 && samefile(ino)) {
+      osclose(fd);
+      return Pre_dup;
+    }
+    if (ino->len >= hi32 - Pad || (presp->window && ino->len > presp->window)) { // process in windows
+      pf->fd = fd;
+      return Pre_stream;
+    }
+    slen = (ub4)ino->len;
+    if (slen == 0) { osclose(fd); return Pre_empty; }
+  }
+  pf->slen = slen;
+
+  if (fd != -1 && presp->domap && slen >= Mapthres) { // map in place, tail page holds pad
+    src = osmmapfdpad(slen,Pad,fd);
+    if (src) {
+      osclose(fd);
+      pf->own = pf->mapped = 1;
+      pf->src = src;
+      return Pre_ok;
+    }
+  }
+
+  if (par) { // private buffer
+    src = myalloc(slen + Pad);
+    pf->own = 1;
+  } else {
+    pf->spos = blkexp(&srcmem,slen+Pad,ub1);
+    src = srcmem.bas + pf->spos;
+  }
+  pf->src = src;
+
+  if (fd == -1) {
+    memcpy(src,path,slen);
+    return Pre_ok;
+  }
+
+  if (osread(fd,(char *)src,slen,&nr)) { osclose(fd); return Pre_rderr; }
+  osclose(fd);
+  if (nr != slen) return Pre_rderr;
+  return Pre_ok;
+}
+
+#define addmod(spos,N,len,typ) pfaddmod(pf,N,len,typ)
+
+static void pfaddmod(struct prefil *pf,ub4 N,ub4 len,ub1 typ)
+{
+  struct mod *m = pf->mods + pf->modcnt;
+
+  if (pf->modcnt + 1 >= Modstk) serror(N,"exceeding %u modules in %s",Modstk,pf->chkpath);
+  m->nam = N;
+  m->len = len;
+  m->typ = typ;
+  pf->modcnt++;
+}
+
+// pre-scan a loaded source
+static void prescan(struct prefil *pf)
+{
+  ub1 *src = pf->src;
+  ub4 slen = pf->slen;
 
   // estimates
   ub4 tkcnt=0;
@@ -234,9 +497,8 @@ int prelex(cchar *srcpath,enum Inctyp inc,struct prelex *presp,ub8 T0)
   ub4 cmtcnt = 0;
 
   // idents
-  ub4 euidcnt,idcnt = 0;
-
-  ub4 idsketchs[16];
+  ub4 idcnt = 0;
+  ub1 *idregs = pf->c.idregs;
 
   // string lits
   ub4 slitncnt = 0;
@@ -244,18 +506,22 @@ int prelex(cchar *srcpath,enum Inctyp inc,struct prelex *presp,ub8 T0)
   ub4 slit2cnt = 0;
   ub4 slitpos = 0;
 
+  // long brackets
+  ub4 lvl = 0,lnl,lnx,lx;
+
   ub4 nlit1cnt = 0;
   ub4 nlitcnt = 0;
 
   ub4 acnt = 0;
   ub4 bitcnt = 0;
 
+  ub4 modcnt=0;
+
   // main char pointers
-  ub4 N,n = 0,nn,ninc=0;
+  ub4 N=0,n = 0,nn;
 
   // line control
   ub4 l=0,L=0;
-  ub4 lncnt=0;
   ub4 nlcol=0,Nlcol=0;
 
   // match brackets
@@ -264,230 +530,892 @@ int prelex(cchar *srcpath,enum Inctyp inc,struct prelex *presp,ub8 T0)
   ub4 bolvls[Depth]; // lineno of opening brace
   ub4 bclvls[Depth]; // lineno of last closing brace
 
-  ub1 c,t,*sp=nil,*src;
-  ub2 incdir=0;
-  ub4 slen=0;
-  ub2 len;
-  ub4 nr;
-  ub4 hc;
+  ub1 c,t,*sp;
+  ub2 len=0;
+  ub4 hc,dx;
   bool isreq = 0;
 
-  struct osstat ino;
-  char chkpath[Pathname];
+  srcnam = pf->chkpath;
 
-  ub8 T1=0;
+  memset(bolvlc,0,Depth);
 
-  memset(idsketchs,0,16 * 4);
+  if (pf->bo) {
+    bolvl = pf->bo->lvl;
+    memcpy(bolvlc,pf->bo->c,bolvl);
+    memcpy(bolvls,pf->bo->ln,bolvl * sizeof(ub4));
+    l = pf->ln0;
+  }
 
-  // source file store
-  memset(&srcmem,0,sizeof(srcmem));
-  srcmem.inc = (1U << 14);
-  srcmem.ini = 1024;
-  srcmem.elsiz = 1;
-  srcmem.align = 1;
-  srcmem.min = 1;
+  if (pf->cont) n = nn = 0;
+  else if (src[0] == 0xef && slen > 2 && src[1] == 0xbb && src[2] == 0xbf) { // skip utf8 bom
+    n = 3;
+    if (slen == 3) { pf->st = Pre_empty; return; }
+  } else n = 0;
 
- // file IDs
-  memset(&filmem,0,sizeof(filmem));
-  srcmem.inc = (1U << 12);
-  srcmem.ini = 1024;
-  srcmem.elsiz = sizeof(struct filinf);
-  srcmem.align = 4;
-  srcmem.min = 1;
+  nn = n;
+  if (pf->cont == 0 && slen - n > 3 && src[nn] == '#' && src[nn+1] == '!') { // skip shebang
+    while (nn < slen && src[nn] != '\n') nn++;
+    if (nn + 1 >= slen) { pf->st = Pre_empty; return; }
+  }
+  slen -= nn;
+  pf->ofs = nn;
 
-  memset(&inolut,0,sizeof(inolut));
+  sp = src + nn;
+  n = 0;
+  sp[slen]   = 0; // eof
+  sp[slen+1] = 0;
 
-  path = srcpath;
-  plen = (ub4)strlen(path);
+#include "lua_pre.i"
 
-  while (path[n]) { if (path[n] == '/') dirsep = n; n++; }
-  if (n == dirsep + 1) { errorfln(FLN,0,"lex: path '%s' is a directory",path); return 1; }
+  // come here at eof
 
-  timeit(&T1,nil);
+  if (pf->bo) {
+    pf->bo->lvl = bolvl;
+    memcpy(pf->bo->c,bolvlc,bolvl);
+    memcpy(pf->bo->ln,bolvls,bolvl * sizeof(ub4));
+  }
 
- do {
+  if (sp[slen-1] != '\n') sp[slen++] = '\n'; // for next pass
 
-  if (inc == Icmd) {
-    fd = -1;
-    slen = (ub4)strlen(path);
-    srcnam = "(cmdline)";
+  sp[slen]   = 0; // eof
 
-  } else if (inc == Inone || dirsep == 0 || parpath == nil) {
-    memcpy(chkpath,path,plen);
-    chkpath[plen] = 0;
-    fd = tryopen(nil,chkpath,1);
-    if (fd == -1) return 1;
+  pf->slen = slen;
+
+  // line count while hot in cache. The table is built when a diag or emit needs it
+  pf->c.lncnt = scannl(sp,slen,nil,1);
+
+  pf->c.tkcnt = tkcnt; pf->c.tacnt = tacnt; pf->c.cmtcnt = cmtcnt;
+  pf->c.idcnt = idcnt;
+  pf->c.slitncnt = slitncnt; pf->c.slit1cnt = slit1cnt; pf->c.slit2cnt = slit2cnt; pf->c.slitpos = slitpos;
+  pf->c.nlit1cnt = nlit1cnt; pf->c.nlitcnt = nlitcnt;
+  pf->c.acnt = acnt; pf->c.bitcnt = bitcnt;
+  pf->c.hidepth = (ub2)((ub1 *)memchr(bolvlc,0,Depth) - bolvlc);
+}
+
+#undef addmod
 
-  } else if (inc == Iuser) { // search in dir of includer
-    mysnprintf(chkpath,0,Pathname-2,"%.*s/%.*s",dirsep,parpath,plen,path);
-    fd = tryopen(nil,chkpath,1);
-    if (fd == -1) return 1;
+// prescan off the main flow. In edit mode a source error marks the file Pre_lxerr instead of exiting
+static void prescanx(struct prefil *pf,bool edit)
+{
+  jmp_buf jb;
+  void *prv;
 
-  } else { // search in system dirs and -I
+  if (edit == 0) { prescan(pf); return; }
 
-    do {
-      mysnprintf(chkpath,0,Pathname-2,"%s/%.*s",presp->incdirs[incdir],plen,path);
-      fd = tryopen(nil,chkpath,0);
-    } while (fd == -1 && ++incdir < presp->incdircnt);
-    if (fd == -1) { errorfln(FLN,0,"cannot open %.*s",plen,path); return 1; }
+  prv = osexitjmp(nil);
+  if (setjmp(jb)) {
+    osexitjmp(prv);
+    pf->st = Pre_lxerr;
+    return;
   }
+  osexitjmp(jb);
+  prescan(pf);
+  osexitjmp(prv);
+}
 
-  if (fd != -1) {
-    if (osfdinfo(&ino,fd)) { osclose(fd); errorfln(FLN,0,"cannot get info for %s",chkpath); return 1; }
-    if (ino.len >= hi32) { osclose(fd); errorfln(FLN,0,"%s length %lu` exceeds 4G",chkpath,ino.len); return 1; }
+/* token cache, see lxfhdr in pre.h
+   The prelex record has the counts, scan start and len, and the module names as found
+   Modules are resolved again on each run, such that the include dirs are not part of the key
+ */
+struct precrec {
+  struct precnt c;
+  ub4 ofs,slen;
+  ub4 modcnt,pad;
+}; // followed by modcnt mods
 
-    if (samefile(filcnt,(struct filinf *)filmem.bas,&ino)) {
-      info("skip duplicate %s ",chkpath);
-      osclose(fd);
-      goto endfil;
-    }
-    slen = (ub4)ino.len;
-    srcnam = path;
+static ub4 prehc; // hash of the prelexer
 
-    if (slen == 0) {
-      info("%s is empty",chkpath);
-      osclose(fd);
-      goto endfil;
-    }
+static void lxfname(char *buf,cchar *dir,ub8 dev,ub8 ino)
+{
+  mysnprintf(buf,0,Pathname,"%s/%lx-%lx.lxf",dir,dev,ino);
+}
+
+static ub4 lxflen(const struct lxfhdr *hp)
+{
+  ub4 i,pos = sizeof(struct lxfhdr);
+
+  for (i = 0; i < Lxfparts; i++) {
+    if (hp->lens[i] >= hi32 - pos - 8) return hi32;
+    pos = (pos + hp->lens[i] + 7) & ~7U;
   }
+  return pos;
+}
 
-  spos = blkexp(&srcmem,slen+Pad,ub1);
-  src = srcmem.bas + spos;
+// start of a part in a mapped entry
+const void *prepart(const ub1 *lxf,ub4 part)
+{
+  const struct lxfhdr *hp = (const struct lxfhdr *)lxf;
+  ub4 i,pos = sizeof(struct lxfhdr);
 
-  if (fd != -1) {
-    rv = osread(fd,(char *)src,slen,&nr);
-    if (rv) {
-      error("cannot read %s %m",chkpath);
-      osclose(fd);
-      return 1;
-    }
+  for (i = 0; i < part; i++) pos = (pos + hp->lens[i] + 7) & ~7U;
+  return lxf + pos;
+}
+
+/* map and check the entry of a loaded source. On a hit, pf is left as by prescan and keeps the mapping for lex
+   Called on a worker in parallel mode : no messages
+ */
+static bool precached(struct prefil *pf,struct prelex *presp)
+{
+  char cnam[Pathname];
+  struct osstat ost;
+  struct osstat *ino = &pf->ino;
+  const struct lxfhdr *hp;
+  const struct precrec *rp;
+  ub1 *bas,*sp;
+  ub4 slen;
+  int fd;
+
+  if (presp->cachedir == nil || (ino->ino == 0 && ino->dev == 0)) return 0;
+
+  lxfname(cnam,presp->cachedir,ino->dev,ino->ino);
+  if (osfilinfo(&ost,cnam) || ost.len < sizeof(struct lxfhdr) + sizeof(struct precrec) || ost.len >= hi32) return 0;
+  fd = osopen(cnam);
+  if (fd == -1) return 0;
+  bas = osmmapfd(ost.len,fd);
+  osclose(fd);
+  if (bas == nil) return 0;
+
+  hp = (const struct lxfhdr *)bas;
+  rp = prepart(bas,0);
+  slen = rp->slen;
+  if (hp->magic != Lxfmagic || hp->ver != Lxfver || hp->prehc != prehc || hp->lexhc != presp->lexhc
+      || hp->mtime != ino->mtimns || hp->flen != ino->len || hp->ino != ino->ino || hp->dev != ino->dev
+      || hp->len != ost.len || lxflen(hp) != hp->len
+      || rp->modcnt >= Modstk || hp->lens[0] != sizeof(struct precrec) + rp->modcnt * sizeof(struct mod)
+      || slen == 0 || rp->ofs + slen > pf->slen + 1) {
+    osmunmap(bas,ost.len);
+    return 0;
+  }
+
+  // as left by prescan
+  sp = pf->src + rp->ofs;
+  if (sp[slen-1] != '\n') sp[slen-1] = '\n';
+  sp[slen] = sp[slen+1] = 0;
+
+  memcpy(&pf->c,&rp->c,sizeof(pf->c));
+  pf->ofs = rp->ofs;
+  pf->slen = slen;
+  pf->modcnt = (ub2)rp->modcnt;
+  memcpy(pf->mods,rp + 1,rp->modcnt * sizeof(struct mod));
+
+  pf->lxf = bas;
+  pf->lxflen = (ub4)ost.len;
+  return 1;
+}
+
+// parallel work queue for one batch of modules
+struct prejob {
+  struct prefil *pfs;
+  ub4 cnt;
+  ub4 nxt; // atomic
+  enum Inctyp inc;
+  struct prelex *presp;
+};
+
+static void *preworker(void *arg)
+{
+  struct prejob *jp = arg;
+  struct prefil *pf;
+  ub4 i;
+
+  while ( (i = __atomic_fetch_add(&jp->nxt,1,__ATOMIC_RELAXED)) < jp->cnt) {
+    pf = jp->pfs + i;
+    pf->st = preload(pf,jp->inc,jp->presp,1);
+    if (pf->st == Pre_ok && precached(pf,jp->presp) == 0) prescanx(pf,jp->presp->edit);
+  }
+  return nil;
+}
+
+// running totals over all files and segments, plus the next batch
+struct pretot {
+  struct precnt c;
+
+  ub4 filcnt,modcnt,segcnt;
+  ub4 batch;
+  ub4 incavoid;
+  ub4 lxfhit; // token cache
+
+  struct prefil *nxpfs;
+  ub4 nxpfcnt,pflen;
+};
+
+static void addcnt(struct precnt *t,const struct precnt *c)
+{
+  ub4 i;
+
+  t->tkcnt += c->tkcnt; t->tacnt += c->tacnt; t->cmtcnt += c->cmtcnt;
+  t->idcnt += c->idcnt;
+  t->slitncnt += c->slitncnt; t->slit1cnt += c->slit1cnt; t->slit2cnt += c->slit2cnt; t->slitpos += c->slitpos;
+  t->nlit1cnt += c->nlit1cnt; t->nlitcnt += c->nlitcnt;
+  t->acnt += c->acnt; t->bitcnt += c->bitcnt;
+  t->lncnt += c->lncnt;
+  t->hidepth = max(t->hidepth,c->hidepth);
+  for (i = 0; i < Hllcnt; i++) t->idregs[i] = max(t->idregs[i],c->idregs[i]);
+}
+
+// per-file counts by file id, for preupdate()
+static struct precnt *fcnts;
+static ub4 fcntlen;
+
+// per-file scan start, len and modules by file id, for the token cache
+struct prefc {
+  ub8 ino,dev;
+  ub4 ofs,slen;
+  ub4 mod0,modcnt;
+};
+
+static struct prefc *fcs;
+static struct mod *fmods;
+static ub4 fmodcnt,fmodlen;
+
+static void fcntadd(ub4 filid,const struct prefil *pf)
+{
+  struct prefc *fc;
+
+  if (filid >= fcntlen) {
+    fcntlen = max(fcntlen * 2,filid + 16);
+    fcnts = remalloc(fcnts,fcntlen * sizeof(struct precnt));
+    fcs = remalloc(fcs,fcntlen * sizeof(struct prefc));
+  }
+  fcnts[filid] = pf->c;
+
+  if (fmodcnt + pf->modcnt > fmodlen) {
+    fmodlen = max(fmodlen * 2,fmodcnt + pf->modcnt + 64);
+    fmods = remalloc(fmods,fmodlen * sizeof(struct mod));
+  }
+  fc = fcs + filid;
+  fc->ino = pf->ino.ino; fc->dev = pf->ino.dev;
+  fc->ofs = pf->ofs; fc->slen = pf->slen;
+  fc->mod0 = fmodcnt; fc->modcnt = pf->modcnt;
+  memcpy(fmods + fmodcnt,pf->mods,pf->modcnt * sizeof(struct mod));
+  fmodcnt += pf->modcnt;
+}
+
+/* write the entry of file fid : header and prelex record here, lex parts 1 .. cnt-1 from the caller
+   Written aside and renamed, such that readers never see a partial entry. Failures only warn
+ */
+void prewrcache(struct prelex *presp,ub4 fid,const void **parts,const ub4 *lens,ub4 cnt)
+{
+  char cnam[Pathname],tnam[Pathname];
+  struct filinf *fip = presp->files + fid;
+  const struct prefc *fc = fcs + fid;
+  const struct mod *mp;
+  struct lxfhdr hdr;
+  struct precrec *rp;
+  struct mod *dp;
+  struct osstat ost;
+  ub4 i,pos,len;
+  ub1 *bas;
+  unsigned long nw;
+  int fd;
+
+  if (osfilinfo(&ost,fip->nam)) return;
+  if (ost.mtimns != fip->mtime || ost.len != fip->flen || ost.ino != fc->ino || ost.dev != fc->dev) { // changed while compiling
+    vrb("not caching %s: changed",fip->nam);
+    return;
+  }
+
+  memset(&hdr,0,sizeof(hdr));
+  hdr.magic = Lxfmagic;
+  hdr.ver = Lxfver;
+  hdr.prehc = prehc;
+  hdr.lexhc = presp->lexhc;
+  hdr.mtime = ost.mtimns;
+  hdr.flen = ost.len;
+  hdr.ino = ost.ino;
+  hdr.dev = ost.dev;
+  hdr.lens[0] = sizeof(struct precrec) + fc->modcnt * sizeof(struct mod);
+  for (i = 1; i < cnt && i < Lxfparts; i++) hdr.lens[i] = lens[i];
+  len = lxflen(&hdr);
+  if (len == hi32) { vrb("not caching %s: too large",fip->nam); return; }
+  hdr.len = len;
+
+  bas = alloc(len,ub1,0,"pre cache",nextcnt);
+  memcpy(bas,&hdr,sizeof(hdr));
+
+  rp = (struct precrec *)(bas + sizeof(hdr));
+  memcpy(&rp->c,fcnts + fid,sizeof(rp->c));
+  rp->ofs = fc->ofs;
+  rp->slen = fc->slen;
+  rp->modcnt = fc->modcnt;
+  dp = (struct mod *)(rp + 1);
+  for (i = 0; i < fc->modcnt; i++,dp++) { // fieldwise : padding stays zero
+    mp = fmods + fc->mod0 + i;
+    dp->nam = mp->nam; dp->len = mp->len; dp->typ = mp->typ;
+  }
+  pos = (sizeof(hdr) + hdr.lens[0] + 7) & ~7U;
+  for (i = 1; i < cnt && i < Lxfparts; i++) {
+    if (lens[i]) memcpy(bas + pos,parts[i],lens[i]);
+    pos = (pos + lens[i] + 7) & ~7U;
+  }
+
+  lxfname(cnam,presp->cachedir,ost.dev,ost.ino);
+  mysnprintf(tnam,0,Pathname,"%s.%u",cnam,globs.pid);
+  fd = oscreate(tnam);
+  if (fd == -1) { warning("cannot create token cache %s",tnam); afree(bas,"pre cache",nextcnt); return; }
+  if (oswrite8(fd,(cchar *)bas,len,&nw) || nw != len) {
+    warning("cannot write token cache %s",tnam);
     osclose(fd);
-    if (nr != slen) { error("partial read %'uB of %'uB of %s",(ub4)nr,slen,chkpath); return 1; }
+    osremove(tnam);
   } else {
-    memcpy(src,path,slen);
+    osclose(fd);
+    if (osrename(tnam,cnam)) warning("cannot rename token cache %s",tnam);
+  }
+  afree(bas,"pre cache",nextcnt);
+}
+
+// signature of required modules, to detect a changed module graph
+static ub4 modsig(struct prefil *pf,const ub1 *sp)
+{
+  ub4 m,hc = pf->modcnt;
+
+  for (m = 0; m < pf->modcnt; m++) hc = hashstr(sp + pf->mods[m].nam,pf->mods[m].len,hc);
+  return hc;
+}
+
+// add a scanned file or segment to the file table and totals, queue its modules. sp at start after bom
+static struct filinf *premerge(struct prefil *pf,struct pretot *tp,const ub1 *sp)
+{
+  struct filinf *fip;
+  struct prefil *nxpf;
+  struct mod *modp;
+  ub4 filid,plen,m;
+
+  filid = blkexp(&filmem,1,struct filinf);
+  fip = blkptr(&filmem,filid,struct filinf);
+  tp->filcnt++;
+
+  plen = strlen(pf->chkpath);
+  fip->ino = (ub4)pf->ino.ino;
+  fip->dev = (ub4)pf->ino.dev;
+  fip->mtime = pf->ino.mtimns;
+  fip->flen = pf->ino.len;
+  fip->modid = tp->batch;
+  fip->typ = pf->typ;
+  fip->nam = minalloc(plen+1,1,0,"pre nam");
+  memcpy(fip->nam,pf->chkpath,plen);
+  fip->lncnt = pf->c.lncnt;
+  fip->lntab = nil;
+  fip->len = pf->slen;
+
+  pf->c.modhc = modsig(pf,sp);
+  fcntadd(tp->filcnt - 1,pf);
+  if (pf->lxf) {
+    fip->lxf = pf->lxf;
+    fip->lxflen = pf->lxflen;
+    tp->lxfhit++;
   }
 
-  if (src[0] == 0xef && slen > 2 && src[1] == 0xbb && src[2] == 0xbf) { // skip utf8 bom
-    n = 3; slen -= 3;
-    if (slen == 3) {
-      info("%s is an empty utf-8 bom",chkpath);
-      goto endfil;
+  tp->incavoid += pf->incavoid;
+  addcnt(&tp->c,&pf->c);
+
+  if (tp->c.tkcnt + tp->c.lncnt >= Tokencnt) serror(0,"token count %u` exceeds limit %u`",tp->c.tkcnt + tp->c.lncnt,Tokencnt);
+
+  // queue modules for next batch
+  for (m = 0; m < pf->modcnt; m++) {
+    modp = pf->mods + m;
+    if (tp->nxpfs == nil) {
+      tp->pflen = 16;
+      tp->nxpfs = alloc(tp->pflen,struct prefil,Mnofil,"pre batch",nextcnt);
+    } else if (tp->nxpfcnt == tp->pflen) { // grow batch
+      nxpf = alloc(tp->pflen * 2,struct prefil,Mnofil,"pre batch",nextcnt);
+      memcpy(nxpf,tp->nxpfs,tp->pflen * sizeof(struct prefil));
+      afree(tp->nxpfs,"pre batch",nextcnt);
+      tp->nxpfs = nxpf;
+      tp->pflen *= 2;
     }
-  } else n = 0;
+    nxpf = tp->nxpfs + tp->nxpfcnt++;
+    memset(nxpf,0,sizeof(*nxpf) - sizeof(nxpf->mods));
+    plen = min(modp->len,Pathname-1);
+    memcpy(nxpf->path,sp + modp->nam,plen);
+    nxpf->plen = plen;
+    nxpf->typ = modp->typ;
+    tp->modcnt++;
+  }
+  return fip;
+}
 
-  nn = n;
-  if (slen > 3 && src[nn] == '#' && sp[nn+1] == '!') { // skip shebang
-    while (nn < slen && sp[nn] != '\n') nn++;
-    if (nn + 1 >= slen) {
-      info("%s is an empty shebang",chkpath);
-      goto endfil;
+// level + 1 if a long bracket [=*[ starts at n, else 0
+static ub4 lbopen(const ub1 *sp,ub4 n,ub4 len)
+{
+  ub4 i = n + 1;
+
+  if (n >= len || sp[n] != '[') return 0;
+  while (i < len && sp[i] == '=') i++;
+  if (i < len && sp[i] == '[') return i - n;
+  return 0;
+}
+
+/* length up to the last newline outside any token, 0 if none
+   Only long strings and comments, and short strings via \ escapes, span lines
+ */
+static ub4 segcut(const ub1 *sp,ub4 len)
+{
+  ub4 n = 0,cut = 0,lvl,x,lnl,lnx;
+  const ub1 *p;
+  ub1 c,q;
+
+  while (n < len) {
+    c = sp[n++];
+    switch (c) {
+    case '\n': cut = n; break;
+
+    case '[':
+      if ( (lvl = lbopen(sp,n-1,len)) == 0) break;
+      n += lvl;
+      x = scanlong(sp+n,len-n,lvl-1,&lnl,&lnx);
+      n += x + lvl + 1;
+      break;
+
+    case '-':
+      if (n == len || sp[n] != '-') break;
+      n++;
+      if ( (lvl = lbopen(sp,n,len)) ) {
+        n += lvl + 1;
+        x = scanlong(sp+n,len-n,lvl-1,&lnl,&lnx);
+        n += x + lvl + 1;
+      } else {
+        p = memchr(sp + n,'\n',len - n);
+        n = p ? (ub4)(p - sp) : len;
+      }
+      break;
+
+    case '"': case '\'':
+      q = c;
+      while (n < len && (c = sp[n]) != q && c != '\n') {
+        n++;
+        if (c != '\\' || n == len) continue;
+        c = sp[n++]; // escaped newline or quote
+        if (c == '\r' && n < len && sp[n] == '\n') n++;
+        else if (c == 'z') { while (n < len && sp[n] <= ' ') n++; }
+      }
+      n++;
+      break;
     }
-    slen -= (nn - n);
   }
+  return cut;
+}
 
-  filid = blkexp(&filmem,1,struct filinf);
-  fip = blkptr(&filmem,filid,struct filinf);
+/* prelex a file above the window size as a series of line-aligned segments
+   Only one window is mapped at a time. Lex maps each segment again via mapseg()
+   This bounds the mapped source only : lex keeps the tokens of the whole unit, up to Tokencnt
+ */
+static int prestream(struct prefil *pf,struct prelex *presp,struct pretot *tp)
+{
+  int fd = pf->fd;
+  ub8 pagemsk = ospagesize - 1;
+  ub8 flen = pf->ino.len;
+  ub8 ofs = 0,bas;
+  ub4 win = presp->window ? presp->window : Window;
+  ub4 delta,len,cut,mlen,ln0 = 0;
+  ub1 *map,*sp;
+  struct prebo bo;
+  struct prefil *sf;
+  struct filinf *fip;
+
+  win = min(win,hi32 - 2 * (ub4)ospagesize);
+  win = max(win,(ub4)ospagesize);
+
+  sf = alloc(1,struct prefil,Mnofil,"pre seg",nextcnt);
+  bo.lvl = 0;
+
+  vrb("stream %s of %lu` in %u` windows",pf->chkpath,flen,win);
+
+  while (ofs < flen) {
+    bas = ofs & ~pagemsk;
+    delta = (ub4)(ofs - bas);
+    len = (ub4)min(flen - ofs,win);
+    mlen = delta + len;
+    map = osmmapfdwin(fd,bas,mlen,Pad);
+    if (map == nil) { errorfln(FLN,0,"cannot map %s at %lu`",pf->chkpath,ofs); break; }
+    sp = map + delta;
+
+    if (ofs + len < flen) { // cut after last complete line outside a token
+      cut = segcut(sp,len);
+      if (cut == 0) {
+        osmunmap(map,mlen + Pad);
+        errorfln(FLN,0,"%s: line or token at %lu` exceeds window %u`",pf->chkpath,ofs,win);
+        break;
+      }
+      len = cut;
+    }
 
-  plen = strlen(chkpath);
-  fip->ino = (ub4)ino.ino;
-  fip->dev = (ub4)ino.dev;
-  fip->modid = modid;
-  fip->typ = modtyp;
-  fip->nam = minalloc(plen+1,1,0,"pre nam");
-  memcpy(fip->nam,chkpath,plen);
-  sp = src + n + nn;
-  fip->src = spos + n + nn;
+    memset(sf,0,sizeof(*sf) - sizeof(sf->mods));
+    memcpy(sf->chkpath,pf->chkpath,sizeof(sf->chkpath));
+    sf->typ = pf->typ;
+    sf->ino = pf->ino;
+    sf->cont = (ofs != 0);
+    sf->more = (ofs + len < flen);
+    sf->bo = &bo;
+    sf->ln0 = ln0;
+    sf->src = sp;
+    sf->slen = len;
+    sf->st = Pre_ok;
+    prescan(sf);
+
+    if (sf->st == Pre_ok) {
+      fip = premerge(sf,tp,sp + sf->ofs);
+      fip->seg = 1;
+      fip->fofs = ofs;
+      fip->src = sf->ofs;
+      fip->ln0 = ln0;
+      ln0 += sf->c.lncnt;
+      tp->segcnt++;
+    }
+    osmunmap(map,mlen + Pad);
+    ofs += len;
+  }
+  osclose(fd);
+  afree(sf,"pre seg",nextcnt);
+  return ofs < flen;
+}
 
-  n = 0;
-  l = 0;
-  src[slen]   = 0; // eof
-  src[slen+1] = 0;
+// map a streamed segment again for lex, with eof and next fid written. pbas,plen for unmap
+ub1 *mapseg(struct filinf *fip,ub4 nxfid,ub1 **pbas,ub8 *plen)
+{
+  ub8 pagemsk = ospagesize - 1;
+  ub8 bas = fip->fofs & ~pagemsk;
+  ub4 delta = (ub4)(fip->fofs - bas);
+  ub8 mlen = delta + fip->src + fip->len;
+  ub1 *map,*sp;
+  int fd;
 
-#include "lua_pre.i"
+  fd = osopen(fip->nam);
+  if (fd == -1) { errorfln(FLN,0,"cannot open %s",fip->nam); return nil; }
+  mlen = min(mlen,fip->flen - bas); // no pages past eof
+  map = osmmapfdwin(fd,bas,mlen,Pad + 1);
+  osclose(fd);
+  if (map == nil) { errorfln(FLN,0,"cannot map %s at %lu`",fip->nam,fip->fofs); return nil; }
+
+  sp = map + delta + fip->src;
+  sp[fip->len - 1] = '\n'; // as added by prescan for last segment
+  sp[fip->len] = 0;
+  wrfid(sp,fip->len + 1,nxfid);
+
+  *pbas = map;
+  *plen = mlen + Pad + 1;
+  return sp;
+}
 
-  // come here at eof
+// unit positions : files in chain order, one past each eof
+static void setfilpos(struct filinf *fip,ub4 cnt)
+{
+  ub4 fid,pos = 0;
+  ub8 tot = 0;
 
-  if (sp[slen-1] != '\n') sp[slen++] = '\n'; // for next pass
+  for (fid = 0; fid < cnt; fid++, fip++) {
+    fip->pos = pos;
+    pos += fip->len + 1;
+    tot += fip->len + 1;
+  }
+  // token deltas stay exact as positions wrap, diag lookup by position does not
+  if (tot > hi32) warning("unit of %lu` bytes above 4G : diags past it may show the wrong file or line",tot);
+}
 
-  sp[slen]   = 0; // eof
+// derive unit estimates from totals
+static void setpresp(struct prelex *presp,struct precnt *c)
+{
+  ub4 euidcnt,bitcnt = c->bitcnt;
 
-  fip->lncnt = l;
-  fip->len = slen;
+  showcnt("3lncnt",c->lncnt);
 
-// ---------------
-endfil:
-// ---------------
+  showcnt("3tkcnt",c->tkcnt + c->lncnt);
+  showcnt("3tacnt",c->tacnt);
+  showcnt("3slitncnt",c->slitncnt);
+  showcnt("3slit1cnt",c->slit1cnt);
+  showcnt("3slit2cnt",c->slit2cnt);
+  showcnt("3nlitcnt",c->nlitcnt + c->nlit1cnt);
+  showcnt("3bitcnt",bitcnt);
 
-  tkcnt += l;
-  lncnt += l;
+  euidcnt = min(hll_est(c->idregs),c->idcnt);
+  showcnt("3est unique ident",euidcnt);
 
-  if (tkcnt >= Tokencnt) serror(n,"token count %u` exceeds limit %u`",tkcnt,Tokencnt);
+  info("max depth %u",c->hidepth);
 
-  if (modsp == 0) break;
+  presp->lncnt = c->lncnt;
 
-  wrfid(sp,slen+1,filcnt);
+  presp->tkcnt = c->tkcnt + c->lncnt + c->tacnt;
+  presp->tacnt = c->tacnt;
+  presp->cmtcnt = c->cmtcnt;
 
-  modp = modstk + modsp--;
-  modid = spos + modp->nam;
-  modtyp = modp->typ;
+  presp->slitncnt = c->slitncnt;
+  presp->slit1cnt = c->slit1cnt;
+  presp->slit2cnt = c->slit2cnt;
+  presp->slittop = c->slitpos;
 
-  path = (cchar *)srcmem.bas + modid;
-  plen = modp->len;
+  presp->nlitcnt = c->nlitcnt + c->nlit1cnt;
 
- } while (1);
+  presp->idcnt = c->idcnt;
+  presp->euidcnt = euidcnt;
 
-  spos = blkexp(&srcmem,Pad,ub1);
-  src = srcmem.bas + spos;
+  if (c->slitncnt > 65536) bitcnt += (c->slitncnt - 65536);
+  presp->bitcnt = bitcnt;
+}
 
-  wrfid(src,0,hi32); // mark last file
+int prelex(cchar *srcpath,enum Inctyp inc,struct prelex *presp,ub8 T0)
+{
+  int rv = 0;
+  ub4 t0 = (ub4)(T0 / 1000);
+  ub4 dirsep = 0;
+  cchar *path;
+  ub4 plen;
 
-  // end
-  showcnt("3lncnt",lncnt);
+  struct filinf *fip=nil;
+  ub4 filid,nxfid;
 
-  showcnt("3tkcnt",tkcnt);
-  showcnt("3tacnt",tacnt);
-  showcnt("3slitncnt",slitncnt);
-  showcnt("3slit1cnt",slit1cnt);
-  showcnt("3slit2cnt",slit2cnt);
-  showcnt("3nlitcnt",nlitcnt);
-  showcnt("3bitcnt",bitcnt);
-  showcnt("3filcnt",filcnt);
+  struct prefil *pf,*pfs;
+  ub4 pfcnt,pfi;
+  struct prejob job;
+  ub4 thrcnt = max(presp->thrcnt,1);
+  bool par;
+  ub1 *src;
 
-  if (idcnt > 1024) {
-    euidcnt = exp_est(idsketchs);
-    showcnt("4est unique ident",euidcnt);
-  }
+  struct pretot tot;
 
-  ub2 hidepth = (ub2)((ub1 *)memchr(bolvlc,0,Depth) - bolvlc);
-  info("max depth %u",hidepth);
-//  presp->hidepth = hidepth;
+  ub4 n = 0;
 
-  presp->lncnt = lncnt;
+  ub8 T1=0;
 
-  presp->tkcnt = tkcnt + tacnt;
-  presp->tacnt = tacnt;
-  presp->cmtcnt = cmtcnt;
+  memset(&tot,0,sizeof(tot));
 
-  presp->slitncnt = slitncnt;
-  presp->slit1cnt = slit1cnt;
-  presp->slit2cnt = slit2cnt;
-  presp->slittop = slitpos;
+  // source file store
+  memset(&srcmem,0,sizeof(srcmem));
+  srcmem.inc = (1U << 14);
+  srcmem.ini = 1024;
+  srcmem.elsiz = 1;
+  srcmem.align = 1;
+  srcmem.min = 1;
 
-  presp->nlitcnt = nlitcnt;
+ // file IDs
+  memset(&filmem,0,sizeof(filmem));
+  filmem.inc = (1U << 12);
+  filmem.ini = 1024;
+  filmem.elsiz = sizeof(struct filinf);
+  filmem.align = 8;
+  filmem.min = 1;
+
+  mkinoset(64);
+  inolookups = inoshort = inoprobes = 0;
+  inoscans = 0;
+  fmodcnt = 0;
+  mapcnt = 0;
+  mkincidx(presp);
 
-  if (slitncnt > 65536) bitcnt += (slitncnt - 65536);
-  presp->bitcnt = bitcnt;
+  path = srcpath;
+  plen = (ub4)strlen(path);
+
+  while (path[n]) { if (path[n] == '/') dirsep = n; n++; }
+  if (n == dirsep + 1) { errorfln(FLN,0,"lex: path '%s' is a directory",path); return 1; }
+  if (plen >= Pathname) { errorfln(FLN,0,"path len %u exceeds %u",plen,Pathname); return 1; }
+
+  timeit(&T1,nil);
+
+  pfs = alloc(1,struct prefil,Mnofil,"pre batch",nextcnt);
+  pfcnt = 1;
+  pf = pfs;
+  memset(pf,0,sizeof(*pf) - sizeof(pf->mods));
+  memcpy(pf->path,path,plen);
+  pf->plen = plen;
+
+  do { // each batch of modules, breadth-first
+
+    par = (thrcnt > 1 && pfcnt > 1 && inc != Icmd);
+
+    if (par) { // load and scan all in parallel
+      job.pfs = pfs;
+      job.cnt = pfcnt;
+      job.nxt = 0;
+      job.inc = inc;
+      job.presp = presp;
+      osrunpar(min(thrcnt,pfcnt),preworker,&job);
+    }
+
+    tot.nxpfs = nil;
+    tot.nxpfcnt = 0;
+
+    for (pfi = 0; pfi < pfcnt; pfi++) { // merge in fixed order
+      pf = pfs + pfi;
+      if (par == 0) {
+        pf->st = preload(pf,inc,presp,0);
+        if (pf->st == Pre_ok && precached(pf,presp) == 0) prescan(pf);
+      } else if ((pf->st == Pre_ok || pf->st == Pre_stream) && samefile(&pf->ino)) {
+        if (pf->st == Pre_stream) osclose(pf->fd);
+        if (pf->lxf) osmunmap(pf->lxf,pf->lxflen);
+        pf->st = Pre_dup;
+      }
+
+      switch (pf->st) {
+      case Pre_ok: break;
+      case Pre_dup:    info("skip duplicate %s ",pf->chkpath); break;
+      case Pre_empty:  info("%s is empty",pf->chkpath); break;
+      case Pre_noopen: errorfln(FLN,0,"cannot open %.*s",pf->plen,pf->path); return 1;
+      case Pre_noinfo: errorfln(FLN,0,"cannot get info for %s",pf->chkpath); return 1;
+      case Pre_stream: if (prestream(pf,presp,&tot)) return 1;
+                       break;
+      case Pre_rderr:  errorfln(FLN,0,"cannot read %s",pf->chkpath); return 1;
+      case Pre_lxerr:  return 1; // reported by worker
+      }
+      if (pf->st != Pre_ok) {
+        if (pf->mapped) osmunmap(pf->src,pf->ino.len + Pad);
+        else if (pf->own) mfree(pf->src);
+        continue;
+      }
+
+      src = pf->own ? pf->src : srcmem.bas + pf->spos;
+
+      fip = premerge(pf,&tot,src + pf->ofs);
+      if (pf->own) {
+        fip->bas = src;
+        fip->src = pf->ofs;
+      } else fip->src = pf->spos + pf->ofs;
+      if (pf->mapped) { fip->mapped = 1; mapcnt++; }
+    }
+
+    afree(pfs,"pre batch",nextcnt);
+    pfs = tot.nxpfs;
+    pfcnt = tot.nxpfcnt;
+    tot.batch++;
+    inc = Iuser; // modules relative to cwd, then -I
+  } while (pfcnt);
+
+  rmincidx();
+
+  setfilpos((struct filinf *)filmem.bas,tot.filcnt);
+
+  // chain files via fid after eof, for both in-place and own sources. Streamed segments are chained at lex
+  fip = (struct filinf *)filmem.bas;
+  for (filid = 0; filid < tot.filcnt; filid++, fip++) {
+    if (fip->seg) continue;
+    nxfid = filid + 1 < tot.filcnt ? filid + 1 : hi24;
+    src = (fip->bas ? fip->bas : srcmem.bas) + fip->src;
+    wrfid(src,fip->len + 1,nxfid);
+  }
+  presp->mapcnt = mapcnt;
+  presp->segcnt = tot.segcnt;
+
+  setpresp(presp,&tot.c);
+
+  showcnt("3filcnt",tot.filcnt);
+  showcnt("3mapped file",mapcnt);
+  showcnt("3streamed segment",tot.segcnt);
+  showcnt("3file lookup",inolookups);
+  showcnt("3short-circuited duplicate",inoshort);
+  if (inolookups) info("file lookups probed %u slots, a linear scan would compare %lu` files",inoprobes,inoscans);
+  if (incdircnt) {
+    showcnt("3include dir scan",incscans);
+    showcnt("#3include opens avoided",tot.incavoid);
+    info("include index saved %d syscalls",(int)tot.incavoid - (int)incscans * 3); // open getdents close
+  }
+  showcnt("3module batche",tot.batch);
+  if (presp->cachedir) showcnt("3token cache hit",tot.lxfhit);
+
+  presp->src = (cchar *)srcmem.bas;
+  presp->srclen = srcmem.pos;
 
   presp->files = (struct filinf *)filmem.bas;
-  presp->filcnt = filcnt;
-  presp->modcnt = modcnt;
+  presp->filcnt = tot.filcnt;
+  presp->modcnt = tot.modcnt;
 
   if (globs.rununtil == 1) { info("until file %u",gettime_msec()-t0); return 0; }
 
   if (rv || presp->tkcnt == 0) return rv;
 
-  timeit2(&T0,slen,"preprocessed ` in");
+  timeit2(&T0,srcmem.pos,"preprocessed ` in");
+
+  return 0;
+}
+
+// changed range as pos, old len, new len : common prefix and suffix, 8 bytes at a time
+static void predamage(const ub1 *a,ub4 alen,const ub1 *b,ub4 blen,ub4 *dmg)
+{
+  ub4 p = 0,s = 0,m = min(alen,blen);
+  ub8 x,y;
+
+  while (p + 8 <= m) {
+    memcpy(&x,a + p,8); memcpy(&y,b + p,8);
+    if (x != y) break;
+    p += 8;
+  }
+  while (p < m && a[p] == b[p]) p++;
+  m -= p;
+  while (s + 8 <= m) {
+    memcpy(&x,a + alen - s - 8,8); memcpy(&y,b + blen - s - 8,8);
+    if (x != y) break;
+    s += 8;
+  }
+  while (s < m && a[alen - s - 1] == b[blen - s - 1]) s++;
+  dmg[0] = p;
+  dmg[1] = alen - p - s;
+  dmg[2] = blen - p - s;
+}
+
+/* prelex one changed file again, keeping the results of all others
+   dmg has the changed range for lexedit
+   returns 0 if done, 1 on error, 2 if the module graph or file layout changed : full prelex needed
+ */
+int preupdate(struct prelex *presp,ub4 fid,ub4 *dmg)
+{
+  struct filinf *fip = (struct filinf *)filmem.bas + fid;
+  struct prefil *pf;
+  struct precnt tot;
+  ub4 i,filcnt = presp->filcnt;
+  enum Prest st;
+  int rv = 0;
+
+  if (fid >= filcnt || fip->seg) return 2;
+
+  pf = alloc(1,struct prefil,Mnofil,"pre update",nextcnt);
+  memset(pf,0,sizeof(*pf) - sizeof(pf->mods));
+  pf->plen = (ub2)min(strlen(fip->nam),Pathname-1);
+  memcpy(pf->path,fip->nam,pf->plen);
+  pf->typ = fip->typ;
+
+  st = pf->st = preload(pf,Inone,presp,1); // private buffer, no dedup
+  if (st == Pre_ok) { prescanx(pf,1); st = pf->st; }
+
+  if (st == Pre_stream) { osclose(pf->fd); rv = 2; }
+  else if (st == Pre_empty) rv = 2; // drops out of the chain
+  else if (st == Pre_lxerr) rv = 1; // reported by prescan
+  else if (st != Pre_ok) { errorfln(FLN,0,"cannot reload %s",fip->nam); rv = 1; }
+  else if (modsig(pf,pf->src + pf->ofs) != fcnts[fid].modhc) rv = 2;
+
+  if (rv) {
+    if (pf->mapped) osmunmap(pf->src,pf->ino.len + Pad);
+    else if (pf->own) mfree(pf->src);
+    afree(pf,"pre update",nextcnt);
+    return rv;
+  }
+
+  predamage((fip->bas ? fip->bas : (const ub1 *)presp->src) + fip->src,fip->len,pf->src + pf->ofs,pf->slen,dmg);
+
+  // replace in place. Sources in srcmem are left
+  if (fip->bas) {
+    if (fip->mapped) osmunmap(fip->bas,fip->flen + Pad);
+    else mfree(fip->bas);
+  }
+  if (fip->lntab) mfree(fip->lntab); // from a diag
 
+  fip->bas = pf->src;
+  fip->src = pf->ofs;
+  fip->len = pf->slen;
+  fip->mapped = pf->mapped;
+  fip->lncnt = pf->c.lncnt;
+  fip->lntab = nil;
+  fip->mtime = pf->ino.mtimns;
+  fip->flen = pf->ino.len;
+  wrfid(pf->src + pf->ofs,pf->slen + 1,fid + 1 < filcnt ? fid + 1 : hi24);
+
+  pf->c.modhc = fcnts[fid].modhc;
+  fcnts[fid] = pf->c;
+  afree(pf,"pre update",nextcnt);
+
+  setfilpos((struct filinf *)filmem.bas,filcnt); // files past this one move
+
+  memset(&tot,0,sizeof(tot));
+  for (i = 0; i < filcnt; i++) addcnt(&tot,fcnts + i);
+  setpresp(presp,&tot);
+
+  vrb("updated %s",fip->nam);
   return 0;
 }
 
@@ -495,6 +1423,8 @@ void inipre(void)
 {
   genmsgfln(0,Info,"%s\n",lexinfo);
 
+  prehc = hashstr((const ub1 *)lexinfo,(ub4)sizeof(lexinfo),0);
+
   verbose = globs.msglvl >= Vrb;
 
   lastcnt
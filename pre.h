@@ -30,6 +30,8 @@ struct prelex {
 
   ub4 nlitcnt;
 
+  ub4 idcnt,euidcnt; // estimated unique
+
   ub4 bitcnt;
 
   ub4 lncnt;
@@ -39,9 +41,45 @@ struct prelex {
 
   ub2 incdircnt;
   const char **incdirs;
+
+  bool domap; // map instead of read larger sources
+  ub4 mapcnt;
+  ub2 thrcnt; // parallel prelex of modules if > 1
+  ub4 window; // stream files larger than this in windows
+  ub4 segcnt;
+
+  bool lexstat; // show lex estimates vs actual
+  bool tkbench; // token walk benchmark, packed build
+  bool edit; // keep lex state for lexedit
+  cchar *lexprof; // lex sizing profile
+
+  cchar *cachedir; // token cache, see lxfhdr
+  ub4 lexhc; // lexer hash, part of the cache key
+};
+
+/* token cache entry for one source file, as <cachedir>/<dev>-<ino>.lxf
+   Valid while the file matches dev, ino, mtime in nsec and len, and both lexers are the same
+   Prelex maps it and takes the prelex record in part 0, skipping the scan. Lex takes the other parts as a parallel run
+   Header, then parts each 8-aligned. Native byte order, a swapped magic does not match
+ */
+#define Lxfmagic 0x3166784c // Lxf1
+#define Lxfver 2
+#define Lxfparts 12
+
+struct lxfhdr {
+  ub4 magic,ver;
+  ub4 prehc,lexhc;
+  ub8 mtime,flen,ino,dev;
+  ub4 lens[Lxfparts];
+  ub4 len; // total incl header
+  ub4 pad;
 };
 
 enum Inctyp { Inone,Isys,Iuser,Icmd };
 
 extern int prelex(cchar *path,enum Inctyp inc,struct prelex *lsp,ub8 T0);
+extern int preupdate(struct prelex *presp,ub4 fid,ub4 *dmg);
+extern ub1 *mapseg(struct filinf *fip,ub4 nxfid,ub1 **pbas,ub8 *plen);
+extern const void *prepart(const ub1 *lxf,ub4 part);
+extern void prewrcache(struct prelex *presp,ub4 fid,const void **parts,const ub4 *lens,ub4 cnt);
 extern void inipre(void);
@@ -1,13 +1,13 @@
 /* predef.h - lexer definitions
 
-   generated by genlex 0.1.0-alpha  3 Oct 2022  5:12
+   generated by genlex 0.1.0-alpha 17 Oct 2026  2:10
 
-   from pre.lex 0.1.0  3 Oct 2022  4:46 lua
+   from pre.lex 0.1.0 17 Oct 2026  2:10 lua
    options: code yes  tokens yes
  */
 static const char specnam[] = "pre.lex";
 
-static const char lexinfo[] = "pre.lex 0.1.0   3 Oct 2022  4:46 lua  code yes  tokens yes";
+static const char lexinfo[] = "pre.lex 0.1.0  17 Oct 2026  2:10 lua  code yes  tokens yes";
 
 #define Cclen 4
 
@@ -23,28 +23,104 @@ static const char lexinfo[] = "pre.lex 0.1.0   3 Oct 2022  4:46 lua  code yes  t
  SQ  8   ' ' '
  DQ  9   ' " '
  RR  10  ' r'
- BO  11  ' ( [ { '
- BC  12  ' ) ] } '
- DT  13  ' . '
- OP  14  ' ! % & * + - / < > @ ^ | ~ '
- PC  15  ' , : ; = ? '
- EOF 16  ' \0 '
+ BO  11  ' ( { '
+ SO  12  ' [ '
+ BC  13  ' ) ] } '
+ DT  14  ' . '
+ OP  15  ' ! % & * + - / < > @ ^ | ~ '
+ PC  16  ' , : ; = ? '
+ EOF 17  ' \0 '
  AN  1  + ' 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz'
  NX  2  + ' . 0123456789_'
  XN  4  + ' 0123456789ABCDEF_abcdef'
  WS  0  - '   '
 */
-#define x  17
+/* skip a run of set members from sp+n, at least up to the 0 at eof
+   set is two nibble tables : c is a member if set[c & 15] & set[16 + (c >> 4)], followed by a plain map
+   Most runs are short : callers only skip if the char at Runpeek is a member, within the source pad.
+   The first Runscalar chars are tested inline one by one, longer runs vectorised
+   Aligned loads never cross a page, so reading past the eof within one is harmless
+ */
+#define Runpeek 4
+#define Runscalar 8
+
+#if defined __AVX2__
+ #include <immintrin.h>
+
+static __attribute__((noinline,no_sanitize_address)) ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)
+{
+  const __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set));
+  const __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(set + 16)));
+  const __m256i nib = _mm256_set1_epi8(0x0f);
+  const ub1 *p = sp + n;
+  const ub1 *a = (const ub1 *)((size_t)p & ~(size_t)31);
+  ub4 x = 0xffffffffU << (p - a);
+  __m256i v,m;
+
+  do {
+    v = _mm256_load_si256((const __m256i *)a);
+    m = _mm256_and_si256(_mm256_shuffle_epi8(lo,_mm256_and_si256(v,nib)),_mm256_shuffle_epi8(hi,_mm256_and_si256(_mm256_srli_epi16(v,4),nib)));
+    x &= (ub4)_mm256_movemask_epi8(_mm256_cmpeq_epi8(m,_mm256_setzero_si256()));
+    if (x) break;
+    a += 32; x = 0xffffffffU;
+  } while (1);
+  return (ub4)(a - sp) + (ub4)__builtin_ctz(x);
+}
+
+#elif defined __SSSE3__
+ #include <tmmintrin.h>
+
+static __attribute__((noinline,no_sanitize_address)) ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)
+{
+  const __m128i lo = _mm_loadu_si128((const __m128i *)set);
+  const __m128i hi = _mm_loadu_si128((const __m128i *)(set + 16));
+  const __m128i nib = _mm_set1_epi8(0x0f);
+  const ub1 *p = sp + n;
+  const ub1 *a = (const ub1 *)((size_t)p & ~(size_t)15);
+  ub4 x = 0xffffU << (p - a);
+  __m128i v,m;
+
+  do {
+    v = _mm_load_si128((const __m128i *)a);
+    m = _mm_and_si128(_mm_shuffle_epi8(lo,_mm_and_si128(v,nib)),_mm_shuffle_epi8(hi,_mm_and_si128(_mm_srli_epi16(v,4),nib)));
+    x &= (ub4)_mm_movemask_epi8(_mm_cmpeq_epi8(m,_mm_setzero_si128()));
+    if (x) break;
+    a += 16; x = 0xffffU;
+  } while (1);
+  return (ub4)(a - sp) + (ub4)__builtin_ctz(x);
+}
+
+#else
+
+static ub4 runskipv(const ub1 *sp,ub4 n,const ub1 *set)
+{
+  while (set[32 + sp[n]]) n++;
+  return n;
+}
+
+#endif
+
+static inline ub4 runskip(const ub1 *sp,ub4 n,const ub1 *set)
+{
+  ub4 e = n + Runscalar;
+
+  do {
+    if (set[32 + sp[n]] == 0) return n;
+  } while (++n < e);
+  return runskipv(sp,n,set);
+}
+
+#define x  18
 
 static unsigned char ctab[256] = {
-  16, x, x, x, x, x, x, x, x, 3, 6, x, 4, 5, x, x,  // 16, x, x, x, x, x, x, x, x,ht,nl, x,vt,cr, x, x,
+  17, x, x, x, x, x, x, x, x, 3, 6, x, 4, 5, x, x,  // 17, x, x, x, x, x, x, x, x,ht,nl, x,vt,cr, x, x,
    x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x,  //  x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x,
-   x,14, 9, 7, x,14,14, 8,11,12,14,14,15,14,13,14,  //  x,op,dq,hs, x,op,op,sq,bo,bc,op,op,pc,op,dt,op,
-   2, 1, 1, 1, 1, 1, 1, 1, 1, 1,15,15,14,15,14,15,  // n0,nm,nm,nm,nm,nm,nm,nm,nm,nm,pc,pc,op,pc,op,pc,
-  14, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // op,af,af,af,af,af,af,af,af,af,af,af,af,af,af,af,
-   0, 0, x, 0, 0, 0, 0, 0, 0, 0, 0,11, x,12,14, 0,  // af,af, x,af,af,af,af,af,af,af,af,bo, x,bc,op,af,
+   x,15, 9, 7, x,15,15, 8,11,13,15,15,16,15,14,15,  //  x,op,dq,hs, x,op,op,sq,bo,bc,op,op,pc,op,dt,op,
+   2, 1, 1, 1, 1, 1, 1, 1, 1, 1,16,16,15,16,15,16,  // n0,nm,nm,nm,nm,nm,nm,nm,nm,nm,pc,pc,op,pc,op,pc,
+  15, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // op,af,af,af,af,af,af,af,af,af,af,af,af,af,af,af,
+   0, 0, x, 0, 0, 0, 0, 0, 0, 0, 0,12, x,13,15, 0,  // af,af, x,af,af,af,af,af,af,af,af,so, x,bc,op,af,
    x, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  //  x,af,af,af,af,af,af,af,af,af,af,af,af,af,af,af,
-   0, 0,10, 0, 0, 0, 0, 0, 0, 0, 0,11,14,12,14, x,  // af,af,rr,af,af,af,af,af,af,af,af,bo,op,bc,op, x,
+   0, 0,10, 0, 0, 0, 0, 0, 0, 0, 0,11,15,13,15, x,  // af,af,rr,af,af,af,af,af,af,af,af,bo,op,bc,op, x,
    x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x,  //  x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x,
    x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x,  //  x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x,
    x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x,  //  x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x,
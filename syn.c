@@ -41,6 +41,7 @@
 #include "chr.h"
 
 #include "mem.h"
+#include "os.h"
 
 #include "fmt.h"
 
@@ -79,6 +80,15 @@ extern int syn(struct lexsyn *lsp,struct synast *sa,ub8 T0);
 
 #define Trace
 
+// token and atr at ti, from the split streams or the packed one, see lexsyn.h
+#ifdef Tkpack
+ #define tkat(ti) (enum Token)(pks[ti] & Pk_tkmsk)
+ #define atrat(ti) (ub2)(pks[ti] >> Pk_atrbit)
+#else
+ #define tkat(ti) tks[ti]
+ #define atrat(ti) atrs[ti]
+#endif
+
 static bool dotrace = 0;
 
 static cchar *tknam(enum Token tk,ub4 bits)
@@ -225,6 +235,9 @@ static void ser(ub4 shfln,
 
   const enum Token * restrict tks    = lsp->toks;
   const ub2        * restrict atrs   = lsp->atrs;
+#ifdef Tkpack
+  const ub4        * restrict pks    = lsp->pks;
+#endif
 
   switch(sm) {
     case Ser_nil: msg = "nil"; break;
@@ -342,9 +355,12 @@ static void __attribute__ ((format (printf,10,11))) sdiafln(
   static ub2 rowcnt;
   const enum Token * restrict tks    = lsp->toks;
   const ub2        * restrict atrs   = lsp->atrs;
+#ifdef Tkpack
+  const ub4        * restrict pks    = lsp->pks;
+#endif
 
-  enum Token tk = tks[ti];
-  ub2 lat,atr   = atrs[ti];
+  enum Token tk = tkat(ti);
+  ub2 lat,atr   = atrat(ti);
 
   ub4 fps=0,xat=0;
   ub4 len = 512;
@@ -448,6 +464,11 @@ int syn(struct lexsyn *lsp,struct synast *sa,ub8 T0)
   const ub2 * restrict atrs   = lsp->atrs;
   const ub8 * restrict tkbits = lsp->bits;
   const ub1 * restrict dfp0s  = lsp->dfp0s;
+#ifdef Tkpack
+  const ub4 * restrict pks    = lsp->pks;
+  const ub8 * restrict pkxs   = lsp->pkxs;
+  ub4 pk,pkxi = 0;
+#endif
 
   int rv = 0;
 
@@ -474,7 +495,7 @@ int syn(struct lexsyn *lsp,struct synast *sa,ub8 T0)
   ub8 repid;
 
   ub4 fps=0,hirepfps=0,fpx=0,xat;
-  ub4 fn0=0,fn1=0;
+  ub4 fn0=0,fn1=0,fti=0; // fti : tokens whose start delta is taken
   ub1 dfp0;
   ub4 dfp;
   ub8 bits = 0;
@@ -611,20 +632,32 @@ nxtsym1:
     if (si >= Slen) ice(0,fps,"si %u",si);
     if (++itercnt > iterlim) ice(0,fps,"iter lim %u",iterlim);
 
-    rtk  = tks[ti];
-
-    if (rtk & 0x80) {
-      tk = rtk & 0x3f;
-      dfp0 = dfp0s[fn0++];
-      dfp = dfp0 & 0x7f;
-      if (dfp0 & 0x80) {
-        dfp |= dfp0s[fn0++] << 7;
-        dfp |= dfp0s[fn0++] << 15;
-      }
+    // start deltas of all tokens up to ti, each once : a token can be looked at again, or skipped
+#ifdef Tkpack
+    while (fti <= ti) {
+      dfp = (pks[fti] >> Pk_dfpbit) & Pk_dfpx;
+      if (dfp == Pk_dfpx) dfp = (ub4)pkxs[pkxi++];
       fps += dfp;
-    } else {
-      tk = rtk;
+      fti++;
+    }
+    pk = pks[ti];
+    tk = pk & Pk_tkmsk;
+#else
+    while (fti <= ti) {
+      rtk = tks[fti++];
+      if (rtk & 0x80) {
+        dfp0 = dfp0s[fn0++];
+        dfp = dfp0 & 0x7f;
+        if (dfp0 & 0x80) {
+          dfp |= dfp0s[fn0++] << 7;
+          dfp |= dfp0s[fn0++] << 15;
+        }
+        fps += dfp;
+      }
     }
+    rtk  = tks[ti];
+    tk = (rtk & 0x80) ? rtk & 0x3f : rtk;
+#endif
 
     s = sp[si];
     z = cp[si];
@@ -646,7 +679,7 @@ nxtsym1:
       if (nxve >= Plaid && nxve < Pendrep) { // lookahead
         laid = nxve - Plaid;
         lan = lasetn[laid];
-        tk1 = tks[ti+1];
+        tk1 = tkat(ti+1);
         tkbit = 1UL << tk1;
 
         lasi = lasecmap[laid * T99_count + tk];
@@ -943,7 +976,7 @@ nxtrep:
     Sinfo(fps,"ai %x isrep %u arg %x Pid %u.%u ve %u %s %s",ai,isrep,arg,pid,ndti,ve,prdnam(ve,tk),atynam(aty));
   } else {
     aty = nhs[pid] >> Atybit;
-    svrb(fps,"lvl %u ai %x isrep %u arg %x pid %u %s ti %u %s",lvl,ai,isrep,arg,pid,atynam(aty),ti,tknam(tks[ti],0));
+    svrb(fps,"lvl %u ai %x isrep %u arg %x pid %u %s ti %u %s",lvl,ai,isrep,arg,pid,atynam(aty),ti,tknam(tkat(ti),0));
   }
   cid = pid;
 
@@ -960,7 +993,7 @@ nxtsym:
 
   do { // each sym in clause
 
-    tk = tks[ti];
+    tk = tkat(ti);
 
     s = sp[si];
     z = cp[si];
@@ -1027,7 +1060,7 @@ nxtsym:
 
     if (doleaf) {
 
-      atr = atrs[ti];
+      atr = atrat(ti);
 
       lat = atr & ~ La_msk; atr &= La_msk;
       switch (tk) {
@@ -1072,7 +1105,7 @@ nxtsym:
           if (bits < Atybit) { aty = Ailits; ndti = bits; }
           else aty = Ailit;
           break;
-        case La_flit8: fatal(0,fps,"flt lits %x todo",atr);
+        case La_flit8: aty = Aflit; bits = tkbits[bi++]; break; // double bits
         case La_ilita:
         case La_flita: sinfo(fps,"ascii lits %u todo",atr);
                        bits = tkbits[bi++];
@@ -1357,7 +1390,8 @@ endsym:
     msglog(nil,nil,"syn");
   }
 
-  afree(lsp->tkbas,"lex tokens",nextcnt);
+  if (lsp->tkmaplen) osmunmap(lsp->tkbas,lsp->tkmaplen);
+  else if (lsp->keep == 0) afree(lsp->tkbas,"lex tokens",nextcnt);
 
   if (globs.rununtil < 4) {
     info("until %u %u",globs.rununtil,gettime_msec()-t1);
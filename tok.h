@@ -1,8 +1,8 @@
 /* tok.h - lexer token defines
 
-   generated by genlex 0.1.0-alpha 27 Sep 2022  9:37
+   generated by genlex 0.1.0-alpha 17 Oct 2026  3:00
 
-   from lua.lex 0.1.0 27 Sep 2022  9:40 lua
+   from lua.lex 0.1.0 17 Oct 2026  3:00 lua
    signature: @ 9c2a0bddc8353182 @ */
 
 enum Packed8 Token {
@@ -76,7 +76,6 @@ enum Packed8 Bltin {
 };
 
 static const ub1 hibltlen = 14;
-static const ub1 mibltlen = 6;
 enum Packed8 Dunder {
   Dadd       =   0, Dsub       =   1, Dmul       =   2, Ddiv       =   3, Dmod       =   4, Dpow       =   5, Dunm       =   6, Didiv      =   7,
   Dband      =   8, Dbor       =   9, Dbxor      =  10, Dbnot      =  11, Dshl       =  12, Dshr       =  13, Dconcat    =  14, Dlen       =  15,
@@ -92,7 +91,7 @@ static const ub2  tkwnamposs[ 22] = { 0,4,8,16,20,28,32,40,44,48,52,60,64,68,76,
 
 static const ub1  tkwnamlens[ 22] = { 2,4,6,3,5,3,8,4,2,2,5,3,3,6,6,4,4,5,5,5,8 };
 
-static const ub4 kwnamhsh = 0xc9e67151;
+static const ub4 kwnamhsh = 0x77b17ee2;
 
 static const char bltnampool[1015] = "_ENV_G  assert  collectgarbage  dofile  error   getmetatableipairs  loadloadfilenextpairs   pcall   print   rawequalk   rawget  rawlen  rawset  select  setmetatabletonumbertostringtype_VERSIONwarnxpcall  coroutine   close   create  isyieldable resume  running status  wrapyield   require package config  cpath   loaded  loadlib pathpreload searchers   searchpath  string  bytechardumpfindformat  gmatch  gsublen lower   match   packpacksizerep reverse sub unpack  upper   utf8charpattern codes   codepoint   offset  table   concat  insert  moveremove  sortmathabs acosasinatanceilcos deg exp florfmodhugelog max maxinteger  min mininteger  modfpi  rad random  randomseed  sin sqrttan tointeger   ult io  flush   input   lines   openoutput  popen   readtmpfile write   fileseeksetvbuf os  clock   datedifftimeexecute exitgetenv  rename  setlocale   timetmpname debug   gethook getinfo getlocalgetregistry getupvalue  getuservale sethook setlocalsetupvalue  setuservaluetraceback   upvalueid   upvaluejoinunknown_blt\0";
 
@@ -27,6 +27,12 @@
 #include <stdarg.h>
 #include <string.h>
 
+#ifdef __AVX2__
+ #include <immintrin.h>
+#elif defined __SSE2__
+ #include <emmintrin.h>
+#endif
+
 #include "base.h"
 #include "os.h"
 
@@ -585,26 +591,81 @@ int myfclose(struct bufile *f)
   return f->err;
 }
 
+/* find newlines 16 or 32 at a time. Store offset of each plus ofs into tab if not nil
+   returns count
+ */
+ub4 scannl(const ub1 *p,ub4 n,ub4 *tab,ub4 ofs)
+{
+  ub4 i = 0,cnt = 0,m;
+
+#ifdef __AVX2__
+  const __m256i nl32 = _mm256_set1_epi8('\n');
+
+  for (; i + 32 <= n; i += 32) {
+    m = (ub4)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)),nl32));
+    if (tab == nil) { cnt += (ub4)__builtin_popcount(m); continue; }
+    while (m) { tab[cnt++] = i + (ub4)__builtin_ctz(m) + ofs; m &= m - 1; }
+  }
+#endif
+
+#ifdef __SSE2__
+  const __m128i nl16 = _mm_set1_epi8('\n');
+
+  for (; i + 16 <= n; i += 16) {
+    m = (ub4)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)),nl16));
+    if (tab == nil) { cnt += (ub4)__builtin_popcount(m); continue; }
+    while (m) { tab[cnt++] = i + (ub4)__builtin_ctz(m) + ofs; m &= m - 1; }
+  }
+#endif
+
+  for (; i < n; i++) {
+    if (p[i] != '\n') continue;
+    if (tab) tab[cnt] = i + ofs;
+    cnt++;
+  }
+  return cnt;
+}
+
+/* find the close ]=..] with lvl '=' of a long bracket body in p[0..n). memchr for the ']', then check the level
+   returns its offset, or n if missing. *pnl gets the newlines before it, *plst the offset past the last of these
+ */
+ub4 scanlong(const ub1 *p,ub4 n,ub4 lvl,ub4 *pnl,ub4 *plst)
+{
+  const ub1 *q,*s = p,*e = p + n;
+  ub4 i,x,cnt;
+
+  while ( (q = memchr(s,']',(size_t)(e - s))) ) {
+    s = q + 1;
+    for (i = 0; i < lvl && s + i < e && s[i] == '='; i++) ;
+    if (i == lvl && s + i < e && s[i] == ']') break;
+  }
+  x = q ? (ub4)(q - p) : n;
+
+  cnt = scannl(p,x,nil,0);
+  *pnl = cnt;
+  if (cnt) {
+    i = x;
+    while (p[i-1] != '\n') i--;
+    *plst = i;
+  }
+  return x;
+}
+
 ub4 *mklntab(cchar *p,ub4 n,ub4 *pcnt)
 {
-  ub4 i;
-  ub4 cnt = 0;
+  ub4 cnt;
   ub4 *tab;
 
   *pcnt = 0;
   if (n < 3) return nil;
 
-  for (i = 0; i < n; i++) if (p[i] == '\n') cnt++;
+  cnt = scannl((const ub1 *)p,n,nil,0);
   if (cnt == 0) return nil;
-  cnt++;
 
   // todo
-  tab = minalloc(cnt * 4,4,Mnofil,"lintab");
+  tab = minalloc((cnt + 1) * 4,4,Mnofil,"lintab");
 
-  cnt = 0;
-  for (i = 0; i < n; i++) {
-    if (p[i] == '\n') tab[cnt++] = i;
-  }
+  cnt = scannl((const ub1 *)p,n,tab,0);
   tab[cnt] = n+1;
   *pcnt = cnt;
   return tab;
@@ -87,7 +87,9 @@ extern ub4 sort4(ub4 *p,ub4 n,ub4 fln,const char *desc);
 extern ub4 bsearch4(ub4 *p,ub4 n,ub4 key,ub4 fln,cchar *desc);
 // extern ub4 bsearch8(ub8 *p,ub4 n,ub8 key,ub4 fln,const char *desc);
 
+extern ub4 scannl(const ub1 *p,ub4 n,ub4 *tab,ub4 ofs);
 extern ub4 *mklntab(cchar *p,ub4 n,ub4 *pcnt);
+extern ub4 scanlong(const ub1 *p,ub4 n,ub4 lvl,ub4 *pnl,ub4 *plst);
 
 extern ub4 parse_version(cchar *p,ub1 len);
 extern ub1 check_version(ub4 chk,ub4 ver);